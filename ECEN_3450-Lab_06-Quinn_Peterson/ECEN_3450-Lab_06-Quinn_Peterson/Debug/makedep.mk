@@ -2,13 +2,47 @@
 # Automatically-generated file. Do not edit or delete the file
 ################################################################################
 
+adc_filter.c
+
+adc_scan.c
+
+arbiter.c
+
+calib.c
+
 convenience.c
 
 explore.c
 
+flightrec.c
+
+fmt.c
+
 ir_behaviors.c
 
+kinematics.c
+
+lcd_shadow.c
+
 main.c
 
+odometry.c
+
+panorama.c
+
+pid.c
+
 pr_behaviors.c
 
+profiler.c
+
+range.c
+
+search.c
+
+stack.c
+
+telemetry.c
+
+tiny_sense.c
+
@@ -22,6 +22,14 @@
 //===============================================================================
 #include "capi324v221.h"
 
+//===============================================================================
+//= What:	avr-libc headers the CAPI header does not pull in.					=
+//= Why:	EEPROM access and the CRC for the calibration record (calib.c).		=
+//===============================================================================
+#include <stddef.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
 //===============================================================================
 //= What:	Defines.															=
 //= Why:	definitions for main.c (single line first, then multi-line).		=
@@ -30,10 +38,258 @@
 #define ultrasonic_pin	ADC_CHAN3	// Set the ultrasonic sensor to channel 3	(J3, Pin 1)
 #define right_pr_channel ADC_CHAN4	// Set the right photoresistor to channel 4	(J3, Pin 2)
 #define left_pr_channel ADC_CHAN5	// Set the left photoresistor to channel 5	(J3, Pin 3)
-// channel 6 (J3, Pin 4)
+#define pano_pr_channel ADC_CHAN6	// Set the panorama photoresistor to channel 6	(J3, Pin 4)
 // channel 7 (J3, Pin 5)
 #define LCD_Row_PR_L 1				// Left photoresistor value will be on row 1 of LCD
 #define LCD_Row_PR_R 0				// Right photoresistor value will be on row 0 of LCD
+#define PR_GAIN_SLOW 50				// light_follow speed (steps/sec per volt) on the bright side
+#define PR_GAIN_FAST 200			// light_follow speed (steps/sec per volt) on the dark side
+#define UART0_BAUD 38400UL			// Baud rate of the UART0 debug/telemetry port.
+#define PROFILE_ENABLED 1			// 1 = time the arbitration loop, 0 = compile it out.
+#define ADC_SCAN_PERIOD_MS 2		// Time between ADC scans (every listed channel once).
+#define ADC_SCAN_MAX_CHANNELS 8		// Longest channel list the ADC scan accepts.
+#define ADC_SCAN_NCHANS 8			// Snapshot slots, one per channel ADC_CHAN0..ADC_CHAN7.
+#define ADC_FILTER_MAX_SHIFT 6		// Longest oversample block / IIR time constant (64).
+#define ADC_FILTER_MAX_TAPS_SHIFT 4	// Longest moving-average window (16 taps).
+#define ADC_FILTER_MAX_TAPS 16		// Moving-average history kept per filter.
+#define PR_FILTER_MODE ADC_FILTER_MOVING_AVG	// Filter on both photoresistor channels.
+#define PR_FILTER_SHIFT 4			// Photoresistor filter length, 2^4 = 16 scans (32ms).
+#define ARBITER_MAX_ENTRIES 14		// Longest behavior table the arbiter accepts.
+#define IR_SENSE_MS 125				// IR_sense() period.
+#define AVOID_BACKUP_STEPS 150		// IR_avoid back-up distance (steps).
+#define AVOID_SPEED 200				// IR_avoid maneuver speed (steps/sec).
+#define AVOID_ACCEL 400				// IR_avoid maneuver acceleration (steps/sec^2).
+#define PR_SENSE_MS 125				// PR_sense() period.
+#define TELEMETRY_ENABLED 1			// 1 = stream binary frames on UART0, 0 = compile it out.
+#define TELEMETRY_PERIOD_MS 20		// Time between telemetry frames (50 frames/sec).
+#define TELEMETRY_RING_SIZE 64		// Telemetry transmit ring (bytes, a power of two).
+#define FLIGHTREC_ENABLED 1			// 1 = log frames to the SPI flash, 0 = compile it out.
+#define FLIGHTREC_PERIOD_MS 50		// Time between logged frames (~16 min fills the flash).
+#define FLIGHTREC_SERVICE_MS 5		// Time between flash operations (status poll/program).
+#define FLIGHTREC_CHUNK 32			// Bytes per flash program (divides SPIFLASH_PAGE_SIZE).
+#define FLIGHTREC_CHUNKS 4			// Chunks buffered in RAM while the flash is busy.
+#define STACK_CANARY 0xC5			// Paint in never-used SRAM (see stack.c).
+#define STACK_CHECK_MS 100			// stack_sense() period.
+#define STACK_SCAN_BYTES 128		// Painted bytes stack_sense() checks per call.
+#define STACK_LOW_BYTES 128			// Headroom below this is reported on UART0.
+#define LCD_FLUSH_BUDGET 4			// Most LCD transfers (characters/cursor moves) per loop pass.
+#define FMT_LINE_SIZE 56			// Longest UART0 text line built at once (see fmt.c), with the NUL.
+#define TINY_POLL_MS 50				// ATtiny poll period while waiting on a switch (pre-loop).
+#define RANGE_SENSE_MS 50			// range_sense() period (one ping each).
+#define RANGE_TRIGGER_US 5			// Ping trigger pulse width.
+#define RANGE_MAX_CM 300			// Range reported when nothing echoes.
+#define RANGE_SLOW_CM 60			// range_slowdown() starts slowing here...
+#define RANGE_STOP_CM 20			// ...and is down to RANGE_SCALE_MIN here.
+#define RANGE_SCALE_MIN 2			// Slowest speed scale, in eighths.
+#define CALIB_VERSION 2				// Calibration record layout; bump on any change.
+#define PR_SCAN_STEPS ( DEG_90 * 4 )	// Calibration spin: one full turn in place (steps).
+#define PR_SCAN_SPEED 150			// Calibration spin speed (steps/sec).
+#define PR_SCAN_ACCEL 400			// Calibration spin acceleration (steps/sec^2).
+#define PR_SCAN_SAMPLE_MS 10		// Photoresistor sample period during the spin.
+#define PR_SCAN_MIN_SPAN 32			// Smallest bright - dark span a gain is computed from.
+#define PR_NORM_SPAN 512			// Normalized photoresistor span (darkest to brightest seen).
+#define ODOM_SENSE_MS 10			// odom_sense() period.
+#define ODOM_MAX_DT 5000			// Longest interval odom_sense() integrates (10us ticks).
+#define ODOM_TICKS_PER_SEC 100000UL	// Stopwatch ticks per second (10us each).
+#define ODOM_STEP_UM 1596			// Wheel travel per step (4in wheel, 200 steps/rev), um.
+#define KIN_MAX_SPEED 300			// Fastest wheel speed kin_drive() commands (steps/sec, CAPI max 300).
+#define KIN_MIN_ACCEL 100			// Gentlest wheel acceleration kin_drive() commands (steps/sec^2).
+#define KIN_MAX_ACCEL 800			// Hardest wheel acceleration kin_drive() commands (steps/sec^2).
+#define KIN_MAX_SLEW 100			// Largest change kin_drive() makes to a wheel's sent speed (steps/sec).
+#define EXPLORE_SPEED 250			// explore() cruising speed (steps/sec).
+#define EXPLORE_ACCEL 400			// explore() acceleration (steps/sec^2).
+#define PR_FOLLOW_ACCEL 400			// light_follow() acceleration (steps/sec^2).
+#define ACT_UPDATE_MS 20			// Shortest time between act()'s stepper commands (50/sec).
+#define HOME_KP 420					// light_home() proportional gain (Q8, deg/sec per error unit).
+#define HOME_KI 16					// light_home() integral gain (Q8, per PR_SENSE_MS sample).
+#define HOME_KD 256					// light_home() derivative gain (Q8, per PR_SENSE_MS sample).
+#define HOME_D_SHIFT 1				// light_home() derivative filter, 2^1 = 2 samples.
+#define HOME_I_MAX 2000				// light_home() integral clamp (error units x samples).
+#define HOME_W_MAX 180				// light_home() fastest turn (deg/sec).
+#define HOME_V_FAR 300				// light_home() speed at the dimmest light it homes on (steps/sec, <= KIN_MAX_SPEED).
+#define HOME_V_NEAR 250				// light_home() speed at PR_SUM_MAX and brighter (steps/sec).
+#define SEARCH_SCAN_W 90			// light_search() scan turn rate (deg/sec).
+#define SEARCH_HEAD_TOL 910			// light_search() heading tolerance (5 degrees, 65536 = one turn).
+#define SEARCH_HEAD_W_MIN 20		// light_search() slowest turn onto the bearing (deg/sec).
+#define SEARCH_SPEED 300			// light_search() spiral speed (steps/sec).
+#define SEARCH_GO_MS 2000			// light_search() straight leg toward the bearing.
+#define SEARCH_SPIRAL_W0 90			// light_search() spiral turn rate at its start (deg/sec).
+#define SEARCH_SPIRAL_T_MS 2000		// light_search() spiral opening time constant (turn rate halves).
+#define SEARCH_SPIRAL_MS 10000		// light_search() spiral leg, then scan again.
+#define SEARCH_RESUME_MS 250		// light_search() interrupted longer than this restarts a scan.
+#define SEARCH_ACCEL 400			// light_search() acceleration (steps/sec^2).
+#define PANO_SERVO RC_SERVO0		// ATtiny servo output carrying the panorama photoresistor.
+#define PANO_ARC_DEG 180			// Panorama sweep, centred straight ahead (degrees).
+#define PANO_STEPS 19				// Readings per sweep (10 degrees apart over 180).
+#define PANO_STEP_MS 30				// pano_sense() period: servo settling time per step.
+#define PANO_POS_PER_90 127			// Servo position counts per 90 degrees (measure on the servo).
+#define PANO_FILTER_SHIFT 2			// Panorama channel filter length, 2^2 = 4 scans (8ms).
+#define PANO_CONTRAST_MIN 40		// Brightest minus dimmest reading that counts as a light (counts).
+#define CALIB_EEPROM_ADDR 0			// EEPROM address of the calibration record.
+#define CALIB_GAIN_ONE 256			// Photoresistor gain of 1.0 (Q8).
+
+// Desc: Arbiter input bits.  A sense task sets its bit when its data
+//       changes; a behavior lists the bits it reads.  0x80 is reserved.
+#define SENSE_IR	0x01			// left_IR / right_IR.
+#define SENSE_PR	0x02			// left_PR / right_PR.
+#define SENSE_RANGE	0x04			// range_cm.
+#define SENSE_POSE	0x08			// pose.
+#define SENSE_PANO	0x10			// pano_bearing / pano_peak / pano_floor.
+#define ARB_PENDING_FIRST	0x80	// Set only until a behavior's first run.
+
+// Desc: What differs between two actions (action_changes()).  act() sends
+//       only the stepper commands the changed fields need.
+#define ACT_CHG_STATE	0x01			// state.
+#define ACT_CHG_SPEED	0x02			// speed_L / speed_R (STEPPER_runn()).
+#define ACT_CHG_ACCEL	0x04			// accel_L / accel_R (STEPPER_set_accel2()).
+#define ACT_CHG_MOTORS	( ACT_CHG_SPEED | ACT_CHG_ACCEL )
+
+// Desc: Arbiter behavior flags.
+#define ARB_RUN_WHILE_ACTIVE	0x01	// Re-run every pass while active, even
+										// with no new input (maneuvers in progress).
+
+// Desc: Telemetry frame layout (see telemetry.c and sim/teledecode.c).  All
+//       multi-byte fields are little-endian.  The bytes from TLM_OFS_SEQ
+//       through TLM_OFS_CHECK sum to 0 (mod 256).
+#define TLM_SYNC0			0xA5	// Frame header, first byte.
+#define TLM_SYNC1			0x5A	// Frame header, second byte.
+#define TLM_OFS_SYNC		0		// 2 bytes: TLM_SYNC0, TLM_SYNC1.
+#define TLM_OFS_SEQ			2		// 1 byte:  frame sequence number.
+#define TLM_OFS_STATE		3		// 1 byte:  ROBOT_STATE of the action.
+#define TLM_OFS_T_MS		4		// 4 bytes: ms since the stream was opened.
+#define TLM_OFS_LEFT_PR		8		// 2 bytes: left photoresistor (counts).
+#define TLM_OFS_RIGHT_PR	10		// 2 bytes: right photoresistor (counts).
+#define TLM_OFS_USONIC		12		// 2 bytes: ultrasonic range (cm).
+#define TLM_OFS_IR			14		// 1 byte:  TLM_IR_* bits.
+#define TLM_OFS_SPEED_L		15		// 2 bytes: commanded left speed (signed).
+#define TLM_OFS_SPEED_R		17		// 2 bytes: commanded right speed (signed).
+#define TLM_OFS_X_CM		19		// 2 bytes: odometry x (cm, signed).
+#define TLM_OFS_Y_CM		21		// 2 bytes: odometry y (cm, signed).
+#define TLM_OFS_HEADING		23		// 2 bytes: odometry heading (65536 = one turn).
+#define TLM_OFS_STACK		25		// 2 bytes: stack headroom (bytes never used).
+#define TLM_OFS_CHECK		27		// 1 byte:  checksum.
+#define TLM_FRAME_SIZE		28		// Bytes per frame.
+#define TLM_IR_LEFT			0x01	// Left IR tripped.
+#define TLM_IR_RIGHT		0x02	// Right IR tripped.
+
+// Desc: On-board SPI flash (4 Mbit, JEDEC command set, e.g. AT25DF041A) and
+//       the commands the flight recorder uses.
+#define SPIFLASH_SIZE			0x80000UL	// Bytes.
+#define SPIFLASH_PAGE_SIZE		256			// Program never crosses a page.
+#define SPIFLASH_SECTOR_SIZE	4096UL		// Smallest erase.
+#define SPIFLASH_SECTORS		128			// SPIFLASH_SIZE / SPIFLASH_SECTOR_SIZE.
+#define SPIFLASH_CMD_WRSR		0x01		// Write status (0 = unprotect all).
+#define SPIFLASH_CMD_PROGRAM	0x02		// Page program.
+#define SPIFLASH_CMD_READ		0x03		// Read (any length, any address).
+#define SPIFLASH_CMD_RDSR		0x05		// Read status.
+#define SPIFLASH_CMD_WREN		0x06		// Write enable (before program/erase).
+#define SPIFLASH_CMD_ERASE_4K	0x20		// Sector erase.
+#define SPIFLASH_CMD_JEDEC_ID	0x9F		// Manufacturer and device ID.
+#define SPIFLASH_SR_BUSY		0x01		// Status: program/erase in progress.
+
+// Desc: Flight recorder sector header, at the start of every sector it
+//       writes (frames follow in the TLM_* layout above).  The bytes from
+//       FR_OFS_RUN through FR_OFS_CHECK sum to 0 (mod 256).
+#define FR_SYNC0			0xA5	// Header, first byte (as TLM_SYNC0).
+#define FR_SYNC1			0xC3	// Header, second byte.
+#define FR_OFS_SYNC			0		// 2 bytes: FR_SYNC0, FR_SYNC1.
+#define FR_OFS_RUN			2		// 2 bytes: run (power-on) number.
+#define FR_OFS_LAP			4		// 4 bytes: sectors written before this one, ever.
+#define FR_OFS_CHECK		8		// 1 byte:  checksum.
+#define FR_HEADER_SIZE		9		// Bytes per header.
+
+// Desc: ATTINY_get_sensors() bits (SNSR_* in tiny324v221.h).  The state bits
+//       are levels; the edge bits are set once per press.  A switch's bits
+//       sit one place lower for each step of ATTINY_SW (SW3, SW4, SW5).
+#define TINY_STATE_MASK		( SNSR_IR_LEFT | SNSR_IR_RIGHT | SNSR_SW3 | SNSR_SW4 | SNSR_SW5 )
+#define TINY_SW_EDGE_MASK	( SNSR_SW3_EDGE | SNSR_SW4_EDGE | SNSR_SW5_EDGE )
+#define TINY_SW_STATE( which )	( SNSR_SW3 >> ( which ) )
+#define TINY_SW_EDGE( which )	( SNSR_SW3_EDGE >> ( which ) )
+
+// Desc: Ultrasonic sensor line (PA3, the pin USONIC_ping() drives) and its
+//       pin-change interrupt.  RANGE_TICKS_TO_CM() turns a round-trip echo in
+//       10us stopwatch ticks into cm: 343 m/s / 2 = 0.1715 cm per tick,
+//       ~353/2048 in integer math.
+#define RANGE_PORT			PORTA
+#define RANGE_DDR			DDRA
+#define RANGE_PIN			PINA
+#define RANGE_BIT			PA3
+#define RANGE_PCMSK			PCMSK0
+#define RANGE_PCINT			PCINT3
+#define RANGE_TICKS_TO_CM( ticks )	( ( unsigned short int )( ( ( unsigned long int )( ticks ) * 353UL ) >> 11 ) )
+
+// Desc: These macro-functions instrument the arbitration loop.  They cost one
+//       stopwatch read each, and vanish entirely when PROFILE_ENABLED is 0.
+#if PROFILE_ENABLED
+#define PROFILE_LOOP_START()	profile_loop_start()
+#define PROFILE_MARK( section )	profile_mark( section )
+#else
+#define PROFILE_LOOP_START()
+#define PROFILE_MARK( section )
+#endif
+
+// Desc: Light homing controller: 1 = the PID light_home(), 0 = the original
+//       light_follow().  The simulator's homebench builds it both ways.
+#ifndef PR_HOMING_PID
+#define PR_HOMING_PID 1
+#endif
+
+// Desc: Servo-swept light panorama (panorama.c): 1 = a photoresistor on
+//       PANO_SERVO and pano_pr_channel, which light_search() uses instead of
+//       spinning the chassis; 0 = no panorama hardware.  The simulator's
+//       cbotsim-pano builds it with 1.
+#ifndef PANO_ENABLED
+#define PANO_ENABLED 0
+#endif
+
+// Desc: Painted SRAM (stack.c): from the end of .bss/.noinit (where the heap
+//       starts) to RAMEND, with the heap top as malloc() leaves it (NULL
+//       until the first malloc()).  stack_paint() goes in .init3, after the
+//       C runtime sets SP and before it fills .data and .bss.  The
+//       simulator's stand-in CAPI header supplies host versions.
+#ifndef STACK_SRAM_FREE
+#define STACK_SRAM_FREE		( &__heap_start )
+#define STACK_SRAM_END		( ( unsigned char * ) RAMEND )
+#define STACK_HEAP_END		( ( unsigned char * ) __brkval )
+#define STACK_PAINT_ATTR	__attribute__( ( naked, used, section( ".init3" ) ) )
+#endif
+
+// Desc: light_follow tests normalized photoresistor counts: the spin scan
+//       (calibrate_pr()) maps each sensor's darkest reading to 0 and its
+//       brightest to PR_NORM_SPAN, so the same limits hold in any room:
+//           average > 1/8 span   <=>  nL + nR >  PR_SUM_MIN  (128)
+//           average < 7/4 span   <=>  nL + nR <  PR_SUM_MAX  (1792)
+//           |L - R| > 1/4 span   <=>  |nL - nR| > PR_DIFF_MIN (128)
+//       (The lamp gets brighter than at calibration as CEENBoT closes in,
+//       hence the headroom above one span.)
+#define PR_SUM_MIN		( 2 * PR_NORM_SPAN / 8 )
+#define PR_SUM_MAX		( 2 * PR_NORM_SPAN * 7 / 4 )
+#define PR_DIFF_MIN		( PR_NORM_SPAN / 4 )
+
+// Desc: Volts * gain in steps/sec, from raw counts: counts * 5 * gain / 1024,
+//       truncated.  And counts to millivolts (truncated) for display.
+#define PR_SPEED( counts, gain )	( ( signed short int )( ( ( counts ) * ( 5UL * ( gain ) ) ) >> 10 ) )
+#define PR_MILLIVOLTS( counts )		( ( unsigned int )( ( ( counts ) * 5000UL ) >> 10 ) )
+
+// Desc: Odometry geometry.  An in-place turn of DEG_90 steps per wheel is a
+//       quarter turn, so a full turn is a left/right difference of
+//       8 * DEG_90 steps: one Q8 step of difference is 2^32 / ( 8 * DEG_90
+//       * 256 ) units of the 32-bit heading.  ODOM_Q8_TO_CM() converts a
+//       pose coordinate to cm (to +/-32767).
+#define ODOM_BRAD32_PER_Q8		( ( 1UL << 21 ) / DEG_90 )
+#define ODOM_Q8_TO_CM( q8 )		( ( signed short int )( ( ( q8 ) >> 4 ) * ODOM_STEP_UM / 160000L ) )
+
+// Desc: These macro-functions build arbiter table entries (see arbiter.c).
+//       A sense entry samples every 'period_ms' and sets 'input' on change;
+//       a behavior entry re-runs when one of 'inputs' changes; a task entry
+//       is resumed every pass and sees 'inputs' as events.
+#define ARB_SENSE( func, period_ms, input, section ) \
+	{ ( func ), NULL, NULL, ( period_ms ), ( input ), 0, ( section ) }
+#define ARB_BEHAVIOR( func, inputs, flags, section ) \
+	{ NULL, ( func ), NULL, 0, ( inputs ), ( flags ), ( section ) }
+#define ARB_TASK( func, inputs, section ) \
+	{ NULL, NULL, ( func ), 0, ( inputs ), 0, ( section ) }
+#define ARBITER_COUNT( table )	( sizeof( table ) / sizeof( ( table )[ 0 ] ) )
 
 // Desc: This macro-function can be used to reset a motor-action structure
 //       easily.  It is a helper macro-function.
@@ -69,9 +325,27 @@ typedef enum ROBOT_STATE_TYPE {
 	EXPLORING,		// 'Exploring' = 1		state -- the robot is 'roaming around'.
 	LIGHT_FOLLOW,	// 'Light Follow" = 2	state -- the robot is following a light.
 //	LIGHT_OBSERVE,	// 'Light Observe" = 3	state -- the robot is stopping at a light.
-	AVOIDING		// 'Avoiding' = 4		state -- the robot is avoiding a collision.
+	AVOIDING,		// 'Avoiding' = 4		state -- the robot is avoiding a collision.
+	SEARCHING		// 'Searching'			state -- the robot is looking for a light.
 } ROBOT_STATE;
 
+// Desc: Legs of the light_search() pattern.
+typedef enum SEARCH_PHASE_TYPE {
+	SEARCH_IDLE = 0,	// Not started.
+	SEARCH_SCAN,		// Turning in place, recording brightness.
+	SEARCH_HEAD,		// Turning onto the brightest bearing.
+	SEARCH_GO,			// explore() driving straight along it.
+	SEARCH_SPIRAL		// Driving an opening spiral.
+} SEARCH_PHASE;
+
+// Desc: Where the ultrasonic measurement in flight is (see range.c).
+typedef enum RANGE_STATE_TYPE {
+	RANGE_IDLE = 0,		// No ping sent yet.
+	RANGE_WAIT_ECHO,	// Ping sent, echo line still low.
+	RANGE_ECHO,			// Echo line high, timing it.
+	RANGE_DONE			// Echo timed; width is ready.
+} RANGE_STATE;
+
 // Desc: Structure encapsulates a 'motor' action. It contains parameters that
 //       controls the motors 'down the line' with information depicting the
 //       current state of the robot.  The 'state' variable is useful to
@@ -85,6 +359,15 @@ typedef struct MOTOR_ACTION_TYPE {
 	unsigned short int accel_R;     // ACCELERATION for RIGHT motor.
 } MOTOR_ACTION;
 
+// Desc: Dead-reckoned pose (see odometry.c), from where the loop started.
+//       x runs along the starting heading and y to its left; heading is
+//       counter-clockwise from the starting heading.
+typedef struct POSE_TYPE {
+	signed long int x_q8;			// x, in 1/256 wheel steps.
+	signed long int y_q8;			// y, in 1/256 wheel steps.
+	unsigned short int heading;		// Heading (65536 = one turn).
+} POSE;
+
 // Desc: Structure encapsulates 'sensed' data.  Right now that only consists
 //       of the state of the left & right IR sensors when queried.  You can
 //       expand this structure and add additional custom fields as needed.
@@ -94,8 +377,202 @@ typedef struct SENSOR_DATA_TYPE {
 	unsigned int left_PR;		// Holds the voltage of the left photo resistor.
 	unsigned int right_PR;		// Holds the voltage of the right photo resistor.
 	unsigned int PR_delta_LR;	// Holds the voltage difference of the right pr - left pr.
+	unsigned short int range_cm;	// Median-filtered ultrasonic range (RANGE_MAX_CM if clear).
+	POSE pose;					// Dead-reckoned pose.
+	unsigned short int pano_bearing;	// Heading (as pose.heading) of the brightest point of the last sweep.
+	unsigned short int pano_peak;	// Its reading (raw ADC counts).
+	unsigned short int pano_floor;	// Dimmest reading of the last sweep (raw ADC counts).
+	unsigned char pano_sweeps;	// Sweeps finished (wraps).
+	unsigned short int stack_free;	// SRAM bytes never used by the stack or heap.
 } SENSOR_DATA;
 
+// Desc: Filters the ADC scan can run on a channel (see adc_filter.c).
+typedef enum ADC_FILTER_MODE_TYPE {
+	ADC_FILTER_NONE = 0,	// Pass raw samples through.
+	ADC_FILTER_OVERSAMPLE,	// Mean of each block of N, held until the next block.
+	ADC_FILTER_MOVING_AVG,	// Mean of the last N samples.
+	ADC_FILTER_IIR			// y += ( x - y ) / N.
+} ADC_FILTER_MODE;
+
+// Desc: State of one channel filter.  N = 2^shift throughout.
+typedef struct ADC_FILTER_TYPE {
+	ADC_FILTER_MODE mode;					// Which filter.
+	unsigned char shift;					// log2 of the length N.
+	unsigned char index;					// Samples in block / oldest tap.
+	BOOL primed;							// FALSE until the first sample.
+	unsigned short int acc;					// Block sum / window sum / y * N.
+	ADC_SAMPLE out;							// Latest output.
+	ADC_SAMPLE taps[ ADC_FILTER_MAX_TAPS ];	// Moving-average window.
+} ADC_FILTER;
+
+// Desc: One complete ADC scan, copied out of the scan engine.  'sample' is
+//       indexed by channel number; channels not in the scan list read 0.
+typedef struct ADC_SNAPSHOT_TYPE {
+	unsigned char sequence;					// Scan number (wraps at 256).
+	ADC_SAMPLE sample[ ADC_SCAN_NCHANS ];	// 10-bit result per channel.
+} ADC_SNAPSHOT;
+
+// Desc: Sections of the arbitration loop timed by the profiler.  PROF_LOOP
+//       is the full cycle; the rest are the calls made inside it, in order.
+typedef enum PROFILE_SECTION_TYPE {
+	PROF_LOOP = 0,			// Full loop cycle (top to top).
+	PROF_IR_SENSE,			// IR_sense().
+	PROF_PR_SENSE,			// PR_sense().
+	PROF_RANGE_SENSE,		// range_sense().
+	PROF_ODOM_SENSE,		// odom_sense().
+	PROF_PANO_SENSE,		// pano_sense().
+	PROF_STACK_SENSE,		// stack_sense().
+	PROF_EXPLORE,			// explore().
+	PROF_LIGHT_FOLLOW,		// light_follow().
+	PROF_IR_AVOID,			// IR_avoid().
+	PROF_SEARCH,			// light_search().
+	PROF_SLOWDOWN,			// range_slowdown().
+	PROF_ACT,				// act().
+	PROF_INFO_DISPLAY,		// info_display().
+	PROF_LCD,				// lcd_shadow_flush().
+	PROF_TELEMETRY,			// telemetry_task().
+	PROF_FLIGHTREC,			// flightrec_task().
+	PROF_COUNT				// Number of sections (not a section).
+} PROFILE_SECTION;
+
+// Desc: Timing statistics for one section, in 10us stopwatch ticks.
+typedef struct PROFILE_STATS_TYPE {
+	SWTIME min;					// Shortest interval seen.
+	SWTIME max;					// Longest interval seen.
+	unsigned long int sum;		// Sum of intervals (for the mean).
+	unsigned short int count;	// Number of intervals in 'sum'.
+} PROFILE_STATS;
+
+
+// Desc: Arbiter function types.  A sense task returns TRUE when the data it
+//       owns changed.  A behavior that wants control sets pAction->state
+//       (to anything but STARTUP) and every speed/accel field.
+typedef BOOL ( *ARBITER_SENSE_FUNC )( volatile SENSOR_DATA *pSensors );
+typedef void ( *ARBITER_BEHAVIOR_FUNC )( volatile MOTOR_ACTION *pAction,
+	volatile SENSOR_DATA *pSensors );
+
+// Desc: Protothread state: all a task keeps between resumptions (see
+//       the PT_* macro-functions).
+typedef struct PT_TYPE {
+	unsigned short int line;		// Where to resume (0 = from the top).
+	unsigned short int t_ms;		// PT_WAIT_MS(): when the wait started.
+	unsigned char events;			// Arbiter inputs that changed, not yet waited for.
+} PT;
+
+// Desc: These macro-functions write a task as straight-line code that
+//       gives the loop back wherever it waits (stackless coroutines, after
+//       Dunkels' protothreads).  A task body is PT_BEGIN() ... PT_END();
+//       each wait records its line and returns, and the next call jumps
+//       straight back to it.  Rules: locals do NOT survive a wait (use
+//       statics), at most one wait per source line, and no waits inside a
+//       switch() of the task's own.
+#define PT_WAITING	0				// Returns: blocked on a wait.
+#define PT_YIELDED	1				// Gave the loop back for one pass.
+#define PT_EXITED	2				// PT_EXIT(): restarts from the top next time.
+#define PT_ENDED	3				// Ran off PT_END(): likewise.
+#if defined( __GNUC__ ) && ( __GNUC__ >= 7 )
+#define PT_FALLTHROUGH	__attribute__( ( fallthrough ) )	// Into a resume label.
+#else
+#define PT_FALLTHROUGH						// avr-gcc 5.4 has no such attribute.
+#endif
+#define PT_INIT( pt ) \
+	do { ( pt )->line = 0; ( pt )->events = 0; } while( 0 )
+#define PT_BEGIN( pt ) \
+	switch( ( pt )->line ) { case 0:
+#define PT_END( pt ) \
+	} ( pt )->line = 0; return PT_ENDED
+#define PT_WAIT_UNTIL( pt, condition ) \
+	do { ( pt )->line = __LINE__; PT_FALLTHROUGH; case __LINE__: \
+		if( !( condition ) ) return PT_WAITING; } while( 0 )
+#define PT_WAIT_WHILE( pt, condition )	PT_WAIT_UNTIL( pt, !( condition ) )
+#define PT_YIELD( pt ) \
+	do { ( pt )->line = __LINE__; return PT_YIELDED; case __LINE__: ; } while( 0 )
+#define PT_WAIT_MS( pt, ms ) \
+	do { ( pt )->t_ms = arbiter_now(); \
+		PT_WAIT_UNTIL( pt, ( unsigned short int )( arbiter_now() - ( pt )->t_ms ) >= ( ms ) ); } while( 0 )
+#define PT_WAIT_EVENT( pt, mask ) \
+	do { PT_WAIT_UNTIL( pt, ( ( pt )->events & ( mask ) ) != 0 ); \
+		( pt )->events &= ~( mask ); } while( 0 )
+#define PT_EXIT( pt ) \
+	do { ( pt )->line = 0; return PT_EXITED; } while( 0 )
+
+// Desc: Arbiter task type: a protothread resumed every pass (see the
+//       PT_* macro-functions).  Returns PT_WAITING/YIELDED/EXITED/ENDED.
+typedef char ( *ARBITER_TASK_FUNC )( PT *pt, volatile MOTOR_ACTION *pAction,
+	volatile SENSOR_DATA *pSensors );
+
+// Desc: One arbiter table entry, kept in flash.  Exactly one of 'sense',
+//       'behave' and 'task' is set.
+typedef struct ARBITER_ENTRY_TYPE {
+	ARBITER_SENSE_FUNC sense;		// Sense task, or NULL.
+	ARBITER_BEHAVIOR_FUNC behave;	// Behavior, or NULL.
+	ARBITER_TASK_FUNC task;			// Task, or NULL.
+	TIMER16 period_ms;				// Sense: time between samples.
+	unsigned char inputs;			// Sense: bit it sets; behavior/task: bits it reads.
+	unsigned char flags;			// Behavior: ARB_* flags.
+	PROFILE_SECTION section;		// Profiler section charged for the call.
+} ARBITER_ENTRY;
+
+// Desc: RAM the arbiter keeps per table entry.  A task keeps its
+//       protothread where a behavior keeps its proposal.
+typedef struct ARBITER_SLOT_TYPE {
+	unsigned short int due_ms;		// Sense: when it runs next.
+	unsigned char pending;			// Behavior/task: input bits changed since it ran.
+	union {
+		MOTOR_ACTION proposal;		// Behavior: what it asked for last time.
+		PT pt;						// Task: where it is waiting.
+	};
+} ARBITER_SLOT;
+
+// Desc: Calibration record, stored in EEPROM and kept in RAM as 'calib'.
+//       The photoresistor correction is ( raw - offset ) * gain / 256,
+//       filled in by the spin scan; the rest replace the #defines of the
+//       same names at run time.
+typedef struct CALIB_RECORD_TYPE {
+	unsigned char version;					// CALIB_VERSION.
+	unsigned char size;						// sizeof( CALIB_RECORD ).
+	unsigned short int PR_delta_LR;			// Left - right at calibration (counts).
+	signed short int PR_offset_L;			// Left photoresistor offset (counts).
+	signed short int PR_offset_R;			// Right photoresistor offset (counts).
+	unsigned short int PR_gain_L;			// Left photoresistor gain (Q8).
+	unsigned short int PR_gain_R;			// Right photoresistor gain (Q8).
+	unsigned short int PR_gain_slow;		// As PR_GAIN_SLOW.
+	unsigned short int PR_gain_fast;		// As PR_GAIN_FAST.
+	unsigned short int avoid_speed;			// As AVOID_SPEED.
+	unsigned short int avoid_backup_steps;	// As AVOID_BACKUP_STEPS.
+	unsigned short int range_slow_cm;		// As RANGE_SLOW_CM.
+	unsigned short int range_stop_cm;		// As RANGE_STOP_CM.
+	unsigned short int crc;					// CRC-16 of all fields above.
+} CALIB_RECORD;
+
+// Desc: Fixed-point PID controller (see pid.c): gains, then history.
+typedef struct PID_STATE_TYPE {
+	signed short int kp;			// Proportional gain (Q8).
+	signed short int ki;			// Integral gain (Q8).
+	signed short int kd;			// Derivative gain (Q8).
+	unsigned char d_shift;			// Derivative filter time constant, 2^d_shift samples.
+	signed long int i_max;			// Integral clamp (error x samples).
+	signed short int out_max;		// Output clamp.
+	signed long int integral;		// Sum of the errors.
+	signed short int last;			// Previous error.
+	signed long int d_filt;			// Filtered error change (Q4).
+	BOOL primed;					// TRUE once 'last' is valid.
+} PID_STATE;
+
+// Desc: Text being built by the fmt_*() calls (see fmt.c).  Always
+//       NUL-terminated; appends past size - 1 characters are dropped.
+typedef struct FMT_BUF_TYPE {
+	char *pText;					// Where the text goes.
+	unsigned char size;				// Bytes at pText, including the NUL.
+	unsigned char len;				// Characters so far.
+} FMT_BUF;
+
+//===============================================================================
+//= What:	Globals shared between files.										=
+//===============================================================================
+extern CALIB_RECORD calib;		// Contained in calib.c.
+extern unsigned char __heap_start;	// avr-libc: first byte after .bss/.noinit.
+extern char *__brkval;				// avr-libc: heap top (NULL before malloc()).
 
 //===============================================================================
 //= What:	Prototypes.															=
@@ -104,24 +581,131 @@ typedef struct SENSOR_DATA_TYPE {
 //= Notes:	Listed in order of appearance in code (CBOT_main not included).		=
 //===============================================================================
 
+// Contained in adc_filter.c
+void adc_filter_init( ADC_FILTER *pFilter, ADC_FILTER_MODE mode, unsigned char shift );
+ADC_SAMPLE adc_filter_update( ADC_FILTER *pFilter, ADC_SAMPLE sample );
+
+// Contained in adc_scan.c
+void adc_scan_set_filter( ADC_CHAN which, ADC_FILTER *pFilter );
+void adc_scan_open( const ADC_CHAN *pChannels, unsigned char count, TIMER16 period_ms );
+ADC_SAMPLE adc_scan_get( ADC_CHAN which );
+void adc_scan_snapshot( ADC_SNAPSHOT *pSnapshot );
+unsigned char adc_scan_seq( void );
+
+// Contained in arbiter.c
+void arbiter_open( const ARBITER_ENTRY *pTable, unsigned char count );
+void arbiter_run( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+unsigned short int arbiter_now( void );
+
+// Contained in calib.c
+void calib_defaults( void );
+BOOL calib_load( void );
+void calib_save( void );
+BOOL calib_open( volatile SENSOR_DATA *pSensors );
+
 // Contained in convenience.c
 void act( volatile MOTOR_ACTION *pAction );
+void act_invalidate( void );
 void open_modules( void );
 void info_display( volatile MOTOR_ACTION *pAction );
-BOOL compare_actions( volatile MOTOR_ACTION *a, volatile MOTOR_ACTION *b );
+unsigned char action_changes( volatile MOTOR_ACTION *a, volatile MOTOR_ACTION *b );
+void command_service( volatile SENSOR_DATA *pSensors );
+char drive_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+char display_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
 
 // Contained in explore.c
-void explore( volatile MOTOR_ACTION *pAction );
+void explore( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+
+// Contained in flightrec.c
+BOOL flightrec_open( void );
+char flightrec_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+void flightrec_dump( void );
+unsigned short int flightrec_dropped( void );
+
+// Contained in fmt.c
+void fmt_open( FMT_BUF *pBuf, char *pText, unsigned char size );
+void fmt_char( FMT_BUF *pBuf, char c );
+void fmt_str( FMT_BUF *pBuf, const char *pText, unsigned char width );
+void fmt_str_P( FMT_BUF *pBuf, PGM_P pText, unsigned char width );
+void fmt_uint( FMT_BUF *pBuf, unsigned long int value, unsigned char width, char pad );
+void fmt_int( FMT_BUF *pBuf, signed long int value, unsigned char width );
+void fmt_fixed( FMT_BUF *pBuf, signed long int value, unsigned char decimals, unsigned char width );
+void fmt_hex( FMT_BUF *pBuf, unsigned long int value, unsigned char digits );
+void fmt_uart( FMT_BUF *pBuf );
+void fmt_uart_P( PGM_P pText );
+void fmt_lcd_RC( unsigned char row, unsigned char col, const char *pText );
 
 // Contained in ir_behaviors.c
-void IR_sense( volatile SENSOR_DATA *pSensors, TIMER16 interval_ms );
+BOOL IR_sense( volatile SENSOR_DATA *pSensors );
 void IR_avoid( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
 
+// Contained in kinematics.c
+void kin_drive( volatile MOTOR_ACTION *pAction, signed short int v, signed short int w,
+	unsigned short int accel );
+void kin_command( signed short int speed_L, signed short int speed_R );
+
+// Contained in lcd_shadow.c
+void lcd_shadow_open( void );
+void lcd_shadow_clear( void );
+void lcd_shadow_puts_RC( unsigned char row, unsigned char col, const char *pText );
+unsigned char lcd_shadow_flush( unsigned char budget );
+
+// Contained in odometry.c
+void odom_open( volatile SENSOR_DATA *pSensors );
+void odom_command( volatile MOTOR_ACTION *pAction );
+BOOL odom_sense( volatile SENSOR_DATA *pSensors );
+
+// Contained in panorama.c
+void pano_open( void );
+BOOL pano_sense( volatile SENSOR_DATA *pSensors );
+unsigned short int pano_get( unsigned char step );
+
+// Contained in pid.c
+void pid_reset( PID_STATE *pPid );
+signed short int pid_update( PID_STATE *pPid, signed short int error );
+
 // Contained in pr_behaviors.c
+void PR_filter_open( void );
 void calibrate_pr( volatile SENSOR_DATA *pSensors );
 void get_PR_diff( volatile SENSOR_DATA *pSensors );
-void PR_sense ( volatile SENSOR_DATA *pSensors, TIMER16 interval_ms );
+BOOL PR_sense ( volatile SENSOR_DATA *pSensors );
 void light_follow ( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+void light_home( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+unsigned short int PR_normalize( unsigned short int raw, signed short int offset,
+	unsigned short int gain );
 void light_observe ( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
 
+// Contained in profiler.c
+void profile_loop_start( void );
+void profile_mark( PROFILE_SECTION section );
+void profile_reset( void );
+void profile_report( void );
+
+// Contained in range.c
+void range_open( void );
+BOOL range_sense( volatile SENSOR_DATA *pSensors );
+void range_slowdown( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+
+// Contained in search.c
+void light_search( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+
+// Contained in stack.c
+void stack_paint( void ) STACK_PAINT_ATTR;
+BOOL stack_sense( volatile SENSOR_DATA *pSensors );
+unsigned short int stack_headroom( void );
+
+// Contained in telemetry.c
+void telemetry_pack( unsigned char *pFrame, unsigned char sequence, unsigned long int t_ms,
+	volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+void telemetry_open( TIMER16 period_ms );
+char telemetry_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors );
+void telemetry_flush( void );
+unsigned short int telemetry_dropped( void );
+
+// Contained in tiny_sense.c
+BOOL tiny_sense_update( void );
+BOOL tiny_sense_IR( ATTINY_IR which );
+BOOL tiny_sense_SW( ATTINY_SW which );
+BOOL tiny_sense_SW_pressed( ATTINY_SW which );
+
 #endif // __ECEN3450Lab06_H__
\ No newline at end of file
@@ -0,0 +1,111 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	adc_filter.c													=
+//= Desc:		Per-channel integer filters for ADC samples: block				=
+//=				oversampling with decimation, moving average, and first-order	=
+//=				IIR.  Each new sample costs O(1) whatever the length.			=
+//= Functions:	adc_filter_init(), adc_filter_update()							=
+//= Other:		Lengths are powers of two ('shift'), so every divide is a		=
+//=				shift.  Output stays in 10-bit counts, like a raw sample.		=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	adc_filter_init()													=
+//= Why:	Sets up a filter before it is attached to a channel.				=
+//= Desc:	'shift' sets the length N = 2^shift: the block size for				=
+//=			ADC_FILTER_OVERSAMPLE, the window for ADC_FILTER_MOVING_AVG, and	=
+//=			the time constant (alpha = 1/N) for ADC_FILTER_IIR.  It is			=
+//=			clamped so every sum fits in 16 bits.								=
+//= Return:	void.																=
+//= Params:	ADC_FILTER *pFilter (filter to set up)								=
+//=			ADC_FILTER_MODE mode (which filter)									=
+//=			unsigned char shift (log2 of the length)							=
+//= Notes:	The first sample primes the state, so there is no ramp up from 0.	=
+//===============================================================================
+void adc_filter_init( ADC_FILTER *pFilter, ADC_FILTER_MODE mode, unsigned char shift )
+{
+	unsigned char max_shift = ( mode == ADC_FILTER_MOVING_AVG ) ?
+		ADC_FILTER_MAX_TAPS_SHIFT : ADC_FILTER_MAX_SHIFT;
+
+	pFilter->mode = mode;
+	pFilter->shift = ( shift > max_shift ) ? max_shift : shift;
+	pFilter->index = 0;
+	pFilter->primed = FALSE;
+	pFilter->acc = 0;
+	pFilter->out = 0;
+} // end adc_filter_init()
+
+//===============================================================================
+//= What:	adc_filter_update()													=
+//= Why:	Feeds one raw sample through the filter.							=
+//= Desc:	OVERSAMPLE sums N samples and outputs their rounded mean once per	=
+//=			block, holding it in between.  MOVING_AVG keeps a running sum of	=
+//=			the last N samples.  IIR keeps y * N and adds x - y each sample.	=
+//= Return:	ADC_SAMPLE (filtered value, 10-bit counts).							=
+//= Params:	ADC_FILTER *pFilter (filter state)									=
+//=			ADC_SAMPLE sample (raw 10-bit sample)								=
+//= Notes:	Called from the ADC ISR; keep it short.								=
+//===============================================================================
+ADC_SAMPLE adc_filter_update( ADC_FILTER *pFilter, ADC_SAMPLE sample )
+{
+	unsigned char n = 1 << pFilter->shift;
+	unsigned char i;
+
+	// First sample: start every mode out settled on it.
+	if( pFilter->primed == FALSE )
+	{
+		pFilter->primed = TRUE;
+		pFilter->out = sample;
+
+		if( pFilter->mode == ADC_FILTER_MOVING_AVG )
+		{
+			for( i = 0; i < n; i++ )
+				pFilter->taps[ i ] = sample;
+			pFilter->acc = sample << pFilter->shift;
+		}
+		else if( pFilter->mode == ADC_FILTER_IIR )
+			pFilter->acc = sample << pFilter->shift;
+
+		return pFilter->out;
+	}
+
+	switch( pFilter->mode )
+	{
+		case ADC_FILTER_OVERSAMPLE:
+		pFilter->acc += sample;
+		if( ++pFilter->index >= n )
+		{
+			pFilter->out = ( pFilter->acc + ( n >> 1 ) ) >> pFilter->shift;
+			pFilter->acc = 0;
+			pFilter->index = 0;
+		}
+		break;
+
+		case ADC_FILTER_MOVING_AVG:
+		pFilter->acc += sample - pFilter->taps[ pFilter->index ];
+		pFilter->taps[ pFilter->index ] = sample;
+		pFilter->index = ( pFilter->index + 1 ) & ( n - 1 );
+		pFilter->out = ( pFilter->acc + ( n >> 1 ) ) >> pFilter->shift;
+		break;
+
+		case ADC_FILTER_IIR:
+		// acc holds y * N; truncating here keeps a constant input exact.
+		pFilter->acc += sample - ( pFilter->acc >> pFilter->shift );
+		pFilter->out = pFilter->acc >> pFilter->shift;
+		break;
+
+		default:
+		pFilter->out = sample;
+		break;
+	} // end switch()
+
+	return pFilter->out;
+} // end adc_filter_update()
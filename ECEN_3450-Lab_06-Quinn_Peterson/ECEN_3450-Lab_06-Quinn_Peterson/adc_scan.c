@@ -0,0 +1,225 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	adc_scan.c														=
+//= Desc:		Interrupt-driven ADC scan engine.  A timer starts a scan every	=
+//=				period; the ADC complete ISR walks the channel list one			=
+//=				conversion at a time and publishes each finished scan into a	=
+//=				double-buffered snapshot the behaviors read without blocking.	=
+//= Functions:	adc_scan_set_filter(), adc_scan_open(), adc_scan_get(),			=
+//=				adc_scan_snapshot(), adc_scan_seq()								=
+//= Other:		Once the scan is open, nothing else may call ADC_sample() or	=
+//=				touch ADMUX/ADCSRA -- the ISR owns the converter.				=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Channels converted on every scan, in order.
+static ADC_CHAN adc_scan_list[ ADC_SCAN_MAX_CHANNELS ];
+static unsigned char adc_scan_count = 0;
+
+// Position in 'adc_scan_list' of the conversion in progress.
+static volatile unsigned char adc_scan_index;
+
+// TRUE from the start of a scan until it is published.
+static volatile BOOL adc_scan_busy = FALSE;
+
+// Results, indexed by channel number.  Readers use buf[ front ]; the ISR
+// fills buf[ front ^ 1 ] and flips 'front' when the scan is complete.
+static volatile ADC_SAMPLE adc_scan_buf[ 2 ][ ADC_SCAN_NCHANS ];
+static volatile unsigned char adc_scan_front = 0;
+
+// Bumped every time a scan is published.  Readers retry if it moves
+// under them, so they never see a half-written buffer.
+static volatile unsigned char adc_scan_sequence = 0;
+
+// Optional filter per channel; NULL passes raw samples through.
+static ADC_FILTER *adc_scan_filters[ ADC_SCAN_NCHANS ];
+
+// Paces the scans.
+static TIMEROBJ adc_scan_timer;
+
+//===============================================================================
+//= What:	adc_scan_start_conversion()											=
+//= Why:	Points the mux at 'which' and starts one conversion.				=
+//= Return:	void.																=
+//= Params:	ADC_CHAN which (channel to convert)									=
+//= Notes:	Keeps the reference bits ADC_set_VREF() chose.  Called from the		=
+//=			timer notify and the ADC ISR only.									=
+//===============================================================================
+static void adc_scan_start_conversion( ADC_CHAN which )
+{
+	ADMUX = ( ADMUX & ( _BV( REFS1 ) | _BV( REFS0 ) ) ) | ( which & 0x07 );
+	ADCSRA |= _BV( ADIE ) | _BV( ADSC );
+} // end adc_scan_start_conversion()
+
+//===============================================================================
+//= What:	adc_scan_trigger()													=
+//= Why:	Timer notify function: starts a new scan every period.				=
+//= Desc:	If the previous scan is somehow still running it is left alone,		=
+//=			so a slow scan stretches the period instead of being cut short.		=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Runs in the timer service ISR.										=
+//===============================================================================
+static void adc_scan_trigger( void )
+{
+	if( adc_scan_busy == TRUE )
+		return;
+
+	adc_scan_busy = TRUE;
+	adc_scan_index = 0;
+	adc_scan_start_conversion( adc_scan_list[ 0 ] );
+} // end adc_scan_trigger()
+
+//===============================================================================
+//= What:	adc_scan_isr()														=
+//= Why:	ADC conversion complete: filter and store the result, then start	=
+//=			the next one.														=
+//= Desc:	After the last channel the back buffer becomes the front buffer		=
+//=			and the sequence number moves on; the ADC then idles until the		=
+//=			next trigger.														=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Attached to ISR_ADC_VECT.											=
+//===============================================================================
+static CBOT_ISR( adc_scan_isr )
+{
+	unsigned char back = adc_scan_front ^ 1;
+	ADC_CHAN channel = adc_scan_list[ adc_scan_index ];
+	ADC_SAMPLE sample = ADCW;
+
+	if( adc_scan_filters[ channel ] != NULL )
+		sample = adc_filter_update( adc_scan_filters[ channel ], sample );
+
+	adc_scan_buf[ back ][ channel ] = sample;
+
+	if( ++adc_scan_index < adc_scan_count )
+	{
+		adc_scan_start_conversion( adc_scan_list[ adc_scan_index ] );
+		return;
+	}
+
+	// Scan complete -- publish it.
+	adc_scan_front = back;
+	adc_scan_sequence++;
+	adc_scan_busy = FALSE;
+} // end adc_scan_isr()
+
+//===============================================================================
+//= What:	adc_scan_set_filter()												=
+//= Why:	Runs every sample of 'which' through 'pFilter' before it is			=
+//=			published.															=
+//= Return:	void.																=
+//= Params:	ADC_CHAN which (channel to filter)									=
+//=			ADC_FILTER *pFilter (initialized filter, or NULL for raw)			=
+//= Notes:	Call before adc_scan_open(); the ISR reads the pointer unlocked.	=
+//=			'pFilter' must stay alive (static) while the scan runs.				=
+//===============================================================================
+void adc_scan_set_filter( ADC_CHAN which, ADC_FILTER *pFilter )
+{
+	if( which < ADC_SCAN_NCHANS )
+		adc_scan_filters[ which ] = pFilter;
+} // end adc_scan_set_filter()
+
+//===============================================================================
+//= What:	adc_scan_open()														=
+//= Why:	Starts scanning 'pChannels' every 'period_ms'.						=
+//= Desc:	Attaches the ISR, starts the pacing timer, and waits for the		=
+//=			first scan so readers never see an empty snapshot.					=
+//= Return:	void.																=
+//= Params:	const ADC_CHAN *pChannels (channels to scan, in order)				=
+//=			unsigned char count (entries in 'pChannels')						=
+//=			TIMER16 period_ms (time between scan starts)						=
+//= Notes:	ADC_open() and ADC_set_VREF() must already have been called.		=
+//=			Channels past ADC_SCAN_MAX_CHANNELS, or above ADC_CHAN7, are		=
+//=			ignored.															=
+//===============================================================================
+void adc_scan_open( const ADC_CHAN *pChannels, unsigned char count, TIMER16 period_ms )
+{
+	unsigned char i;
+
+	adc_scan_count = 0;
+	for( i = 0; ( i < count ) && ( adc_scan_count < ADC_SCAN_MAX_CHANNELS ); i++ )
+	{
+		if( pChannels[ i ] < ADC_SCAN_NCHANS )
+			adc_scan_list[ adc_scan_count++ ] = pChannels[ i ];
+	}
+
+	if( adc_scan_count == 0 )
+		return;
+
+	ISR_open();
+	ISR_attach( ISR_ADC_VECT, adc_scan_isr );
+
+	TMRSRVC_REGISTER_EVENT( adc_scan_timer, adc_scan_trigger );
+	TMRSRVC_new( &adc_scan_timer, TMRFLG_NOTIFY_FUNC, TMRTCM_RESTART, period_ms );
+
+	// Wait for the first scan to be published.
+	while( adc_scan_sequence == 0 )
+		DELAY_us( 100 );
+} // end adc_scan_open()
+
+//===============================================================================
+//= What:	adc_scan_get()														=
+//= Why:	Returns the latest published sample of one channel.					=
+//= Return:	ADC_SAMPLE (10-bit result, 0 if 'which' is not being scanned).		=
+//= Params:	ADC_CHAN which (channel to read)									=
+//= Notes:	Lock-free: never blocks on a conversion and never masks				=
+//=			interrupts.															=
+//===============================================================================
+ADC_SAMPLE adc_scan_get( ADC_CHAN which )
+{
+	unsigned char sequence;
+	ADC_SAMPLE sample;
+
+	do {
+		sequence = adc_scan_sequence;
+		sample = adc_scan_buf[ adc_scan_front ][ which & 0x07 ];
+	} while( sequence != adc_scan_sequence );
+
+	return sample;
+} // end adc_scan_get()
+
+//===============================================================================
+//= What:	adc_scan_snapshot()													=
+//= Why:	Copies every channel from one scan, so values read together were	=
+//=			also sampled together.												=
+//= Return:	void.																=
+//= Params:	ADC_SNAPSHOT *pSnapshot (where the copy goes)						=
+//= Notes:	Lock-free, as adc_scan_get().										=
+//===============================================================================
+void adc_scan_snapshot( ADC_SNAPSHOT *pSnapshot )
+{
+	unsigned char i;
+	unsigned char front;
+
+	do {
+		pSnapshot->sequence = adc_scan_sequence;
+		front = adc_scan_front;
+
+		for( i = 0; i < ADC_SCAN_NCHANS; i++ )
+			pSnapshot->sample[ i ] = adc_scan_buf[ front ][ i ];
+	} while( pSnapshot->sequence != adc_scan_sequence );
+} // end adc_scan_snapshot()
+
+//===============================================================================
+//= What:	adc_scan_seq()														=
+//= Why:	Lets a reader tell whether a new scan has landed since it last		=
+//=			looked, without copying anything.									=
+//= Return:	unsigned char (published scan count, wraps at 256).					=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+unsigned char adc_scan_seq( void )
+{
+	return adc_scan_sequence;
+} // end adc_scan_seq()
@@ -0,0 +1,200 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	arbiter.c														=
+//= Desc:		Table-driven behavior arbiter and task scheduler.  One pass		=
+//=				over a const table in flash runs the sense tasks that are due,	=
+//=				re-runs only the behaviors whose inputs changed, picks the		=
+//=				highest-priority active proposal, and resumes every task		=
+//=				(protothreads: see PT_* in ECEN3450Lab06.h).					=
+//= Functions:	arbiter_open(), arbiter_run()									=
+//= Other:		Table layout: sense entries first (they feed the behaviors),	=
+//=				then behaviors from HIGHEST to lowest priority, then tasks		=
+//=				(they act on the winner).  Build entries with the ARB_SENSE(),	=
+//=				ARB_BEHAVIOR() and ARB_TASK() macros.							=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// The table in flash, and the RAM kept for each of its entries.
+static const ARBITER_ENTRY *arbiter_table;
+static unsigned char arbiter_count = 0;
+static ARBITER_SLOT arbiter_slots[ ARBITER_MAX_ENTRIES ];
+
+// Milliseconds since arbiter_open(), counted by the timer service ISR.
+static volatile unsigned short int arbiter_ms = 0;
+
+// 1ms tick: the notify function counts, the flag tells the loop a tick
+// has passed so it only checks the sense schedule when something is due.
+static TIMEROBJ arbiter_timer;
+
+//===============================================================================
+//= What:	arbiter_tick()														=
+//= Why:	Timer notify function: advances the millisecond count.				=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Runs in the timer service ISR.										=
+//===============================================================================
+static void arbiter_tick( void )
+{
+	arbiter_ms++;
+} // end arbiter_tick()
+
+//===============================================================================
+//= What:	arbiter_now()														=
+//= Why:	Reads the 16-bit millisecond count without masking interrupts.		=
+//= Return:	unsigned short int (ms since arbiter_open(), wraps at 65.5s).		=
+//= Params:	void.																=
+//= Notes:	The ISR can update it between the two byte reads on the AVR, so		=
+//=			read until two reads agree.  Behaviors use it as their clock.		=
+//===============================================================================
+unsigned short int arbiter_now( void )
+{
+	unsigned short int now;
+
+	do {
+		now = arbiter_ms;
+	} while( now != arbiter_ms );
+
+	return now;
+} // end arbiter_now()
+
+//===============================================================================
+//= What:	arbiter_open()														=
+//= Why:	Registers the behavior table and starts the tick.					=
+//= Desc:	Every sense task is due on the first pass and every behavior		=
+//=			starts with all of its inputs marked changed, so each one runs		=
+//=			at least once.  Every task starts from the top.						=
+//= Return:	void.																=
+//= Params:	const ARBITER_ENTRY *pTable (table in flash)						=
+//=			unsigned char count (entries, at most ARBITER_MAX_ENTRIES)			=
+//= Notes:	main.c checks the table's length at compile time.					=
+//===============================================================================
+void arbiter_open( const ARBITER_ENTRY *pTable, unsigned char count )
+{
+	ARBITER_ENTRY entry;
+	unsigned char i;
+
+	arbiter_table = pTable;
+	arbiter_count = count;
+
+	for( i = 0; i < arbiter_count; i++ )
+	{
+		memcpy_P( &entry, &arbiter_table[ i ], sizeof( entry ) );
+		arbiter_slots[ i ].due_ms = 0;
+		arbiter_slots[ i ].pending = 0xFF;
+		if( entry.task != NULL )
+			PT_INIT( &arbiter_slots[ i ].pt );
+		else
+			arbiter_slots[ i ].proposal.state = STARTUP;
+	}
+
+	arbiter_ms = 0;
+	TMRSRVC_REGISTER_EVENT( arbiter_timer, arbiter_tick );
+	TMRSRVC_new( &arbiter_timer, TMRFLG_NOTIFY_FUNC | TMRFLG_NOTIFY_FLAG,
+		TMRTCM_RESTART, 1 );
+} // end arbiter_open()
+
+//===============================================================================
+//= What:	arbiter_run()														=
+//= Why:	One arbitration pass.												=
+//= Desc:	Sense entries: if due, sample, and on a change mark that input		=
+//=			pending for every behavior.  Behavior entries, highest priority		=
+//=			first, until one is active:											=
+//=				- re-run it if one of its inputs is pending (or it is marked	=
+//=				  ARB_RUN_WHILE_ACTIVE and was active), else reuse its last		=
+//=				  proposal;														=
+//=				- a proposal whose state is not STARTUP is active and wins.		=
+//=			Lower-priority behaviors are not run at all while a higher one		=
+//=			is active; their pending inputs wait until they matter again.		=
+//=			Task entries, every pass: the inputs pending for the task			=
+//=			become events on its protothread, then it is resumed.				=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (receives the winning proposal)		=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	If no behavior is active, *pAction is left unchanged.  Tasks		=
+//=			run after the behaviors, so they see this pass's winner.			=
+//===============================================================================
+void arbiter_run( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	ARBITER_ENTRY entry;
+	ARBITER_SLOT *pSlot;
+	unsigned short int now = 0;
+	BOOL tick = FALSE;
+	BOOL won = FALSE;
+	unsigned char i, j;
+
+	// Only look at the sense schedule once per millisecond.
+	if( TIMER_ALARM( arbiter_timer ) )
+	{
+		TIMER_SNOOZE( arbiter_timer );
+		now = arbiter_now();
+		tick = TRUE;
+	}
+
+	for( i = 0; i < arbiter_count; i++ )
+	{
+		memcpy_P( &entry, &arbiter_table[ i ], sizeof( entry ) );
+		pSlot = &arbiter_slots[ i ];
+
+		// ================= Sense entry.
+		if( entry.sense != NULL )
+		{
+			if( ( tick == FALSE ) || ( ( signed short int )( now - pSlot->due_ms ) < 0 ) )
+				continue;
+
+			// Keep the cadence, but never queue up a burst after a stall.
+			pSlot->due_ms += entry.period_ms;
+			if( ( signed short int )( now - pSlot->due_ms ) >= 0 )
+				pSlot->due_ms = now + entry.period_ms;
+
+			// New data is pending for every behavior, including ones
+			// that will not run this pass.
+			if( entry.sense( pSensors ) == TRUE )
+			{
+				for( j = 0; j < arbiter_count; j++ )
+					arbiter_slots[ j ].pending |= entry.inputs;
+			}
+
+			PROFILE_MARK( entry.section );
+			continue;
+		}
+
+		// ================= Task entry.
+		if( entry.task != NULL )
+		{
+			pSlot->pt.events |= pSlot->pending & entry.inputs;
+			pSlot->pending = 0;
+			entry.task( &pSlot->pt, pAction, pSensors );
+			PROFILE_MARK( entry.section );
+			continue;
+		}
+
+		// ================= Behavior entry, once nothing has won.
+		if( won == TRUE )
+			continue;
+
+		if( ( pSlot->pending & ( entry.inputs | ARB_PENDING_FIRST ) ) ||
+			( ( entry.flags & ARB_RUN_WHILE_ACTIVE ) && ( pSlot->proposal.state != STARTUP ) ) )
+		{
+			pSlot->pending = 0;
+			pSlot->proposal.state = STARTUP;
+			entry.behave( &pSlot->proposal, pSensors );
+			PROFILE_MARK( entry.section );
+		}
+
+		if( pSlot->proposal.state != STARTUP )
+		{
+			*pAction = pSlot->proposal;
+			won = TRUE;
+		}
+	} // end for()
+} // end arbiter_run()
@@ -0,0 +1,151 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	calib.c															=
+//= Desc:		Calibration and tunable parameters, kept in EEPROM as one		=
+//=				versioned, CRC-checked record.  With a good record CEENBoT		=
+//=				boots straight into the arbitration loop; without one (or		=
+//=				with SW3 held at power-on) it runs calibrate_pr() and saves		=
+//=				the result.														=
+//= Functions:	calib_defaults(), calib_load(), calib_save(), calib_open()		=
+//= Other:		The RAM copy, 'calib', is what the behaviors read.  Changing	=
+//=				the record layout means bumping CALIB_VERSION, which makes		=
+//=				old records read as invalid (defaults plus a recalibration).	=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Calibration and parameters in effect.
+CALIB_RECORD calib;
+
+//===============================================================================
+//= What:	calib_crc()															=
+//= Why:	CRC-16 of every byte of a record before its 'crc' field.			=
+//= Return:	unsigned short int (the CRC).										=
+//= Params:	const CALIB_RECORD *pRecord (record to check)						=
+//= Notes:	none.																=
+//===============================================================================
+static unsigned short int calib_crc( const CALIB_RECORD *pRecord )
+{
+	const unsigned char *p = ( const unsigned char * ) pRecord;
+	unsigned short int crc = 0xFFFF;
+	unsigned char i;
+
+	for( i = 0; i < offsetof( CALIB_RECORD, crc ); i++ )
+		crc = _crc16_update( crc, p[ i ] );
+
+	return crc;
+} // end calib_crc()
+
+//===============================================================================
+//= What:	calib_defaults()													=
+//= Why:	Puts the compile-time defaults into 'calib'.						=
+//= Desc:	Photoresistors uncorrected (offset 0, gain 1.0) and balanced;		=
+//=			behavior parameters from their #defines.							=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Does not touch the EEPROM.											=
+//===============================================================================
+void calib_defaults( void )
+{
+	memset( &calib, 0, sizeof( calib ) );
+
+	calib.version = CALIB_VERSION;
+	calib.size = sizeof( calib );
+	calib.PR_delta_LR = 0;
+	calib.PR_offset_L = 0;
+	calib.PR_offset_R = 0;
+	calib.PR_gain_L = CALIB_GAIN_ONE;
+	calib.PR_gain_R = CALIB_GAIN_ONE;
+	calib.PR_gain_slow = PR_GAIN_SLOW;
+	calib.PR_gain_fast = PR_GAIN_FAST;
+	calib.avoid_speed = AVOID_SPEED;
+	calib.avoid_backup_steps = AVOID_BACKUP_STEPS;
+	calib.range_slow_cm = RANGE_SLOW_CM;
+	calib.range_stop_cm = RANGE_STOP_CM;
+} // end calib_defaults()
+
+//===============================================================================
+//= What:	calib_load()														=
+//= Why:	Reads the record from EEPROM into 'calib'.							=
+//= Desc:	The record is only taken if its version, size and CRC all match;	=
+//=			otherwise 'calib' gets the defaults.  A record cut short by a		=
+//=			power loss during calib_save() fails the CRC.						=
+//= Return:	BOOL (TRUE if a valid record was loaded).							=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+BOOL calib_load( void )
+{
+	CALIB_RECORD record;
+
+	eeprom_read_block( &record, ( const void * ) CALIB_EEPROM_ADDR, sizeof( record ) );
+
+	if( ( record.version != CALIB_VERSION ) || ( record.size != sizeof( record ) ) ||
+		( record.crc != calib_crc( &record ) ) ||
+		( record.range_stop_cm >= record.range_slow_cm ) )
+	{
+		calib_defaults();
+		return FALSE;
+	}
+
+	calib = record;
+	return TRUE;
+} // end calib_load()
+
+//===============================================================================
+//= What:	calib_save()														=
+//= Why:	Writes 'calib' to EEPROM with a fresh CRC.							=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Blocks about 3.4ms per byte that actually changed (unchanged		=
+//=			bytes are not rewritten), up to ~90ms for the whole record.			=
+//===============================================================================
+void calib_save( void )
+{
+	calib.version = CALIB_VERSION;
+	calib.size = sizeof( calib );
+	calib.crc = calib_crc( &calib );
+
+	eeprom_update_block( &calib, ( void * ) CALIB_EEPROM_ADDR, sizeof( calib ) );
+} // end calib_save()
+
+//===============================================================================
+//= What:	calib_open()														=
+//= Why:	Boot-time calibration: load it, or make it.							=
+//= Desc:	With a valid record and SW3 not held, copies PR_delta_LR into		=
+//=			SENSOR_DATA and returns at once.  Otherwise runs calibrate_pr()		=
+//=			(which waits for a fresh SW3 press) and saves the result.			=
+//= Return:	BOOL (TRUE if it calibrated, i.e. the operator is at the robot).	=
+//= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	Hold SW3 through power-on to force a recalibration.					=
+//===============================================================================
+BOOL calib_open( volatile SENSOR_DATA *pSensors )
+{
+	BOOL valid = calib_load();
+
+	tiny_sense_update();
+	if( ( valid == TRUE ) && ( tiny_sense_SW( ATTINY_SW3 ) == FALSE ) )
+	{
+		pSensors->PR_delta_LR = calib.PR_delta_LR;
+		return FALSE;
+	}
+
+	// The press that forced this is not the one that starts calibration.
+	tiny_sense_SW_pressed( ATTINY_SW3 );
+
+	calibrate_pr( pSensors );
+
+	calib.PR_delta_LR = pSensors->PR_delta_LR;
+	calib_save();
+
+	return TRUE;
+} // end calib_open()
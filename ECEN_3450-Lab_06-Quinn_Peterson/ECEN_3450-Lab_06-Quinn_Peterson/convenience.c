@@ -5,7 +5,9 @@
 //= Due Date:	03/16/18														=
 //= File Name:	convenience.c													=
 //= Desc:		Miscellaneous functions that don't really fit elsewhere.		=
-//= Functions:	act(), open_modules(), info_display(), compare_actions()		=
+//= Functions:	act(), act_invalidate(), open_modules(), info_display(),		=
+//=				action_changes(), command_service(), drive_task(),				=
+//=				display_task()													=
 //= Other:		none.															=
 //===============================================================================
 
@@ -14,14 +16,29 @@
 //===============================================================================
 #include "ECEN3450Lab06.h"
 
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Set when something other than act() has driven the steppers (a maneuver
+// or a direct stop), so act() resends its whole action.
+static BOOL act_resend = FALSE;
+
 //===============================================================================
 //= What:	act()																=
 //= Why:	Uses the *pAction values to set the speed of the motors.			=
-//= Desc:	If the current state of CEENBoT is same as the previous state, then	=
-//=			it won't do anything, otherwise it will set the motors to *pAction.	=
+//= Desc:	Compares *pAction with what the steppers were last told and sends	=
+//=			only what changed: STEPPER_set_accel2() for new accelerations,		=
+//=			then STEPPER_runn() for new speeds.  A change of state alone		=
+//=			sends nothing.  Commands are at least ACT_UPDATE_MS apart; a		=
+//=			change that comes sooner is held and sent by a later call.			=
 //= Return:	void.																=
 //= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
-//= Notes:	none.																=
+//= Notes:	While AVOIDING, IR_avoid() is driving the steppers in step mode		=
+//=			itself, so act() sends nothing (a free-running command would		=
+//=			cancel the maneuver), and resends everything after it, as it		=
+//=			does after act_invalidate().  The interval is timed on the			=
+//=			stopwatch, so after more than ~650ms without a command one may		=
+//=			be held back by up to ACT_UPDATE_MS.								=
 //===============================================================================
 void act( volatile MOTOR_ACTION *pAction )
 {
@@ -32,29 +49,99 @@ void act( volatile MOTOR_ACTION *pAction )
 	static MOTOR_ACTION previous_action = {
 		STARTUP, 0, 0, 0, 0
 	};
+	
+	// Stopwatch time of the last stepper command.
+	static SWTIME last_command = 0;
+	
+	unsigned char changes;
+	SWTIME now;
 
-	if( compare_actions( pAction, &previous_action ) == FALSE )
+	if( pAction->state == AVOIDING )
 	{
-		// Perform the action.  Just call the 'free-running' version
-		// of stepper move function and feed these same parameters.
-		__MOTOR_ACTION( *pAction );
-
-		// Save the previous action.
+		// Remember it, so whatever follows the maneuver is sent.  The
+		// odometry still needs the maneuver's directions.
+		odom_command( pAction );
+		kin_command( 0, 0 );
 		previous_action = *pAction;
+		act_resend = TRUE;
+		return;
+	}
+	
+	changes = action_changes( pAction, &previous_action );
+	
+	// The steppers were driven behind act()'s back: resend it all.
+	if( act_resend == TRUE )
+		changes |= ACT_CHG_MOTORS;
+	
+	if( ( changes & ACT_CHG_MOTORS ) != 0 )
+	{
+		now = STOPWATCH_get_ticks();
+		
+		// Too soon after the last command: keep the new state only, and
+		// send the motor change on a later pass.
+		if( ( previous_action.state != STARTUP ) &&
+			( ( SWTIME )( now - last_command ) < ACT_UPDATE_MS * 100U ) )
+		{
+			previous_action.state = pAction->state;
+			return;
+		}
+		
+		if( changes & ACT_CHG_ACCEL )
+			STEPPER_set_accel2( pAction->accel_L, pAction->accel_R );
+		
+		if( changes & ACT_CHG_SPEED )
+		{
+			STEPPER_runn( pAction->speed_L, pAction->speed_R );
+			odom_command( pAction );
+			kin_command( pAction->speed_L, pAction->speed_R );
+		}
+		
+		last_command = now;
+		act_resend = FALSE;
 	} // end if()
+
+	// Save the previous action.
+	previous_action = *pAction;
 } // end act()
 
+//===============================================================================
+//= What:	act_invalidate()													=
+//= Why:	Tells act() the steppers no longer do what it last sent.			=
+//= Desc:	The next act() resends speeds and accelerations even if the			=
+//=			action has not changed.												=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Call it after any STEPPER_stop() or other command made outside		=
+//=			act(), or CEENBoT stays stopped until a behavior's output			=
+//=			changes.															=
+//===============================================================================
+void act_invalidate( void )
+{
+	act_resend = TRUE;
+	kin_command( 0, 0 );
+} // end act_invalidate()
+
 //===============================================================================
 //= What:	open_modules()														=
 //= Why:	Opens all modules in once simple function.							=
 //= Desc:	LEDs (opens), LCD (opens, then clears), Steppers (opens),			=
-//=			ADC (opens, waits 400 ms to initialize, sets reference to 5V).		=
+//=			ADC (opens, sets reference to 5V, starts the filtered,				=
+//=			interrupt-driven scan), panorama servo (centres, if enabled),		=
+//=			Stopwatch (opens, starts), ultrasonic ranging (readies),			=
+//=			UART0 (opens, 8N1 at UART0_BAUD).									=
 //= Return:	void.																=
 //= Params:	void.																=
 //= Notes:	none.																=
 //===============================================================================
 void open_modules( void )
 {
+	// Channels the ADC scan converts, in order: both photoresistors,
+	// and the two spare inputs on J3.  The ultrasonic pin is digital
+	// (see range.c), so it is not scanned.
+	static const ADC_CHAN scan_channels[] = {
+		right_pr_channel, left_pr_channel, ADC_CHAN6, ADC_CHAN7
+	};
+	
 	// Opening LEDs
 	LED_open();
 	
@@ -67,9 +154,30 @@ void open_modules( void )
 	
 	// Opening & Initializing ADCs
 	ADC_open();
-	DELAY_ms(400);
 	// set ADC reference to 5V
 	ADC_set_VREF(ADC_VREF_AVCC);
+	
+	// Starting the interrupt-driven ADC scan (owns the ADC from here on),
+	// with the photoresistor filters in place first
+	PR_filter_open();
+#if PANO_ENABLED
+	pano_open();
+#endif
+	adc_scan_open(scan_channels, sizeof(scan_channels) / sizeof(scan_channels[0]), ADC_SCAN_PERIOD_MS);
+	
+	// Opening & starting the stopwatch (10us ticks for the profiler
+	// and the ultrasonic echo timing)
+	STOPWATCH_open();
+	STOPWATCH_start();
+	
+	// Readying the ultrasonic ranging (pings start with range_sense())
+	range_open();
+	
+	// Opening UART0 (8N1) for debug commands and reports
+	UART_open(UART_UART0);
+	UART_configure(UART_UART0, UART_8DBITS, UART_1SBIT, UART_NO_PARITY, UART0_BAUD);
+	UART_set_TX_state(UART_UART0, UART_ENABLE);
+	UART_set_RX_state(UART_UART0, UART_ENABLE);
 } // end open_modules
 
 //===============================================================================
@@ -79,45 +187,49 @@ void open_modules( void )
 //=			than the current state, then print (prevents screen flicker).		=
 //= Return:	void.																=
 //= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
-//= Notes:	none.																=
+//= Notes:	Writes the LCD shadow only; lcd_shadow_flush() sends the cells		=
+//=			that changed.														=
 //===============================================================================
 void info_display( volatile MOTOR_ACTION *pAction )
 {
-	// NOTE:  We keep track of the 'previous' state to prevent the LCD
-	//        display from being needlessly written, if there's  nothing
-	//        new to display.  Otherwise, the screen will 'flicker' from
-	//        too many writes.
+	// NOTE:  We keep track of the 'previous' state so the state text is
+	//        only redrawn when it changes.  Otherwise it would wipe the
+	//        photoresistor values light_follow() writes over it.
 	static ROBOT_STATE previous_state = STARTUP;
 
 	if ( ( pAction->state != previous_state ) || ( pAction->state == STARTUP ) )
 	{
-		LCD_clear();
+		lcd_shadow_clear();
 
 		//  Display information based on the current 'ROBOT STATE'.
 		switch( pAction->state )
 		{
 			case STARTUP:
-			LCD_printf("Let me wake up\nplease...\n");
+			lcd_shadow_puts_RC( 0, 0, "Let me wake up\nplease...\n" );
 			break;
 
 			case EXPLORING:
-			LCD_printf( "Exploring...\n" );
+			lcd_shadow_puts_RC( 0, 0, "Exploring...\n" );
 			break;
 
 			case AVOIDING:
-			LCD_printf("GET OUT CHALLENGE!!!\n");
+			lcd_shadow_puts_RC( 0, 0, "GET OUT CHALLENGE!!!\n" );
 			break;
 			
 			case LIGHT_FOLLOW:
-			LCD_printf("Go to the light,\nJerry...");
+			lcd_shadow_puts_RC( 0, 0, "Go to the light,\nJerry..." );
+			break;
+
+			case SEARCHING:
+			lcd_shadow_puts_RC( 0, 0, "Where's the light?\n" );
 			break;
 			
 //			case LIGHT_OBSERVE:
-//			LCD_printf("Stay away from the\nlight, Icarus...");
+//			lcd_shadow_puts_RC( 0, 0, "Stay away from the\nlight, Icarus..." );
 //			break;
 
 			default:
-			LCD_printf( "Unknown state!\n" );
+			lcd_shadow_puts_RC( 0, 0, "Unknown state!\n" );
 			break;
 		} // end switch()
 
@@ -127,32 +239,155 @@ void info_display( volatile MOTOR_ACTION *pAction )
 } // end info_display()
 
 //===============================================================================
-//= What:	compare_actions()													=
-//= Why:	Checks if previous state is the same as the current state.			=
-//= Desc:	If any actions (*a and *b) are the same return TRUE, else FALSE.	=
-//= Return:	BOOL.																=
+//= What:	action_changes()													=
+//= Why:	Finds which parts of two actions differ.							=
+//= Desc:	Compares the state, the speed pair and the acceleration pair.		=
+//= Return:	unsigned char (ACT_CHG_* bits; 0 if the actions are the same).		=
 //= Params:	volatile MOTOR_ACTION *a (the pointer for all motor actions)		=
 //=			volatile MOTOR_ACTION *b (the pointer for all motor actions)		=
 //= Notes:	none.																=
 //===============================================================================
-BOOL compare_actions( volatile MOTOR_ACTION *a, volatile MOTOR_ACTION *b )
+unsigned char action_changes( volatile MOTOR_ACTION *a, volatile MOTOR_ACTION *b )
+{
+	unsigned char changes = 0;
+
+	if( a->state != b->state )
+		changes |= ACT_CHG_STATE;
+
+	if( ( a->speed_L != b->speed_L ) || ( a->speed_R != b->speed_R ) )
+		changes |= ACT_CHG_SPEED;
+
+	if( ( a->accel_L != b->accel_L ) || ( a->accel_R != b->accel_R ) )
+		changes |= ACT_CHG_ACCEL;
+
+	return changes;
+} // end action_changes()
+
+//===============================================================================
+//= What:	command_service()													=
+//= Why:	Handles single-letter commands arriving on UART0.					=
+//= Desc:	'p' prints the profiler report, 'r' resets the profiler, 'd'		=
+//=			dumps the flight recorder, 's' prints the stack headroom, 'c'		=
+//=			stops the robot and saves the current photoresistor balance to		=
+//=			EEPROM; driving resumes on the next act().  Anything else (or a		=
+//=			command whose module is compiled out) is ignored.					=
+//= Return:	void.																=
+//= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	Costs one UART status check when idle.  'c' blocks for the			=
+//=			EEPROM write (see calib_save()).									=
+//===============================================================================
+void command_service( volatile SENSOR_DATA *pSensors )
+{
+	unsigned char command;
+	char text[ FMT_LINE_SIZE ];
+	FMT_BUF line;
+
+	if( UART0_has_data() == FALSE )
+		return;
+
+	if( UART0_receive( &command ) != UART_COMM_OK )
+		return;
+
+	switch( command )
+	{
+#if PROFILE_ENABLED
+		case 'p':
+		profile_report();
+		break;
+
+		case 'r':
+		profile_reset();
+		break;
+#endif
+
+#if FLIGHTREC_ENABLED
+		case 'd':
+		flightrec_dump();
+		break;
+#endif
+
+		case 's':
+		fmt_open( &line, text, sizeof( text ) );
+		fmt_str_P( &line, PSTR( "\r\nstack: " ), 0 );
+		fmt_uint( &line, stack_headroom(), 0, ' ' );
+		fmt_str_P( &line, PSTR( " bytes never used\r\n" ), 0 );
+		fmt_uart( &line );
+		break;
+
+		case 'c':
+		STEPPER_stop( STEPPER_BOTH, STEPPER_BRK_OFF );
+		act_invalidate();
+		get_PR_diff( pSensors );
+		calib.PR_delta_LR = pSensors->PR_delta_LR;
+		calib_save();
+		fmt_open( &line, text, sizeof( text ) );
+		fmt_str_P( &line, PSTR( "\r\ncalib: saved, PR_delta_LR " ), 0 );
+		fmt_int( &line, ( signed short int ) calib.PR_delta_LR, 0 );
+		fmt_str_P( &line, PSTR( "\r\n" ), 0 );
+		fmt_uart( &line );
+		break;
+
+		default:
+		break;
+	} // end switch()
+} // end command_service()
+
+//===============================================================================
+//= What:	drive_task()														=
+//= Why:	Arbiter task that drives the motors with the winning action.		=
+//= Desc:	Every pass: copy the action of highest priority, ease the copy		=
+//=			off as the ultrasonic range to an obstacle closes, and perform		=
+//=			it.  The arbiter's action itself is never scaled.					=
+//= Return:	char (PT_YIELDED: it never ends).									=
+//= Params:	PT *pt (the task's protothread)										=
+//=			volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	List it after the behaviors, so it acts on this pass's winner.		=
+//===============================================================================
+char drive_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
 {
-	// NOTE:  The 'sole' purpose of this function is to
-	//        compare the 'elements' of MOTOR_ACTION structures
-	//        'a' and 'b' and see if 'any' differ.
+	// Only used within one pass, so it need not survive the yield.
+	MOTOR_ACTION drive;
 
-	// Assume these actions are equal.
-	BOOL rval = TRUE;
+	PT_BEGIN( pt );
+
+	for( ;; )
+	{
+		drive = *pAction;
+		range_slowdown( &drive, pSensors );
+		PROFILE_MARK( PROF_SLOWDOWN );
 
-	if (
-	( a->state   != b->state )   ||
-	( a->speed_L != b->speed_L ) ||
-	( a->speed_R != b->speed_R ) ||
-	( a->accel_L != b->accel_L ) ||
-	( a->accel_R != b->accel_R ) )
+		act( &drive );
+		PT_YIELD( pt );
+	}
+
+	PT_END( pt );
+} // end drive_task()
+
+//===============================================================================
+//= What:	display_task()														=
+//= Why:	Arbiter task that keeps the LCD up to date.							=
+//= Desc:	Every pass: draw the state into the LCD shadow, then send a few		=
+//=			of the cells that changed; the rest wait for the next pass, so		=
+//=			the display never stalls the loop.									=
+//= Return:	char (PT_YIELDED: it never ends).									=
+//= Params:	PT *pt (the task's protothread)										=
+//=			volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (unused)								=
+//= Notes:	lcd_shadow_open() must have run.									=
+//===============================================================================
+char display_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	PT_BEGIN( pt );
+
+	for( ;; )
+	{
+		info_display( pAction );
+		PROFILE_MARK( PROF_INFO_DISPLAY );
 
-	rval = FALSE;
+		lcd_shadow_flush( LCD_FLUSH_BUDGET );
+		PT_YIELD( pt );
+	}
 
-	// Return comparison result.
-	return rval;
-} // end compare_actions()
\ No newline at end of file
+	PT_END( pt );
+} // end display_task()
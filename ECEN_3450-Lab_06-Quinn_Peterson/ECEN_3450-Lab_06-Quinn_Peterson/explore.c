@@ -17,16 +17,15 @@
 //===============================================================================
 //= What:	explore()															=
 //= Why:	Behavior to have the CEENBoT cruise in a straight line.				=
-//= Desc:	Sets state to "EXPLORING" and sets left/right speed/acceleration.	=
+//= Desc:	Sets state to "EXPLORING" and drives straight ahead at				=
+//=			EXPLORE_SPEED.														=
 //= Return:	void.																=
 //= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (unused; arbiter signature)			=
 //= Notes:	none.																=
 //===============================================================================
-void explore( volatile MOTOR_ACTION *pAction )
+void explore( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
 {
 	pAction->state = EXPLORING;
-	pAction->speed_L = 150;
-	pAction->speed_R = 150;
-	pAction->accel_L = 400;
-	pAction->accel_R = 400;
+	kin_drive( pAction, EXPLORE_SPEED, 0, EXPLORE_ACCEL );
 } // end explore()
\ No newline at end of file
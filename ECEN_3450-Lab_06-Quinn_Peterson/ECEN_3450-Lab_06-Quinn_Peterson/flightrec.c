@@ -0,0 +1,579 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	flightrec.c														=
+//= Desc:		Flight recorder.  Logs a telemetry frame every period to the	=
+//=				on-board SPI flash as one circular byte stream, so the last		=
+//=				~16 minutes of runs survive power-off for a post-mortem dump	=
+//=				over UART0.														=
+//= Functions:	flightrec_open(), flightrec_task(), flightrec_dump(),			=
+//=				flightrec_dropped()												=
+//= Other:		Frames are staged in RAM chunks and programmed one chunk per	=
+//=				service step (chunks are page-aligned, so a program never		=
+//=				crosses a page).  The sector after the one being written is		=
+//=				erased ahead of time, and each run starts after the newest		=
+//=				sector of the last one, so erases walk the whole device			=
+//=				evenly.  Every sector starts with a header (FR_*) giving its	=
+//=				run number.  The dump decodes with sim/teledecode.				=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+#define FLIGHTREC_NO_ERASE	SPIFLASH_SECTORS	// No sector waiting to be erased.
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// FALSE until flightrec_open() finds the flash.
+static BOOL flightrec_on = FALSE;
+
+// RAM staging: a ring of chunks.  'fill' is being appended to; 'ready'
+// complete chunks starting at 'next' wait to be programmed.
+static unsigned char flightrec_chunks[ FLIGHTREC_CHUNKS ][ FLIGHTREC_CHUNK ];
+static unsigned char flightrec_fill = 0;
+static unsigned char flightrec_fill_len = 0;
+static unsigned char flightrec_next = 0;
+static unsigned char flightrec_ready = 0;
+
+// Flash address of the next byte appended, and of chunk 'next'.
+static unsigned long int flightrec_fill_addr;
+static unsigned long int flightrec_prog_addr;
+
+// Sector to erase before anything else, or FLIGHTREC_NO_ERASE.
+static unsigned char flightrec_erase_sector = FLIGHTREC_NO_ERASE;
+
+// TRUE after a program or erase until the status says it finished.
+static BOOL flightrec_busy = FALSE;
+
+// This run's number and the lap count for the next sector header.
+static unsigned short int flightrec_run;
+static unsigned long int flightrec_lap;
+
+// Milliseconds since flightrec_open(), and the two requests the timer
+// makes of the loop: one flash step every FLIGHTREC_SERVICE_MS, one frame
+// every FLIGHTREC_PERIOD_MS.
+static volatile unsigned long int flightrec_ms = 0;
+static volatile BOOL flightrec_flash_due = FALSE;
+static volatile BOOL flightrec_frame_due = FALSE;
+static volatile unsigned char flightrec_countdown;
+
+// Frame sequence number and frames dropped because RAM was full.
+static unsigned char flightrec_sequence = 0;
+static unsigned short int flightrec_drops = 0;
+
+// Paces the frames and the flash steps.
+static TIMEROBJ flightrec_timer;
+
+//===============================================================================
+//= What:	flightrec_tick()													=
+//= Why:	Timer notify function: asks for a flash step, and every				=
+//=			FLIGHTREC_PERIOD_MS for a frame.									=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Runs in the timer service ISR.										=
+//===============================================================================
+static void flightrec_tick( void )
+{
+	flightrec_ms += FLIGHTREC_SERVICE_MS;
+	flightrec_flash_due = TRUE;
+
+	if( --flightrec_countdown == 0 )
+	{
+		flightrec_countdown = FLIGHTREC_PERIOD_MS / FLIGHTREC_SERVICE_MS;
+		flightrec_frame_due = TRUE;
+	}
+} // end flightrec_tick()
+
+//===============================================================================
+//= What:	flash_begin()														=
+//= Why:	Selects the flash and sends a command, plus an address if needed.	=
+//= Return:	void.																=
+//= Params:	unsigned char command (SPIFLASH_CMD_*)								=
+//=			unsigned long int addr (24-bit address, or SPIFLASH_SIZE for none)	=
+//= Notes:	The flash stays selected until flash_end().							=
+//===============================================================================
+static void flash_begin( unsigned char command, unsigned long int addr )
+{
+	SPI_transmit( SPI_ADDR_SPIFLASH, command );
+
+	if( addr < SPIFLASH_SIZE )
+	{
+		SPI_transmit( SPI_ADDR_SPIFLASH, ( unsigned char )( addr >> 16 ) );
+		SPI_transmit( SPI_ADDR_SPIFLASH, ( unsigned char )( addr >> 8 ) );
+		SPI_transmit( SPI_ADDR_SPIFLASH, ( unsigned char ) addr );
+	}
+} // end flash_begin()
+
+//===============================================================================
+//= What:	flash_end()															=
+//= Why:	Deselects the flash, which ends (and for writes, starts) the		=
+//=			command.															=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+static void flash_end( void )
+{
+	SPI_set_slave_addr( SPI_ADDR_NA );
+} // end flash_end()
+
+//===============================================================================
+//= What:	flash_status()														=
+//= Return:	unsigned char (status register; SPIFLASH_SR_BUSY while writing).	=
+//= Params:	void.																=
+//===============================================================================
+static unsigned char flash_status( void )
+{
+	unsigned char status;
+
+	flash_begin( SPIFLASH_CMD_RDSR, SPIFLASH_SIZE );
+	status = SPI_receive( SPI_ADDR_SPIFLASH, SPI_NULL_DATA );
+	flash_end();
+
+	return status;
+} // end flash_status()
+
+//===============================================================================
+//= What:	flash_wait()														=
+//= Why:	Blocks until the flash finishes a program or erase.					=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Only for flightrec_open() and flightrec_dump(), never the loop.		=
+//===============================================================================
+static void flash_wait( void )
+{
+	while( flash_status() & SPIFLASH_SR_BUSY )
+		DELAY_us( 100 );
+
+	flightrec_busy = FALSE;
+} // end flash_wait()
+
+//===============================================================================
+//= What:	flash_write_command()												=
+//= Why:	Write-enables the flash, then sends a program/erase/status write.	=
+//= Return:	void.																=
+//= Params:	unsigned char command (SPIFLASH_CMD_*)								=
+//=			unsigned long int addr (24-bit address, or SPIFLASH_SIZE for none)	=
+//=			const unsigned char *pData (bytes that follow, or NULL)				=
+//=			unsigned char count (number of bytes in 'pData')					=
+//= Notes:	Returns as soon as the command is sent; the flash is busy until		=
+//=			flash_status() says otherwise.										=
+//===============================================================================
+static void flash_write_command( unsigned char command, unsigned long int addr,
+	const unsigned char *pData, unsigned char count )
+{
+	unsigned char i;
+
+	flash_begin( SPIFLASH_CMD_WREN, SPIFLASH_SIZE );
+	flash_end();
+
+	flash_begin( command, addr );
+	for( i = 0; i < count; i++ )
+		SPI_transmit( SPI_ADDR_SPIFLASH, pData[ i ] );
+	flash_end();
+
+	flightrec_busy = TRUE;
+} // end flash_write_command()
+
+//===============================================================================
+//= What:	flash_read()														=
+//= Why:	Reads 'count' bytes starting at 'addr'.								=
+//= Return:	void.																=
+//= Params:	unsigned long int addr (24-bit address)								=
+//=			unsigned char *pDest (where the bytes go)							=
+//=			unsigned char count (number of bytes)								=
+//= Notes:	The flash must not be busy.											=
+//===============================================================================
+static void flash_read( unsigned long int addr, unsigned char *pDest, unsigned char count )
+{
+	unsigned char i;
+
+	flash_begin( SPIFLASH_CMD_READ, addr );
+	for( i = 0; i < count; i++ )
+		pDest[ i ] = SPI_receive( SPI_ADDR_SPIFLASH, SPI_NULL_DATA );
+	flash_end();
+} // end flash_read()
+
+//===============================================================================
+//= What:	flightrec_read_header()												=
+//= Why:	Reads and checks one sector's header.								=
+//= Return:	BOOL (TRUE if the sector holds a valid header).						=
+//= Params:	unsigned char sector (sector number)								=
+//=			unsigned short int *pRun (receives the run number)					=
+//=			unsigned long int *pLap (receives the lap count)					=
+//= Notes:	none.																=
+//===============================================================================
+static BOOL flightrec_read_header( unsigned char sector, unsigned short int *pRun,
+	unsigned long int *pLap )
+{
+	unsigned char header[ FR_HEADER_SIZE ];
+	unsigned char i, check = 0;
+
+	flash_read( sector * SPIFLASH_SECTOR_SIZE, header, FR_HEADER_SIZE );
+
+	if( ( header[ FR_OFS_SYNC ] != FR_SYNC0 ) || ( header[ FR_OFS_SYNC + 1 ] != FR_SYNC1 ) )
+		return FALSE;
+
+	for( i = FR_OFS_RUN; i <= FR_OFS_CHECK; i++ )
+		check += header[ i ];
+	if( check != 0 )
+		return FALSE;
+
+	*pRun = header[ FR_OFS_RUN ] | ( header[ FR_OFS_RUN + 1 ] << 8 );
+	*pLap = header[ FR_OFS_LAP ] |
+		( ( unsigned long int ) header[ FR_OFS_LAP + 1 ] << 8 ) |
+		( ( unsigned long int ) header[ FR_OFS_LAP + 2 ] << 16 ) |
+		( ( unsigned long int ) header[ FR_OFS_LAP + 3 ] << 24 );
+
+	return TRUE;
+} // end flightrec_read_header()
+
+//===============================================================================
+//= What:	flightrec_put()														=
+//= Why:	Appends one byte to the stream.										=
+//= Return:	void.																=
+//= Params:	unsigned char data (byte to append)									=
+//= Notes:	The caller has already checked there is room.						=
+//===============================================================================
+static void flightrec_put( unsigned char data )
+{
+	flightrec_chunks[ flightrec_fill ][ flightrec_fill_len ] = data;
+	flightrec_fill_addr = ( flightrec_fill_addr + 1 ) & ( SPIFLASH_SIZE - 1 );
+
+	if( ++flightrec_fill_len == FLIGHTREC_CHUNK )
+	{
+		flightrec_fill_len = 0;
+		flightrec_fill = ( flightrec_fill + 1 ) % FLIGHTREC_CHUNKS;
+		flightrec_ready++;
+	}
+} // end flightrec_put()
+
+//===============================================================================
+//= What:	flightrec_begin_sector()											=
+//= Why:	Starts the sector the stream has just reached with its header,		=
+//=			and queues the erase of the sector after it.						=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	The stream must be at a sector boundary, with room for the header.	=
+//===============================================================================
+static void flightrec_begin_sector( void )
+{
+	unsigned char header[ FR_HEADER_SIZE ];
+	unsigned char sector = flightrec_fill_addr / SPIFLASH_SECTOR_SIZE;
+	unsigned char i, check = 0;
+
+	header[ FR_OFS_SYNC ] = FR_SYNC0;
+	header[ FR_OFS_SYNC + 1 ] = FR_SYNC1;
+	header[ FR_OFS_RUN ] = ( unsigned char ) flightrec_run;
+	header[ FR_OFS_RUN + 1 ] = ( unsigned char )( flightrec_run >> 8 );
+	header[ FR_OFS_LAP ] = ( unsigned char ) flightrec_lap;
+	header[ FR_OFS_LAP + 1 ] = ( unsigned char )( flightrec_lap >> 8 );
+	header[ FR_OFS_LAP + 2 ] = ( unsigned char )( flightrec_lap >> 16 );
+	header[ FR_OFS_LAP + 3 ] = ( unsigned char )( flightrec_lap >> 24 );
+	flightrec_lap++;
+
+	for( i = FR_OFS_RUN; i < FR_OFS_CHECK; i++ )
+		check += header[ i ];
+	header[ FR_OFS_CHECK ] = -check;
+
+	for( i = 0; i < FR_HEADER_SIZE; i++ )
+		flightrec_put( header[ i ] );
+
+	flightrec_erase_sector = ( sector + 1 ) % SPIFLASH_SECTORS;
+} // end flightrec_begin_sector()
+
+//===============================================================================
+//= What:	flightrec_append()													=
+//= Why:	Appends one frame to the stream, or drops it if RAM is full.		=
+//= Desc:	A frame never straddles a sector: if it would, the rest of the		=
+//=			sector is padded with 0xFF (erased) and the frame goes after the	=
+//=			next sector's header, so losing a sector never splits a frame.		=
+//= Return:	void.																=
+//= Params:	const unsigned char *pFrame (TLM_FRAME_SIZE bytes)					=
+//= Notes:	none.																=
+//===============================================================================
+static void flightrec_append( const unsigned char *pFrame )
+{
+	unsigned short int offset = flightrec_fill_addr & ( SPIFLASH_SECTOR_SIZE - 1 );
+	unsigned short int pad = 0;
+	unsigned short int need = TLM_FRAME_SIZE;
+	unsigned short int room;
+	BOOL new_sector = FALSE;
+	unsigned char i;
+
+	if( offset == 0 )
+		new_sector = TRUE;
+	else if( ( unsigned long int ) offset + TLM_FRAME_SIZE > SPIFLASH_SECTOR_SIZE )
+	{
+		pad = SPIFLASH_SECTOR_SIZE - offset;
+		new_sector = TRUE;
+	}
+
+	if( new_sector == TRUE )
+		need += pad + FR_HEADER_SIZE;
+
+	room = ( FLIGHTREC_CHUNKS - 1 - flightrec_ready ) * FLIGHTREC_CHUNK +
+		( FLIGHTREC_CHUNK - flightrec_fill_len );
+	if( need > room )
+	{
+		flightrec_drops++;
+		return;
+	}
+
+	while( pad-- > 0 )
+		flightrec_put( 0xFF );
+
+	if( new_sector == TRUE )
+		flightrec_begin_sector();
+
+	for( i = 0; i < TLM_FRAME_SIZE; i++ )
+		flightrec_put( pFrame[ i ] );
+} // end flightrec_append()
+
+//===============================================================================
+//= What:	flightrec_open()													=
+//= Why:	Finds the flash and the end of the existing log, and starts a new	=
+//=			run in the sector after it.											=
+//= Desc:	Reads every sector header to find the newest one.  The first		=
+//=			sector of the new run is erased here; after that every erase		=
+//=			happens a step at a time in flightrec_task().						=
+//= Return:	BOOL (FALSE if no flash answered; the recorder then stays off).		=
+//= Params:	void.																=
+//= Notes:	Blocks for one sector erase (tens of ms), so call it before the		=
+//=			arbitration loop.													=
+//===============================================================================
+BOOL flightrec_open( void )
+{
+	unsigned char id[ 3 ];
+	unsigned char sector, newest = FLIGHTREC_NO_ERASE;
+	unsigned short int run, newest_run = 0;
+	unsigned long int lap, newest_lap = 0;
+	SUBSYS_STATUS status;
+
+	status = SPIFLASH_open();
+	if( ( status != SUBSYS_OPEN ) && ( status != SUBSYS_ALREADY_OPEN ) )
+		return FALSE;
+
+	// No flash (or no answer) reads as all 0s or all 1s.
+	flash_begin( SPIFLASH_CMD_JEDEC_ID, SPIFLASH_SIZE );
+	for( sector = 0; sector < 3; sector++ )
+		id[ sector ] = SPI_receive( SPI_ADDR_SPIFLASH, SPI_NULL_DATA );
+	flash_end();
+
+	if( ( id[ 0 ] == 0x00 ) || ( id[ 0 ] == 0xFF ) )
+		return FALSE;
+
+	// Sectors power up write-protected on some parts; unprotect them all.
+	id[ 0 ] = 0;
+	flash_write_command( SPIFLASH_CMD_WRSR, SPIFLASH_SIZE, id, 1 );
+	flash_wait();
+
+	for( sector = 0; sector < SPIFLASH_SECTORS; sector++ )
+	{
+		if( flightrec_read_header( sector, &run, &lap ) == FALSE )
+			continue;
+
+		if( ( newest == FLIGHTREC_NO_ERASE ) || ( lap > newest_lap ) )
+		{
+			newest = sector;
+			newest_run = run;
+			newest_lap = lap;
+		}
+	}
+
+	if( newest == FLIGHTREC_NO_ERASE )
+	{
+		sector = 0;
+		flightrec_run = 1;
+		flightrec_lap = 0;
+	}
+	else
+	{
+		sector = ( newest + 1 ) % SPIFLASH_SECTORS;
+		flightrec_run = newest_run + 1;
+		flightrec_lap = newest_lap + 1;
+	}
+
+	flash_write_command( SPIFLASH_CMD_ERASE_4K, sector * SPIFLASH_SECTOR_SIZE, NULL, 0 );
+	flash_wait();
+
+	flightrec_fill_addr = sector * SPIFLASH_SECTOR_SIZE;
+	flightrec_prog_addr = flightrec_fill_addr;
+	flightrec_begin_sector();
+
+	flightrec_countdown = FLIGHTREC_PERIOD_MS / FLIGHTREC_SERVICE_MS;
+	TMRSRVC_REGISTER_EVENT( flightrec_timer, flightrec_tick );
+	TMRSRVC_new( &flightrec_timer, TMRFLG_NOTIFY_FUNC, TMRTCM_RESTART, FLIGHTREC_SERVICE_MS );
+
+	flightrec_on = TRUE;
+	return TRUE;
+} // end flightrec_open()
+
+//===============================================================================
+//= What:	flightrec_task()													=
+//= Why:	Arbiter task: logs a frame when one is due and advances the flash	=
+//=			by one step.														=
+//= Desc:	A step is at most one short SPI transaction: a status poll while	=
+//=			the flash is busy, otherwise the pending erase, otherwise one		=
+//=			chunk program.  At the default settings that keeps well ahead of	=
+//=			the ~400 bytes/sec being logged.									=
+//= Return:	char (PT_WAITING: it never ends).									=
+//= Params:	PT *pt (the task's protothread)										=
+//=			volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	List it with ARB_TASK() only when FLIGHTREC_ENABLED.  Waits for		=
+//=			good without the flash.  Costs two flag checks when nothing is		=
+//=			due.																=
+//===============================================================================
+char flightrec_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	unsigned char frame[ TLM_FRAME_SIZE ];
+	unsigned long int t_ms;
+
+	PT_BEGIN( pt );
+
+	PT_WAIT_UNTIL( pt, flightrec_on == TRUE );
+
+	for( ;; )
+	{
+		PT_WAIT_UNTIL( pt, ( flightrec_frame_due == TRUE ) || ( flightrec_flash_due == TRUE ) );
+
+		if( flightrec_frame_due == TRUE )
+		{
+			flightrec_frame_due = FALSE;
+
+			do {
+				t_ms = flightrec_ms;
+			} while( t_ms != flightrec_ms );
+
+			telemetry_pack( frame, flightrec_sequence++, t_ms, pAction, pSensors );
+			flightrec_append( frame );
+		}
+
+		if( flightrec_flash_due == FALSE )
+			continue;
+		flightrec_flash_due = FALSE;
+
+		if( flightrec_busy == TRUE )
+		{
+			if( flash_status() & SPIFLASH_SR_BUSY )
+				continue;
+			flightrec_busy = FALSE;
+		}
+
+		if( flightrec_erase_sector != FLIGHTREC_NO_ERASE )
+		{
+			flash_write_command( SPIFLASH_CMD_ERASE_4K,
+				flightrec_erase_sector * SPIFLASH_SECTOR_SIZE, NULL, 0 );
+			flightrec_erase_sector = FLIGHTREC_NO_ERASE;
+		}
+		else if( flightrec_ready > 0 )
+		{
+			flash_write_command( SPIFLASH_CMD_PROGRAM, flightrec_prog_addr,
+				flightrec_chunks[ flightrec_next ], FLIGHTREC_CHUNK );
+			flightrec_prog_addr = ( flightrec_prog_addr + FLIGHTREC_CHUNK ) & ( SPIFLASH_SIZE - 1 );
+			flightrec_next = ( flightrec_next + 1 ) % FLIGHTREC_CHUNKS;
+			flightrec_ready--;
+		}
+	}
+
+	PT_END( pt );
+} // end flightrec_task()
+
+//===============================================================================
+//= What:	flightrec_dump()													=
+//= Why:	Sends the whole log over UART0, oldest first, for a post-mortem.	=
+//= Desc:	Stops the robot, waits for telemetry to drain, then sends every		=
+//=			sector with a valid header in write order, the current sector up	=
+//=			to what has been programmed, and finally whatever is still in RAM.	=
+//=			Text lines mark the start and end; sim/teledecode skips them.		=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Blocks until done (about 1s per sector at 38400 baud), so it is		=
+//=			meant for after a run.  Logging and driving resume afterwards.		=
+//===============================================================================
+void flightrec_dump( void )
+{
+	unsigned char buf[ FLIGHTREC_CHUNK ];
+	unsigned char current, sector, i, n, chunk;
+	unsigned short int run;
+	unsigned long int lap, addr, end;
+	char text[ FMT_LINE_SIZE ];
+	FMT_BUF line;
+
+	STEPPER_stop( STEPPER_BOTH, STEPPER_BRK_OFF );
+	act_invalidate();
+	telemetry_flush();
+
+	if( flightrec_on == FALSE )
+	{
+		fmt_uart_P( PSTR( "\r\nflightrec: no flash\r\n" ) );
+		return;
+	}
+
+	flash_wait();
+	fmt_open( &line, text, sizeof( text ) );
+	fmt_str_P( &line, PSTR( "\r\nflightrec: run " ), 0 );
+	fmt_uint( &line, flightrec_run, 0, ' ' );
+	fmt_str_P( &line, PSTR( ", " ), 0 );
+	fmt_uint( &line, flightrec_drops, 0, ' ' );
+	fmt_str_P( &line, PSTR( " dropped, dump begins\r\n" ), 0 );
+	fmt_uart( &line );
+
+	current = flightrec_prog_addr / SPIFLASH_SECTOR_SIZE;
+	sector = current;
+
+	do {
+		sector = ( sector + 1 ) % SPIFLASH_SECTORS;
+
+		addr = sector * SPIFLASH_SECTOR_SIZE;
+		if( sector == current )
+			end = flightrec_prog_addr;
+		else if( flightrec_read_header( sector, &run, &lap ) == TRUE )
+			end = addr + SPIFLASH_SECTOR_SIZE;
+		else
+			continue;
+
+		for( ; addr < end; addr += n )
+		{
+			n = ( end - addr > FLIGHTREC_CHUNK ) ? FLIGHTREC_CHUNK : ( unsigned char )( end - addr );
+			flash_read( addr, buf, n );
+			for( i = 0; i < n; i++ )
+				UART0_transmit( buf[ i ] );
+		}
+	} while( sector != current );
+
+	// Then what has not reached the flash yet.
+	chunk = flightrec_next;
+	for( n = 0; n < flightrec_ready; n++ )
+	{
+		for( i = 0; i < FLIGHTREC_CHUNK; i++ )
+			UART0_transmit( flightrec_chunks[ chunk ][ i ] );
+		chunk = ( chunk + 1 ) % FLIGHTREC_CHUNKS;
+	}
+	for( i = 0; i < flightrec_fill_len; i++ )
+		UART0_transmit( flightrec_chunks[ flightrec_fill ][ i ] );
+
+	fmt_uart_P( PSTR( "\r\nflightrec: dump ends\r\n" ) );
+} // end flightrec_dump()
+
+//===============================================================================
+//= What:	flightrec_dropped()													=
+//= Why:	Frames dropped because the RAM chunks were full (flash too slow		=
+//=			for the chosen period).												=
+//= Return:	unsigned short int (frames dropped since power-on).					=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+unsigned short int flightrec_dropped( void )
+{
+	return flightrec_drops;
+} // end flightrec_dropped()
@@ -0,0 +1,311 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	fmt.c															=
+//= Desc:		Integer text formatting for the LCD and UART0, in place of		=
+//=				printf().  Each call appends one field (text, a padded			=
+//=				integer, a fixed-point decimal or hex) to a FMT_BUF, and the	=
+//=				finished text goes to the LCD shadow or straight out UART0.		=
+//= Functions:	fmt_open(), fmt_char(), fmt_str(), fmt_str_P(), fmt_uint(),		=
+//=				fmt_int(), fmt_fixed(), fmt_hex(), fmt_uart(), fmt_uart_P(),	=
+//=				fmt_lcd_RC()													=
+//= Other:		No floating point and no vfprintf(), so neither gets linked.	=
+//=				A field that does not fit is cut off, never written past the	=
+//=				end of the buffer.												=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+// Decimal digits in the largest unsigned long int (10 on the AVR; the
+// simulator's host may have a 64-bit long).
+#define FMT_DIGITS	( sizeof( unsigned long int ) * 5 / 2 )
+
+//===============================================================================
+//= What:	fmt_digits()														=
+//= Why:	Decimal digits of 'value', least significant first.					=
+//= Return:	unsigned char (digits written, at least 1).							=
+//= Params:	char *pDigits (FMT_DIGITS characters)								=
+//=			unsigned long int value (number to convert)							=
+//= Notes:	32-bit division costs several times a 16-bit one on the AVR, so		=
+//=			it only runs until the rest of the number fits in 16 bits.			=
+//===============================================================================
+static unsigned char fmt_digits( char *pDigits, unsigned long int value )
+{
+	unsigned char n = 0;
+	unsigned short int small;
+
+	while( value > 0xFFFFUL )
+	{
+		pDigits[ n++ ] = '0' + ( char )( value % 10 );
+		value /= 10;
+	}
+
+	small = ( unsigned short int ) value;
+	do {
+		pDigits[ n++ ] = '0' + ( char )( small % 10 );
+		small /= 10;
+	} while( small != 0 );
+
+	return n;
+} // end fmt_digits()
+
+//===============================================================================
+//= What:	fmt_pad()															=
+//= Why:	Pads a field out to its width.										=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			unsigned char len (characters the field has)						=
+//=			unsigned char width (characters it should take)						=
+//=			char pad (character to pad with)									=
+//===============================================================================
+static void fmt_pad( FMT_BUF *pBuf, unsigned char len, unsigned char width, char pad )
+{
+	for( ; len < width; len++ )
+		fmt_char( pBuf, pad );
+} // end fmt_pad()
+
+//===============================================================================
+//= What:	fmt_open()															=
+//= Why:	Starts building text in 'pText'.									=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			char *pText (where the text goes)									=
+//=			unsigned char size (bytes at pText, including the NUL)				=
+//= Notes:	none.																=
+//===============================================================================
+void fmt_open( FMT_BUF *pBuf, char *pText, unsigned char size )
+{
+	pBuf->pText = pText;
+	pBuf->size = size;
+	pBuf->len = 0;
+	pText[ 0 ] = '\0';
+} // end fmt_open()
+
+//===============================================================================
+//= What:	fmt_char()															=
+//= Why:	Appends one character.												=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			char c (character to append)										=
+//= Notes:	Dropped when the buffer is full.									=
+//===============================================================================
+void fmt_char( FMT_BUF *pBuf, char c )
+{
+	if( pBuf->len + 1 >= pBuf->size )
+		return;
+
+	pBuf->pText[ pBuf->len++ ] = c;
+	pBuf->pText[ pBuf->len ] = '\0';
+} // end fmt_char()
+
+//===============================================================================
+//= What:	fmt_str()															=
+//= Why:	Appends a string, like "%-*s".										=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			const char *pText (NUL-terminated string in RAM)					=
+//=			unsigned char width (pads with spaces on the right to this;			=
+//=			0 = none)															=
+//= Notes:	none.																=
+//===============================================================================
+void fmt_str( FMT_BUF *pBuf, const char *pText, unsigned char width )
+{
+	unsigned char len = 0;
+
+	for( ; *pText != '\0'; pText++, len++ )
+		fmt_char( pBuf, *pText );
+
+	fmt_pad( pBuf, len, width, ' ' );
+} // end fmt_str()
+
+//===============================================================================
+//= What:	fmt_str_P()															=
+//= Why:	Appends a string kept in flash, like "%-*S".						=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			PGM_P pText (NUL-terminated string in flash, e.g. PSTR( "" ))		=
+//=			unsigned char width (pads with spaces on the right to this;			=
+//=			0 = none)															=
+//= Notes:	none.																=
+//===============================================================================
+void fmt_str_P( FMT_BUF *pBuf, PGM_P pText, unsigned char width )
+{
+	unsigned char len = 0;
+	char c;
+
+	for( ; ( c = pgm_read_byte( pText ) ) != '\0'; pText++, len++ )
+		fmt_char( pBuf, c );
+
+	fmt_pad( pBuf, len, width, ' ' );
+} // end fmt_str_P()
+
+//===============================================================================
+//= What:	fmt_uint()															=
+//= Why:	Appends an unsigned integer, like "%*lu" or "%0*lu".				=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			unsigned long int value (number to append)							=
+//=			unsigned char width (pads on the left to this; 0 = none)			=
+//=			char pad (' ' or '0')												=
+//= Notes:	none.																=
+//===============================================================================
+void fmt_uint( FMT_BUF *pBuf, unsigned long int value, unsigned char width, char pad )
+{
+	char digits[ FMT_DIGITS ];
+	unsigned char n = fmt_digits( digits, value );
+
+	fmt_pad( pBuf, n, width, pad );
+	while( n > 0 )
+		fmt_char( pBuf, digits[ --n ] );
+} // end fmt_uint()
+
+//===============================================================================
+//= What:	fmt_int()															=
+//= Why:	Appends a signed integer, like "%*ld".								=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			signed long int value (number to append)							=
+//=			unsigned char width (pads with spaces on the left to this; 0 =		=
+//=			none)																=
+//= Notes:	none.																=
+//===============================================================================
+void fmt_int( FMT_BUF *pBuf, signed long int value, unsigned char width )
+{
+	fmt_fixed( pBuf, value, 0, width );
+} // end fmt_int()
+
+//===============================================================================
+//= What:	fmt_fixed()															=
+//= Why:	Appends a fixed-point decimal, the integer stand-in for "%*.*f".	=
+//= Desc:	'value' counts units of 10^-decimals, so 2345 with 3 decimals		=
+//=			is "2.345" and -5 with 2 is "-0.05".								=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			signed long int value (number, in units of 10^-decimals)			=
+//=			unsigned char decimals (digits after the point, 0 to 9; 0 = no		=
+//=			point)																=
+//=			unsigned char width (pads with spaces on the left to this; 0 =		=
+//=			none)																=
+//= Notes:	There is always a digit before the point.							=
+//===============================================================================
+void fmt_fixed( FMT_BUF *pBuf, signed long int value, unsigned char decimals, unsigned char width )
+{
+	char digits[ FMT_DIGITS ];
+	unsigned long int magnitude = ( value < 0 ) ? -( unsigned long int ) value : ( unsigned long int ) value;
+	unsigned char n = fmt_digits( digits, magnitude );
+	unsigned char len;
+
+	if( decimals > 9 )
+		decimals = 9;
+
+	// Leading zeros up to the digit before the point.
+	while( n <= decimals )
+		digits[ n++ ] = '0';
+
+	len = n + ( ( decimals > 0 ) ? 1 : 0 ) + ( ( value < 0 ) ? 1 : 0 );
+	fmt_pad( pBuf, len, width, ' ' );
+
+	if( value < 0 )
+		fmt_char( pBuf, '-' );
+	while( n > decimals )
+		fmt_char( pBuf, digits[ --n ] );
+	if( decimals > 0 )
+		fmt_char( pBuf, '.' );
+	while( n > 0 )
+		fmt_char( pBuf, digits[ --n ] );
+} // end fmt_fixed()
+
+//===============================================================================
+//= What:	fmt_hex()															=
+//= Why:	Appends a number in hex, like "%0*lX".								=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//=			unsigned long int value (number to append)							=
+//=			unsigned char digits (hex digits to write, 1 to 8; higher ones		=
+//=			are dropped)														=
+//= Notes:	none.																=
+//===============================================================================
+void fmt_hex( FMT_BUF *pBuf, unsigned long int value, unsigned char digits )
+{
+	unsigned char nibble;
+
+	if( digits > 8 )
+		digits = 8;
+
+	while( digits > 0 )
+	{
+		digits--;
+		nibble = ( unsigned char )( value >> ( digits * 4 ) ) & 0x0F;
+		fmt_char( pBuf, ( nibble < 10 ) ? ( '0' + nibble ) : ( 'A' + nibble - 10 ) );
+	}
+} // end fmt_hex()
+
+//===============================================================================
+//= What:	fmt_uart()															=
+//= Why:	Sends the text on UART0 and empties the buffer for the next line.	=
+//= Return:	void.																=
+//= Params:	FMT_BUF *pBuf (text being built)									=
+//= Notes:	Blocks on the UART, as UART0_printf() did.  With telemetry on,		=
+//=			call telemetry_flush() first so the text lands between frames.		=
+//===============================================================================
+void fmt_uart( FMT_BUF *pBuf )
+{
+	unsigned char i;
+
+	for( i = 0; i < pBuf->len; i++ )
+		UART0_transmit( pBuf->pText[ i ] );
+
+	pBuf->len = 0;
+	pBuf->pText[ 0 ] = '\0';
+} // end fmt_uart()
+
+//===============================================================================
+//= What:	fmt_uart_P()														=
+//= Why:	Sends a string kept in flash on UART0, for messages with nothing	=
+//=			to format.															=
+//= Return:	void.																=
+//= Params:	PGM_P pText (NUL-terminated string in flash, e.g. PSTR( "" ))		=
+//= Notes:	Blocks on the UART, as fmt_uart() does.								=
+//===============================================================================
+void fmt_uart_P( PGM_P pText )
+{
+	char c;
+
+	for( ; ( c = pgm_read_byte( pText ) ) != '\0'; pText++ )
+		UART0_transmit( c );
+} // end fmt_uart_P()
+
+//===============================================================================
+//= What:	fmt_lcd_RC()														=
+//= Why:	Writes text straight to the display, for the screens shown before	=
+//=			the LCD shadow is open (calibration, start-up).						=
+//= Desc:	'\n' moves to column 0 of the next row, as LCD_printf() does.		=
+//=			Text below the last row is dropped.									=
+//= Return:	void.																=
+//= Params:	unsigned char row (starting row)									=
+//=			unsigned char col (starting column)									=
+//=			const char *pText (NUL-terminated string, e.g. from a FMT_BUF)		=
+//= Notes:	Once lcd_shadow_open() has run, use lcd_shadow_puts_RC() instead.	=
+//===============================================================================
+void fmt_lcd_RC( unsigned char row, unsigned char col, const char *pText )
+{
+	LCD_set_RC( row, col );
+
+	for( ; *pText != '\0'; pText++ )
+	{
+		if( *pText != '\n' )
+			LCD_putchar( *pText );
+		else if( ++row < LCD_nPAGES )
+			LCD_set_RC( row, 0 );
+		else
+			break;
+	}
+} // end fmt_lcd_RC()
@@ -5,7 +5,8 @@
 //= Due Date:	03/16/18														=
 //= File Name:	ir_behaviors.c													=
 //= Desc:		Contains the behaviors relating to the IR sensors.				=
-//= Functions:	IR_sense(), IR_avoid()											=
+//= Functions:	IR_sense(), avoid_start(), avoid_turn(), avoid_leg_done(),		=
+//=				avoid_thread(), IR_avoid()										=
 //= Other:		none.															=
 //===============================================================================
 
@@ -14,159 +15,204 @@
 //===============================================================================
 #include "ECEN3450Lab06.h"
 
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// The avoid maneuver's protothread, and whether it is mid-maneuver.
+static PT avoid_pt = { 0, 0, 0 };
+static BOOL avoid_busy = FALSE;
+
 //===============================================================================
 //= What:	IR_sense()															=
-//= Why:	Behavior to read IR sensor values.									=
-//= Desc:	Starts the timer service if it hasn't been yet, otherwise it will	=
-//=			read from the IR sensors every "interval_ms".						=
-//= Return:	void.																=
+//= Why:	Sense task to read IR sensor values.								=
+//= Desc:	Refreshes the ATtiny snapshot (one SPI transaction for both IR		=
+//=			sensors and the switches) and copies the IR bits into				=
+//=			SENSOR_DATA.  The arbiter calls it every IR_SENSE_MS.				=
+//= Return:	BOOL (TRUE if either sensor changed since the last read).			=
 //= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
-//=			TIMER16 interval_ms (number of ms between checks of the sensor)		=
 //= Notes:	none.																=
 //===============================================================================
-void IR_sense( volatile SENSOR_DATA *pSensors, TIMER16 interval_ms )
+BOOL IR_sense( volatile SENSOR_DATA *pSensors )
 {
-	// Sense must know if it's already sensing.
-	//
-	// NOTE: 'BOOL' is a custom data type offered by the CEENBoT API.
-	//
-	static BOOL timer_started = FALSE;
-	
-	// The 'sense' timer is used to control how often gathering sensor
-	// data takes place.  The pace at which this happens needs to be
-	// controlled.  So we're forced to use TIMER OBJECTS along with the
-	// TIMER SERVICE.  It must be 'static' because the timer object must remain
-	// 'alive' even when it is out of scope -- otherwise the program will crash.
-	static TIMEROBJ sense_timer;
-	
-	// If this is the FIRST time that sense() is running, we need to start the
-	// sense timer.  We do this ONLY ONCE!
-	if ( timer_started == FALSE )
-	{
-		// Start the 'sense timer' to tick on every 'interval_ms'.
-		//
-		// NOTE:  You can adjust the delay value to suit your needs.
-		//
-		TMRSRVC_new( &sense_timer, TMRFLG_NOTIFY_FLAG, TMRTCM_RESTART,
-		interval_ms );
-		
-		// Mark that the timer has already been started.
-		timer_started = TRUE;
-	} // end if()
+	BOOL left_IR, right_IR;
+	BOOL changed;
 	
-	// Otherwise, just do the usual thing and just 'sense'.
-	else
-	{
-		// Only read the sensors when it is time to do so (e.g., every
-		// 125ms).  Otherwise, do nothing.
-		if ( TIMER_ALARM( sense_timer ) )
-		{
-			// NOTE: Just as a 'debugging' feature, let's also toggle the green LED
-			//       to know that this is working for sure.  The LED will only
-			//       toggle when 'it's time'.
-			LED_toggle( LED_Green );
+	// NOTE: Just as a 'debugging' feature, let's also toggle the green LED
+	//       to know that this is working for sure.  The LED will only
+	//       toggle when 'it's time'.
+	LED_toggle( LED_Green );
 
-			// Read the left and right sensors, and store this
-			// data in the 'SENSOR_DATA' structure.
-			pSensors->left_IR  = ATTINY_get_IR_state( ATTINY_IR_LEFT  );
-			pSensors->right_IR = ATTINY_get_IR_state( ATTINY_IR_RIGHT );
-			
-			// NOTE: You can add more stuff to 'sense' here.
-			
-			// Snooze the alarm so it can trigger again.
-			TIMER_SNOOZE( sense_timer );
-		} // end if()
-	} // end else.
+	// Read the left and right sensors in one transaction, and store
+	// this data in the 'SENSOR_DATA' structure.
+	tiny_sense_update();
+	left_IR  = tiny_sense_IR( ATTINY_IR_LEFT  );
+	right_IR = tiny_sense_IR( ATTINY_IR_RIGHT );
+	
+	changed = ( left_IR != pSensors->left_IR ) || ( right_IR != pSensors->right_IR );
+	
+	pSensors->left_IR  = left_IR;
+	pSensors->right_IR = right_IR;
+	
+	// NOTE: You can add more stuff to 'sense' here.
+	
+	return changed;
 } // end IR_sense()
 
 
 //===============================================================================
-//= What:	IR_avoid()															=
-//= Why:	Behavior to ballistically stop CEENBoT, reverse, and turn it.		=
-//= Desc:	If only left sensor is tripped, rotate right ~90-deg.				=
-//=			If only right sensor is tripped, rotate left ~90-deg.				=
-//=			If the left and right sensors are tripped, rotate right ~180-deg.	=
+//= What:	avoid_start()														=
+//= Why:	Starts (or restarts) an avoid maneuver with the back-up leg.		=
 //= Return:	void.																=
 //= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
-//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
-//= Notes:	none.																=
+//= Notes:	Non-blocking: the steppers run the leg on their own.				=
 //===============================================================================
-void IR_avoid( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+static void avoid_start( volatile MOTOR_ACTION *pAction )
 {
-	// NOTE: Here we have NO CHOICE, but to do this 'ballistically'.
-	//       **NOTHING** else can happen while we're 'avoiding'.
+	// STOP!
+	STEPPER_stop( STEPPER_BOTH, STEPPER_BRK_OFF );
 	
-	// If only the LEFT sensor tripped...
-	if( pSensors->left_IR == TRUE && pSensors->right_IR == FALSE)
+	// Back up...
+	STEPPER_move_stnb( STEPPER_BOTH,
+	STEPPER_REV, calib.avoid_backup_steps, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF,
+	STEPPER_REV, calib.avoid_backup_steps, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF );
+	
+	pAction->speed_L = -calib.avoid_speed;
+	pAction->speed_R = -calib.avoid_speed;
+} // end avoid_start()
+
+//===============================================================================
+//= What:	avoid_turn()														=
+//= Why:	Starts the turn leg of an avoid maneuver.							=
+//= Desc:	Only left tripped: turn RIGHT ~90-deg.  Only right tripped: turn	=
+//=			LEFT ~90-deg.  Both tripped: turn ~180-deg.							=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			unsigned char tripped (SNSR_IR_LEFT / SNSR_IR_RIGHT bits that		=
+//=			started the maneuver)												=
+//= Notes:	Non-blocking: the steppers run the leg on their own.				=
+//===============================================================================
+static void avoid_turn( volatile MOTOR_ACTION *pAction, unsigned char tripped )
+{
+	if( tripped == SNSR_IR_LEFT )
 	{
-		// Note that we're avoiding...
-		pAction->state = AVOIDING;
+		// ... and turn RIGHT ~90-deg.
+		STEPPER_move_stnb( STEPPER_BOTH,
+		STEPPER_FWD, DEG_90, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF,
+		STEPPER_REV, DEG_90, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF );
 		
-		// STOP!
-		STEPPER_stop( STEPPER_BOTH, STEPPER_BRK_OFF );
+		pAction->speed_L = calib.avoid_speed;
+		pAction->speed_R = -calib.avoid_speed;
+	}
+	else if( tripped == SNSR_IR_RIGHT )
+	{
+		// ... and turn LEFT ~90-deg.
+		STEPPER_move_stnb( STEPPER_BOTH,
+		STEPPER_REV, DEG_90, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF,
+		STEPPER_FWD, DEG_90, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF );
 		
-		// Back up...
-		STEPPER_move_stwt( STEPPER_BOTH,
-		STEPPER_REV, 150, 200, 400, STEPPER_BRK_OFF,
-		STEPPER_REV, 150, 200, 400, STEPPER_BRK_OFF );
+		pAction->speed_L = -calib.avoid_speed;
+		pAction->speed_R = calib.avoid_speed;
+	}
+	else
+	{
+		// ... and turn ~180-deg.
+		STEPPER_move_stnb( STEPPER_BOTH,
+		STEPPER_REV, DEG_90*2, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF,
+		STEPPER_FWD, DEG_90*2, calib.avoid_speed, AVOID_ACCEL, STEPPER_BRK_OFF );
 		
-		// ... and turn RIGHT ~90-deg.
-		STEPPER_move_stwt( STEPPER_BOTH,
-		STEPPER_FWD, DEG_90, 200, 400, STEPPER_BRK_OFF,
-		STEPPER_REV, DEG_90, 200, 400, STEPPER_BRK_OFF );
+		pAction->speed_L = -calib.avoid_speed;
+		pAction->speed_R = calib.avoid_speed;
+	}
+} // end avoid_turn()
 
-		// ... and set the motor action structure with variables to move forward.
-		pAction->speed_L = 200;
-		pAction->speed_R = 200;
-		pAction->accel_L = 400;
-		pAction->accel_R = 400;
-	} // end if()
-	else if( pSensors->left_IR == FALSE && pSensors->right_IR == TRUE )
-	{
-		// Note that we're avoiding...
-		pAction->state = AVOIDING;
+//===============================================================================
+//= What:	avoid_leg_done()													=
+//= Why:	Tells when the steppers have finished the current leg.				=
+//= Return:	BOOL (TRUE once both wheels have no steps left).					=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+static BOOL avoid_leg_done( void )
+{
+	STEPPER_STEPS steps = STEPPER_get_nSteps();
+	
+	return ( ( steps.left == 0 ) && ( steps.right == 0 ) ) ? TRUE : FALSE;
+} // end avoid_leg_done()
 
-		// STOP!
-		STEPPER_stop( STEPPER_BOTH, STEPPER_BRK_OFF );
-		
-		// Back up...
-		STEPPER_move_stwt( STEPPER_BOTH,
-		STEPPER_REV, 150, 200, 400, STEPPER_BRK_OFF,
-		STEPPER_REV, 150, 200, 400, STEPPER_BRK_OFF );
+//===============================================================================
+//= What:	avoid_thread()														=
+//= Why:	The avoid maneuver, written as it happens: wait for a trip, back	=
+//=			up, turn, and go again while still blocked.							=
+//= Return:	char (PT_WAITING while a leg runs or nothing is tripped).			=
+//= Params:	PT *pt (where the maneuver is)										=
+//=			volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			unsigned char tripped (SNSR_IR_LEFT / SNSR_IR_RIGHT bits now)		=
+//= Notes:	A protothread (see PT_* in ECEN3450Lab06.h): each wait gives the	=
+//=			loop back, so sensing and display carry on meanwhile.				=
+//===============================================================================
+static char avoid_thread( PT *pt, volatile MOTOR_ACTION *pAction, unsigned char tripped )
+{
+	// Which sensors started the maneuver (locals do not survive a wait).
+	static unsigned char maneuver_tripped;
+	
+	PT_BEGIN( pt );
+	
+	for( ;; )
+	{
+		avoid_busy = FALSE;
+		PT_WAIT_UNTIL( pt, tripped != 0 );
+		avoid_busy = TRUE;
 		
-		// ... and turn LEFT ~90-deg.
-		STEPPER_move_stwt( STEPPER_BOTH,
-		STEPPER_REV, DEG_90, 200, 400, STEPPER_BRK_OFF,
-		STEPPER_FWD, DEG_90, 200, 400, STEPPER_BRK_OFF );
-
-		// ... and set the motor action structure with variables to move forward.
-		pAction->speed_L = 200;
-		pAction->speed_R = 200;
-		pAction->accel_L = 400;
-		pAction->accel_R = 400;
+		// Back up, turn away, and repeat until the way is clear.
+		do {
+			maneuver_tripped = tripped;
+			avoid_start( pAction );
+			PT_WAIT_UNTIL( pt, avoid_leg_done() == TRUE );
+			
+			avoid_turn( pAction, maneuver_tripped );
+			PT_WAIT_UNTIL( pt, avoid_leg_done() == TRUE );
+		} while( tripped != 0 );
 	}
-	else if( pSensors->left_IR == TRUE && pSensors->right_IR == TRUE )
+	
+	PT_END( pt );
+} // end avoid_thread()
+
+//===============================================================================
+//= What:	IR_avoid()															=
+//= Why:	Behavior to back CEENBoT away from an obstacle and turn it.			=
+//= Desc:	Resumes avoid_thread(): back up, then turn (see avoid_turn()).		=
+//=			Each leg runs in step mode and the thread waits for the steps to	=
+//=			run out.  A sensor that trips fresh mid-maneuver restarts the		=
+//=			thread, and so the maneuver, for the new side.						=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	Needs ARB_RUN_WHILE_ACTIVE so it is polled every pass while			=
+//=			AVOIDING.  act() leaves the steppers alone in that state.			=
+//===============================================================================
+void IR_avoid( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	// What the sensors read last pass (to spot fresh trips).
+	static unsigned char last_tripped = 0;
+	
+	unsigned char tripped = ( pSensors->left_IR  == TRUE ? SNSR_IR_LEFT  : 0 ) |
+							( pSensors->right_IR == TRUE ? SNSR_IR_RIGHT : 0 );
+	unsigned char fresh = tripped & ~last_tripped;
+	
+	last_tripped = tripped;
+	
+	// A trip that arrives mid-maneuver starts it over.
+	if( fresh != 0 )
+		PT_INIT( &avoid_pt );
+	
+	avoid_thread( &avoid_pt, pAction, tripped );
+	
+	// While maneuvering, claim the robot (act() sees AVOIDING and leaves
+	// the steppers to the maneuver).
+	if( avoid_busy == TRUE )
 	{
-		// Note that we're avoiding...
 		pAction->state = AVOIDING;
-
-		// STOP!
-		STEPPER_stop( STEPPER_BOTH, STEPPER_BRK_OFF );
-		
-		// Back up...
-		STEPPER_move_stwt( STEPPER_BOTH,
-		STEPPER_REV, 150, 200, 400, STEPPER_BRK_OFF,
-		STEPPER_REV, 150, 200, 400, STEPPER_BRK_OFF );
-		
-		// ... and turn RIGHT ~180-deg.
-		STEPPER_move_stwt( STEPPER_BOTH,
-		STEPPER_REV, DEG_90*2, 200, 400, STEPPER_BRK_OFF,
-		STEPPER_FWD, DEG_90*2, 200, 400, STEPPER_BRK_OFF );
-
-		// ... and set the motor action structure with variables to move forward.
-		pAction->speed_L = 200;
-		pAction->speed_R = 200;
-		pAction->accel_L = 400;
-		pAction->accel_R = 400;
+		pAction->accel_L = AVOID_ACCEL;
+		pAction->accel_R = AVOID_ACCEL;
 	}
-} // end avoid()
+} // end IR_avoid()
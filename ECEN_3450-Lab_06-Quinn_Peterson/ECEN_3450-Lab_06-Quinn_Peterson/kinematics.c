@@ -0,0 +1,136 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	kinematics.c													=
+//= Desc:		Differential-drive kinematics.  Behaviors ask for a linear		=
+//=				and an angular velocity; kin_drive() turns them into wheel		=
+//=				speeds and accelerations the steppers can actually follow.		=
+//= Functions:	kin_drive(), kin_command()										=
+//= Other:		Wheel geometry follows from DEG_90, as in odometry.c: a turn	=
+//=				of 90 degrees in place is DEG_90 steps on each wheel.			=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Wheel speeds act() last sent to the steppers (steps/sec); kin_drive()
+// slews from these, not from its own last result, since every behavior
+// calls it and most of its results lose the arbitration.
+static signed short int kin_sent_L = 0;
+static signed short int kin_sent_R = 0;
+
+//===============================================================================
+//= What:	kin_abs()															=
+//= Return:	signed long int (magnitude of 'x').									=
+//= Params:	signed long int x													=
+//===============================================================================
+static signed long int kin_abs( signed long int x )
+{
+	return ( x < 0 ) ? -x : x;
+} // end kin_abs()
+
+//===============================================================================
+//= What:	kin_drive()															=
+//= Why:	The one place behaviors turn "how fast, how sharp" into a			=
+//=			MOTOR_ACTION.														=
+//= Desc:	Each wheel runs at v plus or minus its share of the turn.  If the	=
+//=			faster wheel would pass KIN_MAX_SPEED, both are scaled down by		=
+//=			the same factor, so the arc keeps its radius and only slows.		=
+//=			The speeds are then slew limited: if either wheel would change		=
+//=			by more than KIN_MAX_SLEW from what act() last sent, both			=
+//=			changes are scaled down by the same factor, and later calls			=
+//=			close the rest of the gap one command at a time.  'accel' is		=
+//=			clamped to KIN_MIN_ACCEL..KIN_MAX_ACCEL and given to the wheel		=
+//=			with the larger change; the other gets the same fraction of it		=
+//=			as of the change, so both wheels reach their new speeds together.	=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			signed short int v (forward speed, steps/sec)						=
+//=			signed short int w (turn rate, degrees/sec, left positive)			=
+//=			unsigned short int accel (acceleration of the wheel with the		=
+//=			larger change, steps/sec^2)											=
+//= Notes:	Sets speed_L/R and accel_L/R only; the caller sets 'state'.			=
+//=			Any v and w are safe: the arithmetic is 32-bit and the results		=
+//=			always fit the 16-bit fields.  The stepper ramp bounds how fast		=
+//=			a wheel's speed changes; the slew limit also bounds how far its		=
+//=			target moves per command, so a reversal or a sharp change of		=
+//=			turn reaches the steppers in steps rather than all at once.			=
+//===============================================================================
+void kin_drive( volatile MOTOR_ACTION *pAction, signed short int v, signed short int w,
+	unsigned short int accel )
+{
+	// Each wheel's share of the turn: 90 degrees/sec is DEG_90 steps/sec.
+	signed long int turn = ( ( signed long int ) w * DEG_90 ) / 90;
+	signed long int left = ( signed long int ) v - turn;
+	signed long int right = ( signed long int ) v + turn;
+	signed long int peak = kin_abs( left ) > kin_abs( right ) ? kin_abs( left ) : kin_abs( right );
+	signed long int change_L, change_R, step, slow;
+
+	if( peak > KIN_MAX_SPEED )
+	{
+		left = ( left * KIN_MAX_SPEED ) / peak;
+		right = ( right * KIN_MAX_SPEED ) / peak;
+	}
+
+	// Move from the speeds last sent toward the target, both wheels by the
+	// same fraction of the way.
+	change_L = left - kin_sent_L;
+	change_R = right - kin_sent_R;
+	step = kin_abs( change_L ) > kin_abs( change_R ) ? kin_abs( change_L ) : kin_abs( change_R );
+
+	if( step > KIN_MAX_SLEW )
+	{
+		change_L = ( change_L * KIN_MAX_SLEW ) / step;
+		change_R = ( change_R * KIN_MAX_SLEW ) / step;
+		step = KIN_MAX_SLEW;
+	}
+
+	left = kin_sent_L + change_L;
+	right = kin_sent_R + change_R;
+
+	if( accel < KIN_MIN_ACCEL )
+		accel = KIN_MIN_ACCEL;
+	else if( accel > KIN_MAX_ACCEL )
+		accel = KIN_MAX_ACCEL;
+
+	pAction->speed_L = ( signed short int ) left;
+	pAction->speed_R = ( signed short int ) right;
+	pAction->accel_L = accel;
+	pAction->accel_R = accel;
+
+	if( step == 0 )
+		return;
+
+	// The wheel with the smaller change ramps in proportion, but never
+	// below KIN_MIN_ACCEL.
+	slow = ( kin_abs( change_L ) < kin_abs( change_R ) ) ? kin_abs( change_L ) : kin_abs( change_R );
+	slow = ( ( signed long int ) accel * slow ) / step;
+	if( slow < KIN_MIN_ACCEL )
+		slow = KIN_MIN_ACCEL;
+
+	if( kin_abs( change_L ) < kin_abs( change_R ) )
+		pAction->accel_L = ( unsigned short int ) slow;
+	else
+		pAction->accel_R = ( unsigned short int ) slow;
+} // end kin_drive()
+
+//===============================================================================
+//= What:	kin_command()														=
+//= Why:	Tells kin_drive() what the steppers were last told.					=
+//= Return:	void.																=
+//= Params:	signed short int speed_L, signed short int speed_R (steps/sec)		=
+//= Notes:	act() calls it with every speed pair it sends, and with 0, 0		=
+//=			when the steppers are stopped or maneuvering behind its back.		=
+//===============================================================================
+void kin_command( signed short int speed_L, signed short int speed_R )
+{
+	kin_sent_L = speed_L;
+	kin_sent_R = speed_R;
+} // end kin_command()
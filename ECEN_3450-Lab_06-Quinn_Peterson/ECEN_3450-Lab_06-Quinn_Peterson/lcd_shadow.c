@@ -0,0 +1,199 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	lcd_shadow.c													=
+//= Desc:		RAM shadow of the 21x4 LCD character grid.  Writers only		=
+//=				change the shadow (and mark the cells that really changed		=
+//=				dirty); the loop pushes a few dirty cells to the display each	=
+//=				pass, so the LCD never costs more than the flush budget.		=
+//= Functions:	lcd_shadow_open(), lcd_shadow_clear(), lcd_shadow_puts_RC(),	=
+//=				lcd_shadow_flush()												=
+//= Other:		Once the shadow is open, nothing else may write to the LCD --	=
+//=				the shadow would no longer match it.							=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// What the display should show.
+static char lcd_shadow_cells[ LCD_nPAGES ][ LCD_nCOLS ];
+
+// One bit per column (bit 0 = column 0) for cells that differ from the
+// display.
+static unsigned long int lcd_shadow_dirty[ LCD_nPAGES ];
+
+// Where the next flush resumes, so a row that keeps changing cannot
+// starve the ones after it.
+static unsigned char lcd_shadow_row = 0;
+static unsigned char lcd_shadow_col = 0;
+
+// Where the display's own cursor is after the last character sent.
+// LCD_nCOLS means unknown, which forces an LCD_set_RC().
+static unsigned char lcd_cursor_row = 0;
+static unsigned char lcd_cursor_col = LCD_nCOLS;
+
+//===============================================================================
+//= What:	lcd_shadow_put()													=
+//= Why:	Stores one character, marking the cell dirty only if it changed.	=
+//= Return:	void.																=
+//= Params:	unsigned char row (0 to LCD_nPAGES - 1)								=
+//=			unsigned char col (0 to LCD_nCOLS - 1)								=
+//=			char c (character to show)											=
+//= Notes:	none.																=
+//===============================================================================
+static void lcd_shadow_put( unsigned char row, unsigned char col, char c )
+{
+	if( lcd_shadow_cells[ row ][ col ] == c )
+		return;
+
+	lcd_shadow_cells[ row ][ col ] = c;
+	lcd_shadow_dirty[ row ] |= 1UL << col;
+} // end lcd_shadow_put()
+
+//===============================================================================
+//= What:	lcd_shadow_open()													=
+//= Why:	Clears the display and starts the shadow out matching it.			=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	LCD_open() must already have been called.  This is the last			=
+//=			direct LCD call; use the lcd_shadow_*() functions after it.			=
+//===============================================================================
+void lcd_shadow_open( void )
+{
+	unsigned char row;
+
+	LCD_clear();
+
+	memset( lcd_shadow_cells, ' ', sizeof( lcd_shadow_cells ) );
+	for( row = 0; row < LCD_nPAGES; row++ )
+		lcd_shadow_dirty[ row ] = 0;
+
+	lcd_shadow_row = 0;
+	lcd_shadow_col = 0;
+	lcd_cursor_col = LCD_nCOLS;
+} // end lcd_shadow_open()
+
+//===============================================================================
+//= What:	lcd_shadow_clear()													=
+//= Why:	Blanks the shadow, the buffered version of LCD_clear().				=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Only cells that were not already blank are sent, so clearing and	=
+//=			rewriting the same text costs nothing at the display.				=
+//===============================================================================
+void lcd_shadow_clear( void )
+{
+	unsigned char row, col;
+
+	for( row = 0; row < LCD_nPAGES; row++ )
+		for( col = 0; col < LCD_nCOLS; col++ )
+			lcd_shadow_put( row, col, ' ' );
+} // end lcd_shadow_clear()
+
+//===============================================================================
+//= What:	lcd_shadow_puts_RC()												=
+//= Why:	Writes a string into the shadow starting at 'row', 'col'.			=
+//= Desc:	'\n' moves to column 0 of the next row, as LCD_printf() does.		=
+//=			Text past the end of a row, or below the last row, is dropped.		=
+//= Return:	void.																=
+//= Params:	unsigned char row (starting row)									=
+//=			unsigned char col (starting column)									=
+//=			const char *pText (NUL-terminated string)							=
+//= Notes:	none.																=
+//===============================================================================
+void lcd_shadow_puts_RC( unsigned char row, unsigned char col, const char *pText )
+{
+	for( ; ( *pText != '\0' ) && ( row < LCD_nPAGES ); pText++ )
+	{
+		if( *pText == '\n' )
+		{
+			row++;
+			col = 0;
+		}
+		else if( col < LCD_nCOLS )
+			lcd_shadow_put( row, col++, *pText );
+	}
+} // end lcd_shadow_puts_RC()
+
+//===============================================================================
+//= What:	lcd_shadow_flush()													=
+//= Why:	Sends dirty cells to the display, but no more than 'budget' LCD		=
+//=			transfers, so one pass of the loop has a fixed worst-case LCD		=
+//=			cost.																=
+//= Desc:	Walks the dirty bits from where the last flush stopped.  Each		=
+//=			character sent is one transfer; moving the display's				=
+//=			cursor (when the next dirty cell does not follow the last one		=
+//=			sent) is another.  Whatever does not fit waits for the next			=
+//=			pass.																=
+//= Return:	unsigned char (transfers used, 0 when nothing was dirty).			=
+//= Params:	unsigned char budget (most transfers to make)						=
+//= Notes:	A cell that needs a cursor move always gets its character too,		=
+//=			so a budget of 1 acts as 2.  When nothing is dirty this is one		=
+//=			look at each row's dirty bits.										=
+//===============================================================================
+unsigned char lcd_shadow_flush( unsigned char budget )
+{
+	unsigned char row = lcd_shadow_row;
+	unsigned char col = lcd_shadow_col;
+	unsigned char used = 0;
+	unsigned char rows_seen = 0;
+	unsigned long int pending;
+
+	// The starting row is looked at twice (from 'col', then from 0 after
+	// wrapping around), so everything is covered once.
+	while( ( used < budget ) && ( rows_seen <= LCD_nPAGES ) )
+	{
+		pending = lcd_shadow_dirty[ row ] >> col;
+
+		if( pending == 0 )
+		{
+			row = ( row + 1 ) % LCD_nPAGES;
+			col = 0;
+			rows_seen++;
+			continue;
+		}
+
+		while( ( pending & 1 ) == 0 )
+		{
+			pending >>= 1;
+			col++;
+		}
+
+		// A move is only worth making if its character goes with it.
+		if( ( row != lcd_cursor_row ) || ( col != lcd_cursor_col ) )
+		{
+			if( ( used > 0 ) && ( used + 2 > budget ) )
+				break;
+
+			LCD_set_RC( row, col );
+			used++;
+		}
+
+		LCD_putchar( lcd_shadow_cells[ row ][ col ] );
+		lcd_shadow_dirty[ row ] &= ~( 1UL << col );
+		used++;
+
+		// The display's cursor is unknown after the last column.
+		lcd_cursor_row = row;
+		lcd_cursor_col = ++col;
+
+		if( col == LCD_nCOLS )
+		{
+			row = ( row + 1 ) % LCD_nPAGES;
+			col = 0;
+			rows_seen++;
+		}
+	} // end while()
+
+	lcd_shadow_row = row;
+	lcd_shadow_col = col;
+
+	return used;
+} // end lcd_shadow_flush()
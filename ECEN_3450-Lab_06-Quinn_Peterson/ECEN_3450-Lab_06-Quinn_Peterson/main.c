@@ -22,8 +22,9 @@
 //= Desc:		Main file that everything else runs off.						=
 //= Functions:	CBOT_main()														=
 //= Other:		Globals.														=
-//= Note:		On start, user must add "libcapi324v22x" and "libprintf_flt"	=
-//=				to the project libraries.										=
+//= Note:		On start, user must add "libcapi324v22x" to the project			=
+//=				libraries.  Text goes through fmt.c, so neither					=
+//=				"libprintf_flt" nor the vfprintf() link option is needed.		=
 //===============================================================================
 
 //===============================================================================
@@ -40,6 +41,43 @@
 // MOTOR_ACTION is declared.
 volatile MOTOR_ACTION action; 
 
+// The arbitration table (see arbiter.c).  Sense tasks come first so their
+// data is fresh for the behaviors; behaviors follow from HIGHEST to lowest
+// priority; tasks come last so they see the winner.  Adding an entry costs
+// one line here and ~13 bytes of RAM (raise ARBITER_MAX_ENTRIES to match).
+static const ARBITER_ENTRY behavior_table[] PROGMEM = {
+	ARB_SENSE( IR_sense, IR_SENSE_MS, SENSE_IR, PROF_IR_SENSE ),
+	ARB_SENSE( PR_sense, PR_SENSE_MS, SENSE_PR, PROF_PR_SENSE ),
+	ARB_SENSE( range_sense, RANGE_SENSE_MS, SENSE_RANGE, PROF_RANGE_SENSE ),
+	ARB_SENSE( odom_sense, ODOM_SENSE_MS, SENSE_POSE, PROF_ODOM_SENSE ),
+#if PANO_ENABLED
+	ARB_SENSE( pano_sense, PANO_STEP_MS, SENSE_PANO, PROF_PANO_SENSE ),
+#endif
+	ARB_SENSE( stack_sense, STACK_CHECK_MS, 0, PROF_STACK_SENSE ),
+	ARB_BEHAVIOR( IR_avoid, SENSE_IR, ARB_RUN_WHILE_ACTIVE, PROF_IR_AVOID ),
+#if PR_HOMING_PID
+	ARB_BEHAVIOR( light_home, SENSE_PR, 0, PROF_LIGHT_FOLLOW ),
+#else
+	ARB_BEHAVIOR( light_follow, SENSE_PR, 0, PROF_LIGHT_FOLLOW ),
+#endif
+//	ARB_BEHAVIOR( light_observe, SENSE_PR, 0, PROF_LIGHT_FOLLOW ),
+	ARB_BEHAVIOR( light_search, SENSE_POSE | SENSE_PANO, ARB_RUN_WHILE_ACTIVE, PROF_SEARCH ),
+	ARB_BEHAVIOR( explore, 0, 0, PROF_EXPLORE ),
+	ARB_TASK( drive_task, 0, PROF_ACT ),
+	ARB_TASK( display_task, 0, PROF_LCD ),
+#if TELEMETRY_ENABLED
+	ARB_TASK( telemetry_task, 0, PROF_TELEMETRY ),
+#endif
+#if FLIGHTREC_ENABLED
+	ARB_TASK( flightrec_task, 0, PROF_FLIGHTREC ),
+#endif
+};
+
+// The arbiter has ARBITER_MAX_ENTRIES slots: a longer table fails to
+// compile here (negative array size) instead of losing its last entries.
+typedef char behavior_table_fits[
+	( ARBITER_COUNT( behavior_table ) <= ARBITER_MAX_ENTRIES ) ? 1 : -1 ];
+
 //===============================================================================
 //= What:	CBOT_main()															=
 //= Why:	Main function of the program. 										=
@@ -55,8 +93,9 @@ void CBOT_main( void )
 	
 	volatile SENSOR_DATA sensor_data;
 	
-	// Calibrate the PR sensors
-	calibrate_pr( &sensor_data );
+	// Load the calibration from EEPROM; only without a good record (or
+	// with SW3 held at power-on) does this wait to calibrate the PR sensors.
+	BOOL calibrated = calib_open( &sensor_data );
 	/*
 	// Get the calibration settings (PR_delta_RL)
 	int switch_bool = 1;
@@ -76,43 +115,56 @@ void CBOT_main( void )
 	// Reset the current motor action.
 	__RESET_ACTION( action );
 	
-	// Notify program is about to start.
-	LCD_clear();
-	LCD_printf( "Starting...\n" );
+	// After a fresh calibration the operator is standing at the robot:
+	// notify program is about to start and wait 3 seconds or so.
+	if( calibrated == TRUE )
+	{
+		LCD_clear();
+		fmt_lcd_RC( 0, 0, "Starting...\n" );
+		TMRSRVC_delay( TMR_SECS( 3 ) );
+	}
 	
-	// Wait 3 seconds or so.
-	TMRSRVC_delay( TMR_SECS( 3 ) );
+	// Clear the screen and enter the arbitration loop.  From here on the
+	// LCD is only written through its RAM shadow (see lcd_shadow.c).
+	lcd_shadow_open();
 	
-	// Clear the screen and enter the arbitration loop.
-	LCD_clear();
+	// Dead reckoning starts here: the pose is relative to where CEENBoT
+	// sits now (see odometry.c).
+	odom_open( &sensor_data );
+	
+	// Register the behavior table, start its sense schedule and start
+	// every task from the top.
+	arbiter_open( behavior_table, ARBITER_COUNT( behavior_table ) );
+	
+#if TELEMETRY_ENABLED
+	// Start streaming binary frames on UART0 (see telemetry.c).
+	telemetry_open( TELEMETRY_PERIOD_MS );
+#endif
+
+#if FLIGHTREC_ENABLED
+	// Start a new run in the SPI flash log (see flightrec.c).  Without
+	// the flash the recorder just stays off.
+	flightrec_open();
+#endif
 	
 	// Enter the 'arbitration' while() loop -- it is important that NONE
 	// of the behavior functions listed in the arbitration loop BLOCK!
-	// Behaviors are listed in increasing order of priority, with the last
-	// behavior having the greatest priority (because it has the last 'say'
-	// regarding motor action (or any action)).
 	while( 1 )
 	{
-		// Sense must always happen first.
-		// (IR sense happens every 125ms).
-		IR_sense( &sensor_data, 125 );
-		PR_sense( &sensor_data, 125 );
+		// Start timing this pass of the loop (see profiler.c).
+		PROFILE_LOOP_START();
 		
-		// ================= Behaviors.
-		// Priority (least to greatest): explore, light_follow, ir_avoid
-		// Note that 'avoidance' relies on sensor data to determine
-		// whether or not 'avoidance' is necessary.
-		explore( &action );
-		light_follow( &action, &sensor_data );
-//		light_observe( &action, &sensor_data );
-		IR_avoid( &action, &sensor_data );
+		// Sense what is due, then let the highest-priority active
+		// behavior (greatest to least: ir_avoid, light_follow,
+		// light_search, explore) set the action.  Only behaviors with new
+		// input are re-run.  Then resume every task: drive (slow down
+		// near obstacles and act), display, telemetry and the flight
+		// recorder, each waiting on its own time or event.
+		arbiter_run( &action, &sensor_data );
 		
-		// Perform the action of highest priority.
-		act( &action );
-
-		// Real-time display info, should happen last, if possible
-		// (except for 'ballistic' behaviors).  Technically this is
-		// sort of 'optional' as it does not constitute a 'behavior'.
-		info_display( &action );
+		// Answer UART0 commands ('p' = profiler report, 'r' = reset it,
+		// 'd' = dump the flight recorder, 's' = stack headroom,
+		// 'c' = save the PR balance).
+		command_service( &sensor_data );
 	} // end while()
 } // end CBOT_main()
@@ -0,0 +1,194 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	odometry.c														=
+//= Desc:		Dead reckoning from the steppers.  A sense task integrates		=
+//=				each wheel's current speed over stopwatch time into a			=
+//=				fixed-point pose (x, y, heading) in SENSOR_DATA.				=
+//= Functions:	odom_open(), odom_command(), odom_sense()						=
+//= Other:		The stepper driver reports speed, not direction, so each		=
+//=				wheel's direction comes from the last command act() sent		=
+//=				(odom_command()).  Wheel geometry follows from DEG_90: a 90		=
+//=				degree in-place turn is DEG_90 steps on each wheel.				=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// sin() over the first quadrant, 64 steps plus the end point, Q14.
+static const signed short int odom_sine[ 65 ] PROGMEM = {
+	    0,   402,   804,  1205,  1606,  2006,  2404,  2801,
+	 3196,  3590,  3981,  4370,  4756,  5139,  5520,  5897,
+	 6270,  6639,  7005,  7366,  7723,  8076,  8423,  8765,
+	 9102,  9434,  9760, 10080, 10394, 10702, 11003, 11297,
+	11585, 11866, 12140, 12406, 12665, 12916, 13160, 13395,
+	13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978,
+	15137, 15286, 15426, 15557, 15679, 15791, 15893, 15986,
+	16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379,
+	16384
+};
+
+// Heading with the fraction kept (2^32 = one turn); the pose gets the
+// top 16 bits.
+static unsigned long int odom_heading = 0;
+
+// Travel not yet whole enough to add to the pose, per wheel, in Q8
+// steps times ODOM_TICKS_PER_SEC.
+static unsigned long int odom_rem_L = 0;
+static unsigned long int odom_rem_R = 0;
+
+// Direction of each wheel's last non-zero command (+1 or -1).
+static signed char odom_dir_L = 1;
+static signed char odom_dir_R = 1;
+
+// Stopwatch time of the last update.
+static SWTIME odom_last = 0;
+
+//===============================================================================
+//= What:	odom_sin()															=
+//= Why:	Fixed-point sine for the pose update.								=
+//= Return:	signed short int (sin( angle ), Q14).								=
+//= Params:	unsigned short int angle (65536 = one turn)							=
+//= Notes:	Table lookup with linear interpolation; within 0.0002 of sin().		=
+//=			cos( a ) is odom_sin( a + 0x4000 ).									=
+//===============================================================================
+static signed short int odom_sin( unsigned short int angle )
+{
+	unsigned short int a = angle & 0x3FFF;
+	unsigned char i;
+	signed short int s, next;
+
+	// Second and fourth quadrants run the table backwards.
+	if( angle & 0x4000 )
+		a = 0x4000 - a;
+
+	i = ( unsigned char )( a >> 8 );
+	s = ( signed short int ) pgm_read_word( &odom_sine[ i ] );
+	if( i < 64 )
+	{
+		next = ( signed short int ) pgm_read_word( &odom_sine[ i + 1 ] );
+		s += ( signed short int )( ( ( signed long int )( next - s ) * ( a & 0xFF ) ) >> 8 );
+	}
+
+	return ( angle & 0x8000 ) ? -s : s;
+} // end odom_sin()
+
+//===============================================================================
+//= What:	odom_wheel()														=
+//= Why:	One wheel's travel since the last update.							=
+//= Return:	signed long int (travel, Q8 steps, signed by direction).			=
+//= Params:	signed short int speed (current speed, steps/sec)					=
+//=			signed char dir (+1 or -1, from the last command)					=
+//=			unsigned long int *pRem (the wheel's carried remainder)				=
+//=			SWTIME dt (stopwatch ticks since the last update)					=
+//= Notes:	The remainder carries the fraction below 1/256 step, so slow		=
+//=			speeds and short intervals add up instead of rounding away.			=
+//===============================================================================
+static signed long int odom_wheel( signed short int speed, signed char dir,
+	unsigned long int *pRem, SWTIME dt )
+{
+	unsigned long int q8;
+
+	if( speed < 0 )
+		speed = -speed;
+
+	*pRem += ( unsigned long int ) speed * dt * 256;
+	q8 = *pRem / ODOM_TICKS_PER_SEC;
+	*pRem -= q8 * ODOM_TICKS_PER_SEC;
+
+	return ( dir > 0 ) ? ( signed long int ) q8 : -( signed long int ) q8;
+} // end odom_wheel()
+
+//===============================================================================
+//= What:	odom_open()															=
+//= Why:	Starts dead reckoning from here.									=
+//= Desc:	Zeroes the pose in SENSOR_DATA (x and y 0, heading 0 along the		=
+//=			way CEENBoT faces now) and starts timing from now.					=
+//= Return:	void.																=
+//= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	The stopwatch must already be running (see open_modules()).			=
+//===============================================================================
+void odom_open( volatile SENSOR_DATA *pSensors )
+{
+	pSensors->pose.x_q8 = 0;
+	pSensors->pose.y_q8 = 0;
+	pSensors->pose.heading = 0;
+
+	odom_heading = 0;
+	odom_rem_L = 0;
+	odom_rem_R = 0;
+	odom_last = STOPWATCH_get_ticks();
+} // end odom_open()
+
+//===============================================================================
+//= What:	odom_command()														=
+//= Why:	Tells the odometry which way each wheel was told to turn.			=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (the action just sent)				=
+//= Notes:	act() calls it with every action it commits.  A zero speed			=
+//=			keeps the previous direction, so a wheel coasting down to a			=
+//=			stop is still counted the right way.								=
+//===============================================================================
+void odom_command( volatile MOTOR_ACTION *pAction )
+{
+	if( pAction->speed_L > 0 )
+		odom_dir_L = 1;
+	else if( pAction->speed_L < 0 )
+		odom_dir_L = -1;
+
+	if( pAction->speed_R > 0 )
+		odom_dir_R = 1;
+	else if( pAction->speed_R < 0 )
+		odom_dir_R = -1;
+} // end odom_command()
+
+//===============================================================================
+//= What:	odom_sense()														=
+//= Why:	Sense task for the dead-reckoned pose.								=
+//= Desc:	Reads both wheels' current speed, turns it into travel over the		=
+//=			time since the last call, and moves the pose: heading by the		=
+//=			wheels' difference, position by their mean along the heading		=
+//=			halfway through the turn.  The arbiter calls it every				=
+//=			ODOM_SENSE_MS.														=
+//= Return:	BOOL (TRUE if the pose moved).										=
+//= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	Intervals are capped at ODOM_MAX_DT; a longer stall (a blocking		=
+//=			UART command) only happens with the steppers stopped.				=
+//===============================================================================
+BOOL odom_sense( volatile SENSOR_DATA *pSensors )
+{
+	SWTIME now = STOPWATCH_get_ticks();
+	SWTIME dt = now - odom_last;
+	STEPPER_SPEED speed = STEPPER_get_curr_speed();
+	signed long int d_L, d_R, turn;
+	unsigned short int mid;
+
+	odom_last = now;
+	if( dt > ODOM_MAX_DT )
+		dt = ODOM_MAX_DT;
+
+	d_L = odom_wheel( speed.left, odom_dir_L, &odom_rem_L, dt );
+	d_R = odom_wheel( speed.right, odom_dir_R, &odom_rem_R, dt );
+
+	if( ( d_L == 0 ) && ( d_R == 0 ) )
+		return FALSE;
+
+	// Counter-clockwise is positive: the right wheel gaining turns left.
+	turn = ( d_R - d_L ) * ODOM_BRAD32_PER_Q8;
+	mid = ( unsigned short int )( ( odom_heading + ( turn / 2 ) ) >> 16 );
+	odom_heading += turn;
+
+	// ( d_L + d_R ) / 2 along 'mid', rounded to the nearest 1/256 step.
+	pSensors->pose.x_q8 += ( ( d_L + d_R ) * odom_sin( mid + 0x4000 ) + 0x4000 ) >> 15;
+	pSensors->pose.y_q8 += ( ( d_L + d_R ) * odom_sin( mid ) + 0x4000 ) >> 15;
+	pSensors->pose.heading = ( unsigned short int )( odom_heading >> 16 );
+
+	return TRUE;
+} // end odom_sense()
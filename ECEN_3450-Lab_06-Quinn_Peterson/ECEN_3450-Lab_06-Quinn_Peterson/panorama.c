@@ -0,0 +1,190 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	panorama.c														=
+//= Desc:		Light panorama from a photoresistor on an RC servo.  A sense	=
+//=				task steps the servo back and forth across PANO_ARC_DEG and		=
+//=				reads the sensor at each step, keeping a brightness-by-angle	=
+//=				table; each finished sweep publishes the brightest bearing.		=
+//= Functions:	pano_open(), pano_sense(), pano_get()							=
+//= Other:		The servo is on the ATtiny's PANO_SERVO output and the sensor	=
+//=				on pano_pr_channel, scanned with the other ADC channels.		=
+//=				Everything here is compiled out unless PANO_ENABLED is 1.		=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+#if PANO_ENABLED
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Reading (raw ADC counts) and CEENBoT's heading at each step of the arc;
+// step 0 is the right end.
+static unsigned short int pano_level[ PANO_STEPS ];
+static unsigned short int pano_heading[ PANO_STEPS ];
+
+// Step the servo is at (or moving to), and which way the sweep runs.
+static unsigned char pano_step = 0;
+static signed char pano_dir = 1;
+
+// Short smoothing on the panorama channel, run by the ADC scan ISR.
+static ADC_FILTER pano_filter;
+
+//===============================================================================
+//= What:	pano_angle()														=
+//= Why:	Where step 'step' points, relative to straight ahead.				=
+//= Return:	signed short int (degrees, left positive).							=
+//= Params:	unsigned char step (0 to PANO_STEPS - 1)							=
+//===============================================================================
+static signed short int pano_angle( unsigned char step )
+{
+	return ( signed short int )( ( ( signed long int ) step * PANO_ARC_DEG ) / ( PANO_STEPS - 1 ) ) -
+		( PANO_ARC_DEG / 2 );
+} // end pano_angle()
+
+//===============================================================================
+//= What:	pano_servo()														=
+//= Why:	Points the servo at step 'step'.									=
+//= Return:	void.																=
+//= Params:	unsigned char step (0 to PANO_STEPS - 1)							=
+//= Notes:	Servo position 128 is straight ahead; higher is further left.		=
+//===============================================================================
+static void pano_servo( unsigned char step )
+{
+	signed short int pos = 128 + ( ( pano_angle( step ) * PANO_POS_PER_90 ) / 90 );
+
+	if( pos < 0 )
+		pos = 0;
+	else if( pos > 255 )
+		pos = 255;
+
+	ATTINY_set_RC_servo( PANO_SERVO, ( unsigned int ) pos );
+} // end pano_servo()
+
+//===============================================================================
+//= What:	pano_peak()															=
+//= Why:	Sub-step position of the brightest reading of a finished sweep.		=
+//= Desc:	Fits a parabola through the peak and its two neighbours; the		=
+//=			vertex is up to half a step either side of the peak.				=
+//= Return:	unsigned short int (bearing of the vertex, in pose heading			=
+//=			units).																=
+//= Params:	unsigned char i (step of the brightest reading)						=
+//= Notes:	At either end of the arc there is no outer neighbour, so the		=
+//=			peak step itself is used.											=
+//===============================================================================
+static unsigned short int pano_peak( unsigned char i )
+{
+	// Heading units per step.
+	signed long int per_step = ( ( signed long int ) PANO_ARC_DEG << 16 ) / ( 360L * ( PANO_STEPS - 1 ) );
+	signed long int a, b, c, den, frac = 0;
+
+	if( ( i > 0 ) && ( i < PANO_STEPS - 1 ) )
+	{
+		a = pano_level[ i - 1 ];
+		b = pano_level[ i ];
+		c = pano_level[ i + 1 ];
+		den = 2 * ( a - 2 * b + c );
+
+		// Q8 steps toward the brighter neighbour.
+		if( den < 0 )
+			frac = ( ( a - c ) * 256 ) / den;
+	}
+
+	return ( unsigned short int )( pano_heading[ i ] +
+		( ( ( signed long int ) pano_angle( i ) * 65536L ) / 360 ) +
+		( ( frac * per_step ) >> 8 ) );
+} // end pano_peak()
+
+//===============================================================================
+//= What:	pano_open()															=
+//= Why:	Readies the panorama.												=
+//= Desc:	Puts a short moving average on pano_pr_channel, sets every servo	=
+//=			to centre (as the CAPI asks before single-servo moves), then		=
+//=			sends the panorama servo to the right end of the arc.				=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Must run before adc_scan_open() (see open_modules()).				=
+//===============================================================================
+void pano_open( void )
+{
+	adc_filter_init( &pano_filter, ADC_FILTER_MOVING_AVG, PANO_FILTER_SHIFT );
+	adc_scan_set_filter( pano_pr_channel, &pano_filter );
+
+	ATTINY_set_RC_servos( 128, 128, 128, 128, 128 );
+
+	pano_step = 0;
+	pano_dir = 1;
+	pano_servo( pano_step );
+} // end pano_open()
+
+//===============================================================================
+//= What:	pano_sense()														=
+//= Why:	Sense task for the panorama.										=
+//= Desc:	The servo has had PANO_STEP_MS to get to the current step, so		=
+//=			reads the sensor and CEENBoT's heading into that step, then			=
+//=			moves on one step (turning round at either end).  At the end of		=
+//=			a sweep, publishes the brightest bearing (in pose heading units,	=
+//=			so it holds while CEENBoT turns), the brightest and dimmest			=
+//=			readings, and counts the sweep.  The arbiter calls it every			=
+//=			PANO_STEP_MS.														=
+//= Return:	BOOL (TRUE when a sweep has finished).								=
+//= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	A sweep is PANO_STEPS - 1 moves, so both ends are read once per		=
+//=			sweep and a pass and its return share the end step.					=
+//===============================================================================
+BOOL pano_sense( volatile SENSOR_DATA *pSensors )
+{
+	unsigned char i, brightest = 0;
+	unsigned short int dimmest = 0xFFFF;
+
+	pano_level[ pano_step ] = adc_scan_get( pano_pr_channel );
+	pano_heading[ pano_step ] = pSensors->pose.heading;
+
+	if( ( ( pano_dir > 0 ) && ( pano_step < PANO_STEPS - 1 ) ) ||
+		( ( pano_dir < 0 ) && ( pano_step > 0 ) ) )
+	{
+		pano_step += pano_dir;
+		pano_servo( pano_step );
+		return FALSE;
+	}
+
+	// End of a sweep: turn round, and publish it.
+	pano_dir = -pano_dir;
+	pano_step += pano_dir;
+	pano_servo( pano_step );
+
+	for( i = 0; i < PANO_STEPS; i++ )
+	{
+		if( pano_level[ i ] > pano_level[ brightest ] )
+			brightest = i;
+		if( pano_level[ i ] < dimmest )
+			dimmest = pano_level[ i ];
+	}
+
+	pSensors->pano_bearing = pano_peak( brightest );
+	pSensors->pano_peak = pano_level[ brightest ];
+	pSensors->pano_floor = dimmest;
+	pSensors->pano_sweeps++;
+
+	return TRUE;
+} // end pano_sense()
+
+//===============================================================================
+//= What:	pano_get()															=
+//= Why:	One entry of the brightness-by-angle table.							=
+//= Return:	unsigned short int (latest reading at 'step', raw ADC counts).		=
+//= Params:	unsigned char step (0 = right end of the arc; see pano_angle())		=
+//= Notes:	Out-of-range steps read 0.											=
+//===============================================================================
+unsigned short int pano_get( unsigned char step )
+{
+	return ( step < PANO_STEPS ) ? pano_level[ step ] : 0;
+} // end pano_get()
+
+#endif // PANO_ENABLED
@@ -0,0 +1,84 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	pid.c															=
+//= Desc:		Fixed-point PID controller, one update per sample.  Integral	=
+//=				anti-windup and a low-pass filtered derivative.					=
+//= Functions:	pid_reset(), pid_update()										=
+//= Other:		Gains are Q8 and per sample, so they hold for one sample		=
+//=				period only: a loop run at a different rate needs new gains.	=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	pid_reset()															=
+//= Why:	Forgets the history (integral and derivative) of a controller.		=
+//= Return:	void.																=
+//= Params:	PID_STATE *pPid (controller to reset; gains are kept)				=
+//= Notes:	Call whenever the loop has been open, so stale history does not		=
+//=			kick the first output.												=
+//===============================================================================
+void pid_reset( PID_STATE *pPid )
+{
+	pPid->integral = 0;
+	pPid->last = 0;
+	pPid->d_filt = 0;
+	pPid->primed = FALSE;
+} // end pid_reset()
+
+//===============================================================================
+//= What:	pid_update()														=
+//= Why:	One controller step.												=
+//= Desc:	out = ( kp * e + ki * sum( e ) + kd * filtered de ) / 256, clamped	=
+//=			to +/- out_max.  The error change is low-pass filtered (one pole,	=
+//=			time constant 2^d_shift samples) before kd sees it.  The integral	=
+//=			is clamped to +/- i_max and does not grow while the output is		=
+//=			saturated in the direction the error pushes it.						=
+//= Return:	signed short int (controller output).								=
+//= Params:	PID_STATE *pPid (gains and history)									=
+//=			signed short int error (setpoint - measurement)						=
+//= Notes:	The first update after pid_reset() has no derivative term.			=
+//===============================================================================
+signed short int pid_update( PID_STATE *pPid, signed short int error )
+{
+	signed long int integral = pPid->integral + error;
+	signed long int out;
+
+	if( integral > pPid->i_max )
+		integral = pPid->i_max;
+	else if( integral < -pPid->i_max )
+		integral = -pPid->i_max;
+
+	// Error change, kept in Q4 through the filter so slow changes survive.
+	if( pPid->primed == TRUE )
+		pPid->d_filt += ( ( ( signed long int )( error - pPid->last ) << 4 ) - pPid->d_filt ) >> pPid->d_shift;
+	pPid->last = error;
+	pPid->primed = TRUE;
+
+	out = ( ( signed long int ) pPid->kp * error +
+			( signed long int ) pPid->ki * integral +
+			( ( ( signed long int ) pPid->kd * pPid->d_filt ) >> 4 ) ) >> 8;
+
+	if( out > pPid->out_max )
+	{
+		out = pPid->out_max;
+		if( error > 0 )
+			integral = pPid->integral;
+	}
+	else if( out < -pPid->out_max )
+	{
+		out = -pPid->out_max;
+		if( error < 0 )
+			integral = pPid->integral;
+	}
+
+	pPid->integral = integral;
+
+	return ( signed short int ) out;
+} // end pid_update()
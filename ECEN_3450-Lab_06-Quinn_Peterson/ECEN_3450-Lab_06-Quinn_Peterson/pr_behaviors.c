@@ -5,7 +5,9 @@
 //= Due Date:	03/16/18														=
 //= File Name:	pr_behaviors.c													=
 //= Desc:		Contains the behaviors relating to the photoresistors.			=
-//= Functions:	get_PR_diff(), PR_sense(), light_follow(), light_observe()		=
+//= Functions:	PR_filter_open(), calibrate_pr(), get_PR_diff(), PR_sense(),	=
+//=				PR_display(), PR_speed_plus(), light_follow(), light_home(),	=
+//=				light_observe()													=
 //= Other:		none.															=
 //===============================================================================
 
@@ -14,161 +16,369 @@
 //===============================================================================
 #include "ECEN3450Lab06.h"
 
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Photoresistor filters, run by the ADC scan ISR on every sample.
+static ADC_FILTER pr_filter_L;
+static ADC_FILTER pr_filter_R;
+
+//===============================================================================
+//= What:	PR_filter_open()													=
+//= Why:	Smooths the photoresistor noise that makes light_follow chatter		=
+//=			at the edge of the PR_DIFF_MIN band.								=
+//= Desc:	Attaches a PR_FILTER_MODE filter of length 2^PR_FILTER_SHIFT to		=
+//=			both photoresistor channels.										=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Must run before adc_scan_open().									=
+//===============================================================================
+void PR_filter_open( void )
+{
+	adc_filter_init( &pr_filter_L, PR_FILTER_MODE, PR_FILTER_SHIFT );
+	adc_filter_init( &pr_filter_R, PR_FILTER_MODE, PR_FILTER_SHIFT );
+	
+	adc_scan_set_filter( left_pr_channel, &pr_filter_L );
+	adc_scan_set_filter( right_pr_channel, &pr_filter_R );
+} // end PR_filter_open()
+
+//===============================================================================
+//= What:	PR_scan_gain()														=
+//= Why:	Gain (Q8) that stretches one sensor's swept span to PR_NORM_SPAN.	=
+//= Return:	unsigned short int (gain, Q8).										=
+//= Params:	unsigned short int dark (darkest reading in the spin)				=
+//=			unsigned short int bright (brightest reading in the spin)			=
+//= Notes:	A span under PR_SCAN_MIN_SPAN (no lamp in view, or a dead			=
+//=			sensor) is treated as PR_SCAN_MIN_SPAN so the gain stays sane.		=
+//===============================================================================
+static unsigned short int PR_scan_gain( unsigned short int dark, unsigned short int bright )
+{
+	unsigned short int span = bright - dark;
+	
+	if( span < PR_SCAN_MIN_SPAN )
+		span = PR_SCAN_MIN_SPAN;
+	
+	return ( unsigned short int )( ( ( unsigned long int ) PR_NORM_SPAN << 8 ) / span );
+} // end PR_scan_gain()
+
+//===============================================================================
+//= What:	PR_spin_scan()														=
+//= Why:	Measures what each photoresistor reads in this room, from the		=
+//=			darkest direction to the lamp.										=
+//= Desc:	Starts one full turn in place as a non-blocking stepper move and	=
+//=			samples both channels from the ADC scan every PR_SCAN_SAMPLE_MS		=
+//=			until the move is done.  Each channel's darkest reading becomes		=
+//=			its offset, and its gain maps darkest..brightest onto				=
+//=			0..PR_NORM_SPAN (see calib.PR_offset_L and friends).				=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Takes about PR_SCAN_STEPS / PR_SCAN_SPEED seconds.  Both sensors	=
+//=			see the whole circle, so their tables are directly comparable.		=
+//===============================================================================
+static void PR_spin_scan( void )
+{
+	unsigned short int dark_L = 1023, bright_L = 0;
+	unsigned short int dark_R = 1023, bright_R = 0;
+	unsigned short int left, right;
+	ADC_SNAPSHOT snapshot;
+	STEPPER_STEPS steps;
+	
+	STEPPER_move_stnb( STEPPER_BOTH,
+		STEPPER_FWD, PR_SCAN_STEPS, PR_SCAN_SPEED, PR_SCAN_ACCEL, STEPPER_BRK_OFF,
+		STEPPER_REV, PR_SCAN_STEPS, PR_SCAN_SPEED, PR_SCAN_ACCEL, STEPPER_BRK_OFF );
+	
+	do
+	{
+		DELAY_ms( PR_SCAN_SAMPLE_MS );
+		
+		adc_scan_snapshot( &snapshot );
+		left = snapshot.sample[ left_pr_channel ];
+		right = snapshot.sample[ right_pr_channel ];
+		
+		if( left < dark_L )		dark_L = left;
+		if( left > bright_L )	bright_L = left;
+		if( right < dark_R )	dark_R = right;
+		if( right > bright_R )	bright_R = right;
+		
+		steps = STEPPER_get_nSteps();
+	} while( ( steps.left != 0 ) || ( steps.right != 0 ) );
+	
+	calib.PR_offset_L = ( signed short int ) dark_L;
+	calib.PR_offset_R = ( signed short int ) dark_R;
+	calib.PR_gain_L = PR_scan_gain( dark_L, bright_L );
+	calib.PR_gain_R = PR_scan_gain( dark_R, bright_R );
+} // end PR_spin_scan()
+
 //===============================================================================
 //= What:	calibrate_pr()														=
 //= Why:	Calibrate the photoresistors in case the values aren't even.		=
-//= Desc:	Wait for Switch 3 to be pressed, then calibrate the sensors.		=
+//= Desc:	Wait for Switch 3 to be pressed, then spin in place to build		=
+//=			each sensor's offset and gain (PR_spin_scan()), and take the		=
+//=			left - right balance once back at the starting heading.				=
 //= Return:	void.																=
 //= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
-//= Notes:	none.																=
+//= Notes:	Polls the ATtiny snapshot every TINY_POLL_MS rather than			=
+//=			hammering the SPI bus.  CEENBoT needs room to turn around.			=
 //===============================================================================
 void calibrate_pr( volatile SENSOR_DATA *pSensors )
 {
 	// Get the calibration settings (PR_delta_RL)
 	int switch_bool = 1;
 	LCD_clear();
-	LCD_printf("ECEN 3450: Mob Rob\nLab5: Light Homing\nQuinn & Peterson\nSW3: Calibrate");
+	fmt_lcd_RC( 0, 0, "ECEN 3450: Mob Rob\nLab5: Light Homing\nQuinn & Peterson\nSW3: Calibrate" );
 	while(switch_bool == 1)
 	{
-		if(ATTINY_get_SW_state(ATTINY_SW3))
+		tiny_sense_update();
+		if(tiny_sense_SW_pressed(ATTINY_SW3))
 		{
 			DELAY_ms(400);
+			LCD_clear();
+			fmt_lcd_RC( 0, 0, "Scanning light...\n" );
+			PR_spin_scan();
 			get_PR_diff( pSensors );
 			switch_bool = 0;
 		}
+		else
+		{
+			DELAY_ms(TINY_POLL_MS);
+		}
 	}
 }
 
+//===============================================================================
+//= What:	PR_normalize()														=
+//= Why:	Puts a raw reading on the scale the spin scan measured.				=
+//= Return:	unsigned short int (normalized reading, 0 to 1023).					=
+//= Params:	unsigned short int raw (ADC counts)									=
+//=			signed short int offset (calib.PR_offset_L or _R)					=
+//=			unsigned short int gain (calib.PR_gain_L or _R, Q8)					=
+//= Notes:	With the defaults (offset 0, gain CALIB_GAIN_ONE) it returns		=
+//=			'raw' unchanged.													=
+//===============================================================================
+unsigned short int PR_normalize( unsigned short int raw, signed short int offset,
+	unsigned short int gain )
+{
+	signed long int value = ( ( ( signed long int ) raw - offset ) * gain ) >> 8;
+	
+	if( value < 0 )
+		return 0;
+	if( value > 1023 )
+		return 1023;
+	return ( unsigned short int ) value;
+} // end PR_normalize()
+
 //===============================================================================
 //= What:	get_PR_diff()														=
 //= Why:	In case the photoresistors aren't balanced, this finds the			=
 //=			difference so that it can be added to smaller value.				=
-//= Desc:	Reads from both photoresistors, and stores delta (left - right).	=
+//= Desc:	Reads both photoresistors from the latest ADC scan, and stores		=
+//=			delta (left - right).												=
 //= Return:	void.																=
 //= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
 //= Notes:	none.																=
 //===============================================================================
 void get_PR_diff( volatile SENSOR_DATA *pSensors )
 {
-	// Get
-	ADC_set_channel(left_pr_channel);
-	pSensors->left_PR  = ADC_sample();
+	// Get both sensors from the same ADC scan.
+	ADC_SNAPSHOT snapshot;
+	adc_scan_snapshot( &snapshot );
 	
-	ADC_set_channel(right_pr_channel);
-	pSensors->right_PR = ADC_sample();
+	pSensors->left_PR  = snapshot.sample[ left_pr_channel ];
+	pSensors->right_PR = snapshot.sample[ right_pr_channel ];
 	
 	pSensors->PR_delta_LR = (pSensors->left_PR - pSensors->right_PR);
 }
 
 //===============================================================================
 //= What:	PR_sense()															=
-//= Why:	Behavior to read photoresistor values.								=
-//= Desc:	Starts the timer service if it hasn't been yet, otherwise it will	=
-//=			read from the photoresistors every "interval_ms".					=
-//= Return:	void.																=
+//= Why:	Sense task to read photoresistor values.							=
+//= Desc:	Copies both photoresistors from the latest ADC scan.  The arbiter	=
+//=			calls it every PR_SENSE_MS.											=
+//= Return:	BOOL (TRUE if either reading changed since the last call).			=
 //= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
-//=			TIMER16 interval_ms (number of ms between checks of the sensor)		=
 //= Notes:	none.																=
 //===============================================================================
-void PR_sense( volatile SENSOR_DATA *pSensors, TIMER16 interval_ms )
+BOOL PR_sense( volatile SENSOR_DATA *pSensors )
 {
-	// Sense must know if it's already sensing.
-	//
-	// NOTE: 'BOOL' is a custom data type offered by the CEENBoT API.
-	//
-	static BOOL timer_started = FALSE;
-	
-	// The 'sense' timer is used to control how often gathering sensor
-	// data takes place.  The pace at which this happens needs to be
-	// controlled.  So we're forced to use TIMER OBJECTS along with the
-	// TIMER SERVICE.  It must be 'static' because the timer object must remain
-	// 'alive' even when it is out of scope -- otherwise the program will crash.
-	static TIMEROBJ sense_timer;
-	
-	// If this is the FIRST time that sense() is running, we need to start the
-	// sense timer.  We do this ONLY ONCE!
-	if ( timer_started == FALSE )
-	{
-		// Start the 'sense timer' to tick on every 'interval_ms'.
-		//
-		// NOTE:  You can adjust the delay value to suit your needs.
-		//
-		TMRSRVC_new( &sense_timer, TMRFLG_NOTIFY_FLAG, TMRTCM_RESTART,
-		interval_ms );
-		
-		// Mark that the timer has already been started.
-		timer_started = TRUE;
-	} // end if()
+	// Both photoresistors, copied from one ADC scan.
+	ADC_SNAPSHOT snapshot;
+	BOOL changed;
 	
-	// Otherwise, just do the usual thing and just 'sense'.
-	else
-	{
-		// Only read the sensors when it is time to do so (e.g., every
-		// 125ms).  Otherwise, do nothing.
-		if ( TIMER_ALARM( sense_timer ) )
-		{
-			// NOTE: Just as a 'debugging' feature, let's also toggle the green LED
-			//       to know that this is working for sure.  The LED will only
-			//       toggle when 'it's time'.
-			LED_toggle( LED_Red );
-			
-			ADC_set_channel(left_pr_channel);
-			pSensors->left_PR  = ADC_sample();
-			
-			ADC_set_channel(right_pr_channel);
-			pSensors->right_PR = ADC_sample();
-
-			// Snooze the alarm so it can trigger again.
-			TIMER_SNOOZE( sense_timer );
-		} // end if()
-	} // end else.
+	// NOTE: Just as a 'debugging' feature, let's also toggle the red LED
+	//       to know that this is working for sure.
+	LED_toggle( LED_Red );
+	
+	// Latest scan results -- no conversion wait here.
+	adc_scan_snapshot( &snapshot );
+	
+	changed = ( snapshot.sample[ left_pr_channel ] != pSensors->left_PR ) ||
+			  ( snapshot.sample[ right_pr_channel ] != pSensors->right_PR );
+	
+	pSensors->left_PR  = snapshot.sample[ left_pr_channel ];
+	pSensors->right_PR = snapshot.sample[ right_pr_channel ];
+	
+	return changed;
 } // end PR_sense()
 
+//===============================================================================
+//= What:	PR_display()														=
+//= Why:	Shows both photoresistor voltages on the LCD.						=
+//= Return:	void.																=
+//= Params:	unsigned int L, unsigned int R (raw counts, 1 count = 5V / 1024)	=
+//= Notes:	Volts to the millivolt ("Left  PR: 2.345"), through the shadow.		=
+//===============================================================================
+static void PR_display( unsigned int L, unsigned int R )
+{
+	char text[ LCD_nCOLS + 1 ];
+	FMT_BUF line;
+
+	fmt_open( &line, text, sizeof( text ) );
+	fmt_str_P( &line, PSTR( "Left  PR: " ), 0 );
+	fmt_fixed( &line, PR_MILLIVOLTS( L ), 3, 0 );
+	lcd_shadow_puts_RC( LCD_Row_PR_L, 0, text );
+
+	fmt_open( &line, text, sizeof( text ) );
+	fmt_str_P( &line, PSTR( "Right PR: " ), 0 );
+	fmt_fixed( &line, PR_MILLIVOLTS( R ), 3, 0 );
+	lcd_shadow_puts_RC( LCD_Row_PR_R, 0, text );
+} // end PR_display()
+
+//===============================================================================
+//= What:	PR_speed_plus()														=
+//= Why:	Volts * gain plus an offset, in steps/sec, truncated toward zero	=
+//=			as the float version's conversion to an integer was.				=
+//= Return:	signed long int (speed, steps/sec).									=
+//= Params:	unsigned int counts (raw counts, 1 count = 5V / 1024)				=
+//=			unsigned short int gain (steps/sec per volt)						=
+//=			signed long int offset (steps/sec added before truncating)			=
+//= Notes:	Works in Q10 (counts * 5 * gain is volts * gain * 1024), so C's		=
+//=			division gives the same result as the float version even when		=
+//=			the offset makes the sum negative.  PR_SPEED() is only exact for	=
+//=			sums that stay positive.											=
+//===============================================================================
+static signed long int PR_speed_plus( unsigned int counts, unsigned short int gain,
+	signed long int offset )
+{
+	return ( ( signed long int )( counts * ( 5UL * gain ) ) + offset * 1024L ) / 1024L;
+} // end PR_speed_plus()
+
 //===============================================================================
 //= What:	light_follow()														=
-//= Why:	Behavior to read ballistically stop CEENBoT, reverse, and turn it.	=
-//= Desc:	
+//= Why:	Behavior to steer CEENBoT toward the brighter photoresistor.		=
+//= Desc:	If the average normalized light level is in range and one side		=
+//=			is brighter by more than PR_DIFF_MIN, slow the bright side and		=
+//=			speed up the dark side so CEENBoT turns toward the light.			=
 //= Return:	void.																=
 //= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
 //=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
-//= Notes:	none.																=
+//= Notes:	Integer-only.  The tests use normalized counts (PR_NORM_SPAN		=
+//=			from the darkest to the brightest direction at calibration); the	=
+//=			speeds still come from raw ADC counts (Q10 fractions of 5V),		=
+//=			then go through kin_drive().  'make fixedcheck' in sim/ checks		=
+//=			it against the float version over the whole 10-bit input space.		=
 //===============================================================================
 void light_follow(volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors)
 {
-	// Get voltage from sensors.
-	float Lv = ( ( ( pSensors->left_PR  ) * 5.0f ) / 1024 );	// L voltage and L sensor level
-	float Rv = ( ( ( pSensors->right_PR ) * 5.0f ) / 1024 );	// R voltage and R sensor level
+	// Get counts from sensors (1 count = 5V / 1024).
+	unsigned int L = pSensors->left_PR;		// L sensor level
+	unsigned int R = pSensors->right_PR;	// R sensor level
 	
-	// Average
-	float average = (Rv + Lv) / 2.0f;
-	float diff_LR = ( Lv - Rv );
+	// The same, normalized (0 = darkest direction seen at calibration).
+	unsigned int nL = PR_normalize( L, calib.PR_offset_L, calib.PR_gain_L );
+	unsigned int nR = PR_normalize( R, calib.PR_offset_R, calib.PR_gain_R );
+	
+	// PR_delta_LR holds the signed left - right difference at calibration.
+	signed short int delta = ( signed short int ) pSensors->PR_delta_LR;
+	
+	// Wheel speeds from the speed law (steps/sec).
+	signed long int speed_L, speed_R;
+	
+	// Sum stands in for the average, diff is the signed left - right.
+	unsigned int sum = nL + nR;
+	signed int diff_LR = ( signed int ) nL - ( signed int ) nR;
 		
 	// If threshold (average) is hit, then light follow, else default.
-	if(	( average > 0.9f && average < 4.3f ) &&
-		( diff_LR > 0.5f || diff_LR < -0.5f ) )
+	if(	( sum > PR_SUM_MIN && sum < PR_SUM_MAX ) &&
+		( diff_LR > ( signed int ) PR_DIFF_MIN || diff_LR < -( signed int ) PR_DIFF_MIN ) )
 	{
-		// Set motor action and display values
+		// Set motor action and display values (in millivolts)
 		pAction->state = LIGHT_FOLLOW;
-		LCD_printf_RC(LCD_Row_PR_L, 0, "Left  PR: %f", Lv);
-		LCD_printf_RC(LCD_Row_PR_R, 0, "Right PR: %f", Rv);
+		PR_display( L, R );
 		
 		// More light on left, Left > Right
 		// Right is speed up, and delta added to right
-		if( diff_LR >= 0.5f )
+		if( diff_LR > 0 )
 		{
-			pAction->speed_L = Lv*50;
-			pAction->speed_R = Rv*200 + ( pSensors->PR_delta_LR );
+			speed_L = PR_SPEED( L, calib.PR_gain_slow );
+			speed_R = PR_speed_plus( R, calib.PR_gain_fast, delta );
 		}
 		// Left < Right
 		// Left is speed up, and delta (which is negative) is subtracted from left
 		else 
 		{
-			pAction->speed_L = Lv*200 - ( pSensors->PR_delta_LR );
-			pAction->speed_R = Rv*50;
+			speed_L = PR_speed_plus( L, calib.PR_gain_fast, -( signed long int ) delta );
+			speed_R = PR_SPEED( R, calib.PR_gain_slow );
 		}
+		
+		// The same wheel speeds as forward speed and turn rate, which
+		// kin_drive() keeps within what the steppers can follow.
+		kin_drive( pAction, ( signed short int )( ( speed_L + speed_R ) / 2 ),
+			( signed short int )( ( ( speed_R - speed_L ) * 90 ) / ( 2 * DEG_90 ) ), PR_FOLLOW_ACCEL );
 	}
 } // end light_follow()
 
+//===============================================================================
+//= What:	light_home()														=
+//= Why:	Behavior to steer CEENBoT smoothly onto the light.					=
+//= Desc:	Whenever the normalized light level is above PR_SUM_MIN, a PID		=
+//=			loop turns the left/right imbalance, ( nL - nR ) / ( nL + nR ),		=
+//=			into a turn rate, and the forward speed falls from HOME_V_FAR		=
+//=			at PR_SUM_MIN to HOME_V_NEAR at PR_SUM_MAX as the light gets		=
+//=			brighter.  Below PR_SUM_MIN it proposes nothing (light_search()		=
+//=			runs) and the controller is reset.									=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	Runs once per PR_SENSE_MS sample, the period the HOME_K* gains		=
+//=			are tuned for.  The error is in 1/256ths of the total, so the		=
+//=			gains do not change with distance to the lamp.						=
+//===============================================================================
+void light_home( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	static PID_STATE pid = {
+		HOME_KP, HOME_KI, HOME_KD, HOME_D_SHIFT, HOME_I_MAX, HOME_W_MAX,
+		0, 0, 0, FALSE
+	};
+	
+	unsigned int L = pSensors->left_PR;
+	unsigned int R = pSensors->right_PR;
+	unsigned int nL = PR_normalize( L, calib.PR_offset_L, calib.PR_gain_L );
+	unsigned int nR = PR_normalize( R, calib.PR_offset_R, calib.PR_gain_R );
+	unsigned int sum = nL + nR;
+	signed short int error, w, v;
+	
+	if( sum <= PR_SUM_MIN )
+	{
+		pid_reset( &pid );
+		return;
+	}
+	
+	// Left brighter is a positive error, and a positive (left) turn.
+	error = ( signed short int )( ( ( ( signed long int ) nL - ( signed long int ) nR ) * 256 ) / ( signed long int ) sum );
+	w = pid_update( &pid, error );
+	
+	if( sum >= PR_SUM_MAX )
+		v = HOME_V_NEAR;
+	else
+		v = HOME_V_FAR - ( signed short int )( ( ( signed long int )( HOME_V_FAR - HOME_V_NEAR ) *
+			( sum - PR_SUM_MIN ) ) / ( PR_SUM_MAX - PR_SUM_MIN ) );
+	
+	pAction->state = LIGHT_FOLLOW;
+	kin_drive( pAction, v, w, PR_FOLLOW_ACCEL );
+	
+	PR_display( L, R );
+} // end light_home()
+
 /*
 //===============================================================================
 //= What:	light_observe()														=
@@ -0,0 +1,193 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	profiler.c														=
+//= Desc:		Loop-rate and per-behavior timing for the arbitration loop.		=
+//= Functions:	profile_loop_start(), profile_mark(), profile_reset(),			=
+//=				profile_report()												=
+//= Other:		Times come from the 10us stopwatch, so any single interval		=
+//=				longer than 655ms wraps.										=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// One set of statistics per section, indexed by PROFILE_SECTION.
+static PROFILE_STATS profile_stats[ PROF_COUNT ];
+
+// Stopwatch reading at the top of the current loop pass and at the
+// last mark within it.
+static SWTIME loop_start_ticks;
+static SWTIME last_mark_ticks;
+
+// FALSE until the first loop pass after a reset or a report, so time
+// spent outside the loop never shows up as a loop cycle.
+static BOOL loop_started = FALSE;
+
+// Printable section names, kept in flash.
+static const char prof_name_loop[]			PROGMEM = "loop";
+static const char prof_name_ir_sense[]		PROGMEM = "IR_sense";
+static const char prof_name_pr_sense[]		PROGMEM = "PR_sense";
+static const char prof_name_range_sense[]	PROGMEM = "range_sense";
+static const char prof_name_odom_sense[]	PROGMEM = "odom_sense";
+static const char prof_name_pano_sense[]	PROGMEM = "pano_sense";
+static const char prof_name_stack_sense[]	PROGMEM = "stack_sense";
+static const char prof_name_explore[]		PROGMEM = "explore";
+static const char prof_name_light_follow[]	PROGMEM = "light_follow";
+static const char prof_name_ir_avoid[]		PROGMEM = "IR_avoid";
+static const char prof_name_search[]		PROGMEM = "light_search";
+static const char prof_name_slowdown[]		PROGMEM = "slowdown";
+static const char prof_name_act[]			PROGMEM = "act";
+static const char prof_name_info_display[]	PROGMEM = "info_display";
+static const char prof_name_lcd[]			PROGMEM = "LCD";
+static const char prof_name_telemetry[]		PROGMEM = "telemetry";
+static const char prof_name_flightrec[]		PROGMEM = "flightrec";
+
+static PGM_P const profile_names[ PROF_COUNT ] PROGMEM = {
+	prof_name_loop,
+	prof_name_ir_sense,
+	prof_name_pr_sense,
+	prof_name_range_sense,
+	prof_name_odom_sense,
+	prof_name_pano_sense,
+	prof_name_stack_sense,
+	prof_name_explore,
+	prof_name_light_follow,
+	prof_name_ir_avoid,
+	prof_name_search,
+	prof_name_slowdown,
+	prof_name_act,
+	prof_name_info_display,
+	prof_name_lcd,
+	prof_name_telemetry,
+	prof_name_flightrec
+};
+
+//===============================================================================
+//= What:	profile_record()													=
+//= Why:	Folds one measured interval into a section's statistics.			=
+//= Desc:	Tracks min/max and a running sum for the mean.  When the count		=
+//=			saturates, sum and count are halved so the mean keeps tracking.		=
+//= Return:	void.																=
+//= Params:	PROFILE_SECTION section (which statistics to update)				=
+//=			SWTIME dt (interval in 10us stopwatch ticks)						=
+//= Notes:	none.																=
+//===============================================================================
+static void profile_record( PROFILE_SECTION section, SWTIME dt )
+{
+	PROFILE_STATS *pStats = &profile_stats[ section ];
+
+	if( ( pStats->count == 0 ) || ( dt < pStats->min ) )
+		pStats->min = dt;
+	if( dt > pStats->max )
+		pStats->max = dt;
+
+	if( pStats->count == 0xFFFF )
+	{
+		pStats->sum >>= 1;
+		pStats->count >>= 1;
+	}
+
+	pStats->sum += dt;
+	pStats->count++;
+} // end profile_record()
+
+//===============================================================================
+//= What:	profile_loop_start()												=
+//= Why:	Marks the top of an arbitration loop pass.							=
+//= Desc:	Records the full cycle time since the previous pass (except on		=
+//=			the first pass) and restarts the per-section mark.					=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Use the PROFILE_LOOP_START() macro so it compiles out.				=
+//===============================================================================
+void profile_loop_start( void )
+{
+	SWTIME now = STOPWATCH_get_ticks();
+
+	// Unsigned subtraction handles stopwatch wraparound.
+	if( loop_started == TRUE )
+		profile_record( PROF_LOOP, ( SWTIME )( now - loop_start_ticks ) );
+
+	loop_start_ticks = now;
+	last_mark_ticks = now;
+	loop_started = TRUE;
+} // end profile_loop_start()
+
+//===============================================================================
+//= What:	profile_mark()														=
+//= Why:	Charges the time since the last mark to 'section'.					=
+//= Return:	void.																=
+//= Params:	PROFILE_SECTION section (the call that just finished)				=
+//= Notes:	Use the PROFILE_MARK() macro so it compiles out.					=
+//===============================================================================
+void profile_mark( PROFILE_SECTION section )
+{
+	SWTIME now = STOPWATCH_get_ticks();
+
+	profile_record( section, ( SWTIME )( now - last_mark_ticks ) );
+	last_mark_ticks = now;
+} // end profile_mark()
+
+//===============================================================================
+//= What:	profile_reset()														=
+//= Why:	Clears all statistics.												=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+void profile_reset( void )
+{
+	unsigned char i;
+
+	for( i = 0; i < PROF_COUNT; i++ )
+	{
+		profile_stats[ i ].min = 0;
+		profile_stats[ i ].max = 0;
+		profile_stats[ i ].sum = 0;
+		profile_stats[ i ].count = 0;
+	}
+
+	loop_started = FALSE;
+} // end profile_reset()
+
+//===============================================================================
+//= What:	profile_report()													=
+//= Why:	Prints the statistics table over UART0.								=
+//= Desc:	One line per section: sample count, then min/max/mean in us.		=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Blocks on the UART, so the next loop pass is not recorded.			=
+//===============================================================================
+void profile_report( void )
+{
+	unsigned char i;
+	char text[ FMT_LINE_SIZE ];
+	FMT_BUF line;
+
+	fmt_uart_P( PSTR( "\r\nsection            n   min_us   max_us  mean_us\r\n" ) );
+
+	for( i = 0; i < PROF_COUNT; i++ )
+	{
+		PROFILE_STATS *pStats = &profile_stats[ i ];
+		unsigned long int mean = pStats->count ? ( pStats->sum / pStats->count ) : 0;
+
+		fmt_open( &line, text, sizeof( text ) );
+		fmt_str_P( &line, ( PGM_P ) pgm_read_word( &profile_names[ i ] ), 13 );
+		fmt_uint( &line, pStats->count, 7, ' ' );
+		fmt_uint( &line, pStats->min * 10UL, 9, ' ' );
+		fmt_uint( &line, pStats->max * 10UL, 9, ' ' );
+		fmt_uint( &line, mean * 10UL, 9, ' ' );
+		fmt_str_P( &line, PSTR( "\r\n" ), 0 );
+		fmt_uart( &line );
+	}
+
+	loop_started = FALSE;
+} // end profile_report()
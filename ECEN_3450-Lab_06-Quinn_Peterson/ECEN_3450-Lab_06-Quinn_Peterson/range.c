@@ -0,0 +1,212 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	range.c															=
+//= Desc:		Non-blocking ultrasonic ranging.  The sense task sends a ping	=
+//=				and returns; a pin-change ISR time stamps both edges of the		=
+//=				echo with the stopwatch, and the next sense pass turns the		=
+//=				pulse width into a median-filtered range in cm.					=
+//= Functions:	range_open(), range_sense(), range_slowdown()					=
+//= Other:		The sensor (PING-style, one signal line) is on RANGE_BIT of		=
+//=				port A, the pin USONIC_ping() uses.  Do not call USONIC_ping()	=
+//=				as well.  With no sensor attached the range just reads			=
+//=				RANGE_MAX_CM; nothing waits on an echo.							=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Where the measurement in flight is.  The sense task moves it out of
+// RANGE_IDLE/RANGE_DONE; the ISR moves it along the echo.
+static volatile RANGE_STATE range_state = RANGE_IDLE;
+
+// Stopwatch time of the echo's rising edge, and the finished pulse width
+// (10us ticks, valid in RANGE_DONE).
+static volatile SWTIME range_rise = 0;
+static volatile SWTIME range_width = 0;
+
+// The last three readings (cm) for the median filter, and the next slot.
+static unsigned short int range_history[ 3 ];
+static unsigned char range_next = 0;
+
+//===============================================================================
+//= What:	range_echo_isr()													=
+//= Why:	Pin change on the sensor line: time stamps the echo pulse.			=
+//= Desc:	Rising edge while waiting starts the pulse; the falling edge		=
+//=			after it ends the measurement and masks the pin again.				=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Attached to ISR_PCINT0_VECT.										=
+//===============================================================================
+static CBOT_ISR( range_echo_isr )
+{
+	SWTIME now = STOPWATCH_get_ticks();
+
+	if( RANGE_PIN & _BV( RANGE_BIT ) )
+	{
+		if( range_state == RANGE_WAIT_ECHO )
+		{
+			range_rise = now;
+			range_state = RANGE_ECHO;
+		}
+	}
+	else if( range_state == RANGE_ECHO )
+	{
+		range_width = now - range_rise;
+		range_state = RANGE_DONE;
+		RANGE_PCMSK &= ~_BV( RANGE_PCINT );
+	}
+} // end range_echo_isr()
+
+//===============================================================================
+//= What:	range_trigger()														=
+//= Why:	Sends one ping and arms the echo ISR.								=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Blocks only for the RANGE_TRIGGER_US trigger pulse.					=
+//===============================================================================
+static void range_trigger( void )
+{
+	// Keep our own trigger pulse from reaching the ISR.
+	RANGE_PCMSK &= ~_BV( RANGE_PCINT );
+
+	RANGE_DDR |= _BV( RANGE_BIT );
+	RANGE_PORT |= _BV( RANGE_BIT );
+	DELAY_us( RANGE_TRIGGER_US );
+	RANGE_PORT &= ~_BV( RANGE_BIT );
+	RANGE_DDR &= ~_BV( RANGE_BIT );
+
+	range_state = RANGE_WAIT_ECHO;
+	PCIFR = _BV( PCIF0 );
+	RANGE_PCMSK |= _BV( RANGE_PCINT );
+} // end range_trigger()
+
+//===============================================================================
+//= What:	range_median()														=
+//= Return:	unsigned short int (median of the last three readings, in cm).		=
+//= Params:	void.																=
+//===============================================================================
+static unsigned short int range_median( void )
+{
+	unsigned short int a = range_history[ 0 ];
+	unsigned short int b = range_history[ 1 ];
+	unsigned short int c = range_history[ 2 ];
+
+	if( a > b )
+	{
+		unsigned short int t = a;
+		a = b;
+		b = t;
+	}
+
+	// Now a <= b: the median is b unless c is below it.
+	if( c < b )
+		b = ( c > a ) ? c : a;
+
+	return b;
+} // end range_median()
+
+//===============================================================================
+//= What:	range_open()														=
+//= Why:	Sets the sensor line up as an input and attaches the echo ISR.		=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	The stopwatch must already be open and running (see					=
+//=			open_modules()).  The first ping goes out on the first				=
+//=			range_sense().														=
+//===============================================================================
+void range_open( void )
+{
+	unsigned char i;
+
+	for( i = 0; i < 3; i++ )
+		range_history[ i ] = RANGE_MAX_CM;
+	range_next = 0;
+	range_state = RANGE_IDLE;
+
+	// Line low and released; keep its digital input buffer on.
+	RANGE_PORT &= ~_BV( RANGE_BIT );
+	RANGE_DDR &= ~_BV( RANGE_BIT );
+	DIDR0 &= ~_BV( RANGE_BIT );
+
+	ISR_open();
+	ISR_attach( ISR_PCINT0_VECT, range_echo_isr );
+	PCICR |= _BV( PCIE0 );
+} // end range_open()
+
+//===============================================================================
+//= What:	range_sense()														=
+//= Why:	Sense task for the ultrasonic range.								=
+//= Desc:	Collects the ping sent on the previous call (no echo in time		=
+//=			counts as RANGE_MAX_CM), publishes the median of the last three		=
+//=			readings to SENSOR_DATA, and sends the next ping.  The arbiter		=
+//=			calls it every RANGE_SENSE_MS.										=
+//= Return:	BOOL (TRUE if the published range changed).							=
+//= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	RANGE_SENSE_MS must cover the longest echo (about 19ms).			=
+//===============================================================================
+BOOL range_sense( volatile SENSOR_DATA *pSensors )
+{
+	RANGE_STATE state = range_state;
+	unsigned short int cm = RANGE_MAX_CM;
+	BOOL changed;
+
+	if( state != RANGE_IDLE )
+	{
+		if( state == RANGE_DONE )
+			cm = RANGE_TICKS_TO_CM( range_width );
+
+		range_history[ range_next ] = ( cm < RANGE_MAX_CM ) ? cm : RANGE_MAX_CM;
+		if( ++range_next == 3 )
+			range_next = 0;
+	}
+
+	cm = range_median();
+	changed = ( cm != pSensors->range_cm ) ? TRUE : FALSE;
+	pSensors->range_cm = cm;
+
+	range_trigger();
+
+	return changed;
+} // end range_sense()
+
+//===============================================================================
+//= What:	range_slowdown()													=
+//= Why:	Slows the winning behavior down as an obstacle gets closer, so		=
+//=			CEENBoT arrives at the IR trip distance at a crawl.					=
+//= Desc:	Beyond calib.range_slow_cm the action is left alone.  From there	=
+//=			down to calib.range_stop_cm both speeds are scaled linearly, in		=
+//=			eighths, to RANGE_SCALE_MIN eighths, and held there closer in		=
+//=			(the IRs take over from there).  An AVOIDING maneuver is never		=
+//=			scaled.																=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (the arbiter's winning action)		=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	Scales *pAction in place, so pass it a copy of the winner			=
+//=			(drive_task() does): scaling the arbiter's own action would			=
+//=			compound on every pass that no behavior rewrites it.				=
+//===============================================================================
+void range_slowdown( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	unsigned short int cm = pSensors->range_cm;
+	signed short int scale;
+
+	if( ( pAction->state == AVOIDING ) || ( cm >= calib.range_slow_cm ) )
+		return;
+
+	if( cm <= calib.range_stop_cm )
+		scale = RANGE_SCALE_MIN;
+	else
+		scale = RANGE_SCALE_MIN + ( signed short int )
+			( ( ( cm - calib.range_stop_cm ) * ( 8 - RANGE_SCALE_MIN ) ) / ( calib.range_slow_cm - calib.range_stop_cm ) );
+
+	pAction->speed_L = ( signed short int )( ( ( signed long int ) pAction->speed_L * scale ) / 8 );
+	pAction->speed_R = ( signed short int )( ( ( signed long int ) pAction->speed_R * scale ) / 8 );
+} // end range_slowdown()
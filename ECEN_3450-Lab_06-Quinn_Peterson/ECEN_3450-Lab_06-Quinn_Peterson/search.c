@@ -0,0 +1,203 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	search.c														=
+//= Desc:		Light search, for when no light is bright enough to home on.	=
+//=				CEENBoT turns once in place recording brightness against the	=
+//=				odometry heading, turns to the brightest bearing, lets			=
+//=				explore() drive that way, then spirals outward until the next	=
+//=				scan.															=
+//= Functions:	light_search()													=
+//= Other:		Everything runs in free-running mode through kin_drive(), so	=
+//=				the light behaviors and IR_avoid() take over at any point.		=
+//=				Headings are the pose's (65536 = one turn).						=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Where the search is, and when (arbiter ms) it entered that phase and was
+// last run.
+static SEARCH_PHASE search_phase = SEARCH_IDLE;
+static unsigned short int search_since = 0;
+static unsigned short int search_last = 0;
+
+// Scan bookkeeping: heading at the previous call, how far the scan has
+// turned, and the brightest reading and its heading.
+static unsigned short int search_heading = 0;
+static unsigned long int search_turned = 0;
+static unsigned int search_best = 0;
+static unsigned short int search_best_heading = 0;
+
+#if PANO_ENABLED
+// Panorama sweeps already looked at.
+static unsigned char search_pano_sweeps = 0;
+#endif
+
+//===============================================================================
+//= What:	search_brightness()													=
+//= Why:	Current light level for the scan.									=
+//= Return:	unsigned int (nL + nR, normalized counts).							=
+//= Params:	void.																=
+//= Notes:	Reads the latest ADC scan directly: PR_sense() only samples every	=
+//=			PR_SENSE_MS, too coarse for a turning robot.						=
+//===============================================================================
+static unsigned int search_brightness( void )
+{
+	ADC_SNAPSHOT snapshot;
+
+	adc_scan_snapshot( &snapshot );
+
+	return PR_normalize( snapshot.sample[ left_pr_channel ], calib.PR_offset_L, calib.PR_gain_L ) +
+		   PR_normalize( snapshot.sample[ right_pr_channel ], calib.PR_offset_R, calib.PR_gain_R );
+} // end search_brightness()
+
+//===============================================================================
+//= What:	search_enter()														=
+//= Why:	Moves to a new phase.												=
+//= Return:	void.																=
+//= Params:	SEARCH_PHASE phase (phase to enter)									=
+//=			unsigned short int now (arbiter ms)									=
+//=			unsigned short int heading (pose heading now)						=
+//===============================================================================
+static void search_enter( SEARCH_PHASE phase, unsigned short int now, unsigned short int heading )
+{
+	search_phase = phase;
+	search_since = now;
+
+	if( phase == SEARCH_SCAN )
+	{
+		search_heading = heading;
+		search_turned = 0;
+		search_best = 0;
+		search_best_heading = heading;
+	}
+} // end search_enter()
+
+//===============================================================================
+//= What:	light_search()														=
+//= Why:	Behavior to find the light when light_home() has nothing to go on.	=
+//= Desc:	SEARCH_SCAN: turn left in place one full turn, keeping the			=
+//=			heading where nL + nR was highest.  SEARCH_HEAD: turn to that		=
+//=			heading.  SEARCH_GO: propose nothing for SEARCH_GO_MS, so			=
+//=			explore() drives straight along the bearing.						=
+//=			SEARCH_SPIRAL: drive on a left turn that opens out over time		=
+//=			(turn rate SEARCH_SPIRAL_W0 * T / ( T + t )) for					=
+//=			SEARCH_SPIRAL_MS; then scan again.									=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	Needs ARB_RUN_WHILE_ACTIVE and SENSE_POSE (the pose changing		=
+//=			as explore() drives re-runs it during SEARCH_GO), and explore()		=
+//=			below it in the table.  If a higher behavior held the robot for		=
+//=			over SEARCH_RESUME_MS, an interrupted scan starts over; the other	=
+//=			phases carry on.  With PANO_ENABLED, any							=
+//=			panorama sweep with PANO_CONTRAST_MIN between its brightest and		=
+//=			dimmest reading sends the search straight to SEARCH_HEAD on the		=
+//=			sweep's bearing; the chassis scan only runs while the light is		=
+//=			outside the panorama's arc.											=
+//===============================================================================
+void light_search( volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	unsigned short int now = arbiter_now();
+	unsigned short int heading = pSensors->pose.heading;
+	unsigned short int gap = now - search_last;
+	unsigned int bright;
+	signed short int err, w = 0, v = 0;
+
+	search_last = now;
+
+	if( ( search_phase == SEARCH_IDLE ) ||
+		( ( search_phase == SEARCH_SCAN ) && ( gap > SEARCH_RESUME_MS ) ) )
+		search_enter( SEARCH_SCAN, now, heading );
+
+#if PANO_ENABLED
+	// A sweep that saw a light gives its bearing without turning the body:
+	// head straight for it from whatever leg the search is on.
+	if( pSensors->pano_sweeps != search_pano_sweeps )
+	{
+		search_pano_sweeps = pSensors->pano_sweeps;
+		if( pSensors->pano_peak - pSensors->pano_floor >= PANO_CONTRAST_MIN )
+		{
+			search_best_heading = pSensors->pano_bearing;
+			if( search_phase != SEARCH_HEAD )
+				search_enter( SEARCH_HEAD, now, heading );
+		}
+	}
+#endif
+
+	switch( search_phase )
+	{
+		case SEARCH_SCAN:
+			// Only turning left counts (the wheels may still be settling
+			// out of whatever ran before).
+			err = ( signed short int )( heading - search_heading );
+			if( err > 0 )
+				search_turned += err;
+			search_heading = heading;
+
+			bright = search_brightness();
+			if( bright > search_best )
+			{
+				search_best = bright;
+				search_best_heading = heading;
+			}
+
+			if( search_turned >= 0x10000UL )
+				search_enter( SEARCH_HEAD, now, heading );
+			else
+				w = SEARCH_SCAN_W;
+			break;
+
+		case SEARCH_HEAD:
+			// Proportional turn onto the bearing: 2 deg/sec per degree off.
+			err = ( signed short int )( search_best_heading - heading );
+			if( ( err < SEARCH_HEAD_TOL ) && ( err > -SEARCH_HEAD_TOL ) )
+			{
+				search_enter( SEARCH_GO, now, heading );
+				return;
+			}
+			else
+			{
+				w = ( signed short int )( ( ( signed long int ) err * 720 ) >> 16 );
+				if( w > SEARCH_SCAN_W )
+					w = SEARCH_SCAN_W;
+				else if( w < -SEARCH_SCAN_W )
+					w = -SEARCH_SCAN_W;
+				else if( ( w >= 0 ) && ( w < SEARCH_HEAD_W_MIN ) )
+					w = SEARCH_HEAD_W_MIN;
+				else if( ( w < 0 ) && ( w > -SEARCH_HEAD_W_MIN ) )
+					w = -SEARCH_HEAD_W_MIN;
+			}
+			break;
+
+		case SEARCH_GO:
+			// The straight leg is explore()'s: propose nothing until it
+			// is over, then open the spiral from here.
+			if( ( unsigned short int )( now - search_since ) < SEARCH_GO_MS )
+				return;
+			search_enter( SEARCH_SPIRAL, now, heading );
+			// fall through
+
+		case SEARCH_SPIRAL:
+			v = SEARCH_SPEED;
+			w = ( signed short int )( ( ( unsigned long int ) SEARCH_SPIRAL_W0 * SEARCH_SPIRAL_T_MS ) /
+				( SEARCH_SPIRAL_T_MS + ( unsigned short int )( now - search_since ) ) );
+			if( ( unsigned short int )( now - search_since ) >= SEARCH_SPIRAL_MS )
+				search_enter( SEARCH_SCAN, now, heading );
+			break;
+
+		default:
+			break;
+	} // end switch()
+
+	pAction->state = SEARCHING;
+	kin_drive( pAction, v, w, SEARCH_ACCEL );
+} // end light_search()
@@ -0,0 +1,163 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	stack.c															=
+//= Desc:		Stack high-water mark.  At power-on, before .data and .bss		=
+//=				are set up, every byte of free SRAM is painted with				=
+//=				STACK_CANARY.  The stack grows down into the paint and the		=
+//=				heap (if malloc() is ever used) grows up into it, so the		=
+//=				unbroken run of paint left above the heap is the headroom		=
+//=				that has never been used.										=
+//= Functions:	stack_paint(), stack_warn(), stack_sense(), stack_headroom()	=
+//= Other:		The scan looks at STACK_SCAN_BYTES per call, so one full		=
+//=				measurement can take several sense periods; it never costs		=
+//=				the loop more than that.  A stack byte that happens to equal	=
+//=				STACK_CANARY at the deepest point reads as paint, so the mark	=
+//=				can be a byte or two optimistic.								=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+// A macro's value as an assembler operand (stack_paint()).
+#define STACK_ASM_STR( x )	STACK_ASM_STR2( x )
+#define STACK_ASM_STR2( x )	#x
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Next byte the scan looks at (NULL: start over from the heap top).
+static unsigned char *stack_scan = NULL;
+
+// Headroom found by the last finished scan, and whether the low-headroom
+// warning has gone out.
+static unsigned short int stack_mark = 0;
+static BOOL stack_warned = FALSE;
+
+//===============================================================================
+//= What:	stack_paint()														=
+//= Why:	Paints free SRAM so stack_sense() can see how deep the stack got.	=
+//= Desc:	Fills STACK_SRAM_FREE through STACK_SRAM_END with STACK_CANARY.		=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Runs from .init3 (STACK_PAINT_ATTR), never called: the C runtime	=
+//=			has set SP and cleared r1, and nothing is on the stack yet.			=
+//=			Must not call anything or keep locals on the stack, so on the		=
+//=			AVR the loop is assembly in fixed registers (X walks, Z holds		=
+//=			the end, r24 the paint) whatever the optimizer does; a naked		=
+//=			function has no prologue to save them, and nothing needs them.		=
+//===============================================================================
+void stack_paint( void )
+{
+#ifdef __AVR__
+	__asm__ __volatile__(
+		"	ldi r24, " STACK_ASM_STR( STACK_CANARY ) "\n"
+		"	ldi r26, lo8(__heap_start)\n"
+		"	ldi r27, hi8(__heap_start)\n"
+		"	ldi r30, lo8(" STACK_ASM_STR( RAMEND ) ")\n"
+		"	ldi r31, hi8(" STACK_ASM_STR( RAMEND ) ")\n"
+		"1:	st X+, r24\n"
+		"	cp r30, r26\n"
+		"	cpc r31, r27\n"
+		"	brsh 1b\n" );
+#else
+	// The simulator's stand-in block (see its capi324v221.h).
+	unsigned char *p;
+
+	for( p = STACK_SRAM_FREE; p <= STACK_SRAM_END; p++ )
+		*p = STACK_CANARY;
+#endif
+} // end stack_paint()
+
+//===============================================================================
+//= What:	stack_warn()														=
+//= Why:	The low-headroom warning on UART0.									=
+//= Return:	void.																=
+//= Params:	unsigned short int headroom (bytes never used)						=
+//= Notes:	Its own function so the line buffer is only on the stack while		=
+//=			the warning goes out, not on every stack_sense() call (hence		=
+//=			noinline: -O1 inlines functions called once).						=
+//===============================================================================
+static __attribute__( ( noinline ) ) void stack_warn( unsigned short int headroom )
+{
+	char text[ FMT_LINE_SIZE ];
+	FMT_BUF line;
+
+	fmt_open( &line, text, sizeof( text ) );
+	fmt_str_P( &line, PSTR( "\r\nstack: low, " ), 0 );
+	fmt_uint( &line, headroom, 0, ' ' );
+	fmt_str_P( &line, PSTR( " bytes never used\r\n" ), 0 );
+	fmt_uart( &line );
+} // end stack_warn()
+
+//===============================================================================
+//= What:	stack_sense()														=
+//= Why:	Sense task for the stack high-water mark.							=
+//= Desc:	Carries the scan up from the heap top by at most STACK_SCAN_BYTES.	=
+//=			The first byte that is not paint ends it: the paint below it is		=
+//=			the headroom, published as pSensors->stack_free.  The first time	=
+//=			that drops under STACK_LOW_BYTES, says so once on UART0.  Until		=
+//=			then pSensors->stack_free holds the last mark (0 before the first).	=
+//= Return:	BOOL (TRUE when a finished scan found a new headroom).				=
+//= Params:	volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	The arbiter calls it every STACK_CHECK_MS.							=
+//===============================================================================
+BOOL stack_sense( volatile SENSOR_DATA *pSensors )
+{
+	unsigned char *bottom = ( STACK_HEAP_END != NULL ) ? STACK_HEAP_END : STACK_SRAM_FREE;
+	unsigned short int headroom;
+	unsigned char n;
+
+	// Until the scan finishes, report the last mark (0 before the first).
+	pSensors->stack_free = stack_mark;
+
+	// A new scan, or the heap grew past where this one had got to.
+	if( ( stack_scan == NULL ) || ( stack_scan < bottom ) )
+		stack_scan = bottom;
+
+	for( n = 0; n < STACK_SCAN_BYTES; n++ )
+	{
+		if( ( stack_scan > STACK_SRAM_END ) || ( *stack_scan != STACK_CANARY ) )
+			break;
+		stack_scan++;
+	}
+	if( n == STACK_SCAN_BYTES )
+		return FALSE;
+
+	// Scan finished: everything from 'bottom' up to here is untouched.
+	headroom = ( unsigned short int )( stack_scan - bottom );
+	stack_scan = NULL;
+	pSensors->stack_free = headroom;
+
+	if( ( headroom < STACK_LOW_BYTES ) && ( stack_warned == FALSE ) )
+	{
+		stack_warned = TRUE;
+		stack_warn( headroom );
+	}
+
+	if( headroom == stack_mark )
+		return FALSE;
+
+	stack_mark = headroom;
+	return TRUE;
+} // end stack_sense()
+
+//===============================================================================
+//= What:	stack_headroom()													=
+//= Why:	High-water-mark query for reports and commands.						=
+//= Return:	unsigned short int (bytes of SRAM never used, as of the last		=
+//=			finished scan; 0 before the first).									=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+unsigned short int stack_headroom( void )
+{
+	return stack_mark;
+} // end stack_headroom()
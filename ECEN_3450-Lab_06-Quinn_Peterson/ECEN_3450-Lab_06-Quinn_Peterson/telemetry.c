@@ -0,0 +1,248 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	telemetry.c														=
+//= Desc:		Binary telemetry over UART0.  Every period the loop packs one	=
+//=				fixed-size frame (see TLM_* in ECEN3450Lab06.h) into a ring		=
+//=				buffer; the USART0 data-register-empty ISR drains it, so the	=
+//=				loop never waits on the UART.									=
+//= Functions:	telemetry_pack(), telemetry_open(), telemetry_task(),			=
+//=				telemetry_flush(), telemetry_dropped()							=
+//= Other:		Decode on the PC with sim/teledecode.  Blocking UART0_printf()	=
+//=				output (e.g. the profiler report) lands between frames; the		=
+//=				decoder skips it by re-synchronizing on the frame header.		=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Transmit ring.  The loop only moves 'head', the ISR only moves 'tail',
+// so neither side needs to mask interrupts.  Empty when head == tail.
+static volatile unsigned char telemetry_ring[ TELEMETRY_RING_SIZE ];
+static volatile unsigned char telemetry_head = 0;
+static volatile unsigned char telemetry_tail = 0;
+
+// Milliseconds since telemetry_open(), advanced once per period, and set
+// each period to ask the loop for a frame.
+static volatile unsigned long int telemetry_ms = 0;
+static volatile BOOL telemetry_due = FALSE;
+static TIMER16 telemetry_period = 0;
+
+// Frame sequence number (gaps show dropped frames) and the drop count.
+static unsigned char telemetry_sequence = 0;
+static unsigned short int telemetry_drops = 0;
+
+// Paces the frames.
+static TIMEROBJ telemetry_timer;
+
+//===============================================================================
+//= What:	telemetry_tick()													=
+//= Why:	Timer notify function: time stamps the period and asks for a frame.	=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Runs in the timer service ISR.										=
+//===============================================================================
+static void telemetry_tick( void )
+{
+	telemetry_ms += telemetry_period;
+	telemetry_due = TRUE;
+} // end telemetry_tick()
+
+//===============================================================================
+//= What:	telemetry_udre_isr()												=
+//= Why:	USART0 data register empty: sends the next queued byte.				=
+//= Desc:	When the ring runs dry the interrupt is switched off; queuing a		=
+//=			frame switches it back on.											=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Attached to ISR_USART0_UDRE_VECT.									=
+//===============================================================================
+static CBOT_ISR( telemetry_udre_isr )
+{
+	unsigned char tail = telemetry_tail;
+
+	if( tail == telemetry_head )
+	{
+		UCSR0B &= ~_BV( UDRIE0 );
+		return;
+	}
+
+	UDR0 = telemetry_ring[ tail ];
+	telemetry_tail = ( tail + 1 ) & ( TELEMETRY_RING_SIZE - 1 );
+} // end telemetry_udre_isr()
+
+//===============================================================================
+//= What:	telemetry_put16()													=
+//= Why:	Stores a 16-bit value little-endian, whatever the host's order.		=
+//= Return:	void.																=
+//= Params:	unsigned char *pDest (first of two bytes)							=
+//=			unsigned short int value (value to store)							=
+//= Notes:	none.																=
+//===============================================================================
+static void telemetry_put16( unsigned char *pDest, unsigned short int value )
+{
+	pDest[ 0 ] = ( unsigned char ) value;
+	pDest[ 1 ] = ( unsigned char )( value >> 8 );
+} // end telemetry_put16()
+
+//===============================================================================
+//= What:	telemetry_pack()													=
+//= Why:	Fills in one frame; shared with the flight recorder, so live and	=
+//=			recorded data decode the same way.									=
+//= Desc:	Packs the time stamp, the latest ADC scan (photoresistors, in		=
+//=			counts), the ultrasonic range (cm), the IR bits, the commanded		=
+//=			state and speeds, the odometry pose, and the stack headroom, then	=
+//=			the checksum.														=
+//= Return:	void.																=
+//= Params:	unsigned char *pFrame (TLM_FRAME_SIZE bytes)						=
+//=			unsigned char sequence (frame sequence number)						=
+//=			unsigned long int t_ms (time stamp)									=
+//=			volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	none.																=
+//===============================================================================
+void telemetry_pack( unsigned char *pFrame, unsigned char sequence, unsigned long int t_ms,
+	volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	ADC_SNAPSHOT snapshot;
+	unsigned char i, check;
+
+	adc_scan_snapshot( &snapshot );
+
+	pFrame[ TLM_OFS_SYNC ] = TLM_SYNC0;
+	pFrame[ TLM_OFS_SYNC + 1 ] = TLM_SYNC1;
+	pFrame[ TLM_OFS_SEQ ] = sequence;
+	pFrame[ TLM_OFS_STATE ] = ( unsigned char ) pAction->state;
+	telemetry_put16( &pFrame[ TLM_OFS_T_MS ], ( unsigned short int ) t_ms );
+	telemetry_put16( &pFrame[ TLM_OFS_T_MS + 2 ], ( unsigned short int )( t_ms >> 16 ) );
+	telemetry_put16( &pFrame[ TLM_OFS_LEFT_PR ], snapshot.sample[ left_pr_channel ] );
+	telemetry_put16( &pFrame[ TLM_OFS_RIGHT_PR ], snapshot.sample[ right_pr_channel ] );
+	telemetry_put16( &pFrame[ TLM_OFS_USONIC ], pSensors->range_cm );
+	pFrame[ TLM_OFS_IR ] = ( pSensors->left_IR == TRUE ? TLM_IR_LEFT : 0 ) |
+						   ( pSensors->right_IR == TRUE ? TLM_IR_RIGHT : 0 );
+	telemetry_put16( &pFrame[ TLM_OFS_SPEED_L ], ( unsigned short int ) pAction->speed_L );
+	telemetry_put16( &pFrame[ TLM_OFS_SPEED_R ], ( unsigned short int ) pAction->speed_R );
+	telemetry_put16( &pFrame[ TLM_OFS_X_CM ], ( unsigned short int ) ODOM_Q8_TO_CM( pSensors->pose.x_q8 ) );
+	telemetry_put16( &pFrame[ TLM_OFS_Y_CM ], ( unsigned short int ) ODOM_Q8_TO_CM( pSensors->pose.y_q8 ) );
+	telemetry_put16( &pFrame[ TLM_OFS_HEADING ], pSensors->pose.heading );
+	telemetry_put16( &pFrame[ TLM_OFS_STACK ], pSensors->stack_free );
+
+	// Everything after the sync bytes, checksum included, sums to zero.
+	check = 0;
+	for( i = TLM_OFS_SEQ; i < TLM_OFS_CHECK; i++ )
+		check += pFrame[ i ];
+	pFrame[ TLM_OFS_CHECK ] = -check;
+} // end telemetry_pack()
+
+//===============================================================================
+//= What:	telemetry_open()													=
+//= Why:	Starts streaming one frame every 'period_ms'.						=
+//= Return:	void.																=
+//= Params:	TIMER16 period_ms (time between frames)								=
+//= Notes:	UART0 must already be open and configured (see open_modules()).		=
+//=			One frame is TLM_FRAME_SIZE bytes, so at UART0_BAUD the period		=
+//=			must be longer than TLM_FRAME_SIZE * 10 bits / UART0_BAUD or		=
+//=			frames are dropped.  Call again to change the rate.					=
+//===============================================================================
+void telemetry_open( TIMER16 period_ms )
+{
+	if( period_ms == 0 )
+		return;
+
+	telemetry_period = period_ms;
+
+	ISR_open();
+	ISR_attach( ISR_USART0_UDRE_VECT, telemetry_udre_isr );
+
+	TMRSRVC_REGISTER_EVENT( telemetry_timer, telemetry_tick );
+	TMRSRVC_new( &telemetry_timer, TMRFLG_NOTIFY_FUNC, TMRTCM_RESTART, period_ms );
+} // end telemetry_open()
+
+//===============================================================================
+//= What:	telemetry_task()													=
+//= Why:	Arbiter task: queues a frame each time one is due.					=
+//= Desc:	See telemetry_pack() for the contents.  If the ring has no room		=
+//=			for the whole frame it is dropped (and counted) rather than			=
+//=			waited for.															=
+//= Return:	char (PT_WAITING: it never ends).									=
+//= Params:	PT *pt (the task's protothread)										=
+//=			volatile MOTOR_ACTION *pAction (the pointer for all motor actions)	=
+//=			volatile SENSOR_DATA *pSensors (the pointer for all sensor data)	=
+//= Notes:	List it with ARB_TASK() only when TELEMETRY_ENABLED.  Costs one		=
+//=			flag check when no frame is due.									=
+//===============================================================================
+char telemetry_task( PT *pt, volatile MOTOR_ACTION *pAction, volatile SENSOR_DATA *pSensors )
+{
+	unsigned char frame[ TLM_FRAME_SIZE ];
+	unsigned char head, i;
+	unsigned long int t_ms;
+
+	PT_BEGIN( pt );
+
+	for( ;; )
+	{
+		PT_WAIT_UNTIL( pt, telemetry_due == TRUE );
+
+		// Take the stamp with the ISR out of the way so all four bytes match.
+		do {
+			telemetry_due = FALSE;
+			t_ms = telemetry_ms;
+		} while( telemetry_due == TRUE );
+
+		telemetry_pack( frame, telemetry_sequence++, t_ms, pAction, pSensors );
+
+		// All of it or none of it: a partial frame would only cost a resync.
+		head = telemetry_head;
+		if( ( ( telemetry_tail - head - 1 ) & ( TELEMETRY_RING_SIZE - 1 ) ) < TLM_FRAME_SIZE )
+		{
+			telemetry_drops++;
+			continue;
+		}
+
+		for( i = 0; i < TLM_FRAME_SIZE; i++ )
+		{
+			telemetry_ring[ head ] = frame[ i ];
+			head = ( head + 1 ) & ( TELEMETRY_RING_SIZE - 1 );
+		}
+		telemetry_head = head;
+
+		// Wake the transmitter (the ISR turns itself off when it runs dry).
+		UCSR0B |= _BV( UDRIE0 );
+	}
+
+	PT_END( pt );
+} // end telemetry_task()
+
+//===============================================================================
+//= What:	telemetry_flush()													=
+//= Why:	Waits until every queued byte has gone out, so blocking UART0		=
+//=			output that follows cannot land in the middle of a frame.			=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Blocks for at most one ring's worth of line time (~17ms).			=
+//===============================================================================
+void telemetry_flush( void )
+{
+	while( UCSR0B & _BV( UDRIE0 ) )
+		DELAY_us( 100 );
+} // end telemetry_flush()
+
+//===============================================================================
+//= What:	telemetry_dropped()													=
+//= Why:	Frames dropped because the ring was full (UART too slow for the		=
+//=			chosen period).														=
+//= Return:	unsigned short int (frames dropped since power-on).					=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+unsigned short int telemetry_dropped( void )
+{
+	return telemetry_drops;
+} // end telemetry_dropped()
@@ -0,0 +1,106 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= Due Date:	03/16/18														=
+//= File Name:	tiny_sense.c													=
+//= Desc:		Cached snapshot of the ATtiny sensor byte.  One					=
+//=				ATTINY_get_sensors() transaction fetches both IR sensors and	=
+//=				all three switches; everyone else decodes the cached copy.		=
+//= Functions:	tiny_sense_update(), tiny_sense_IR(), tiny_sense_SW(),			=
+//=				tiny_sense_SW_pressed()											=
+//= Other:		Both IR bits come from the same transaction, so left and right	=
+//=				are always from the same instant.  Nothing else should call		=
+//=				the ATTINY_get_*() functions: the switch press bits are			=
+//=				cleared by whichever read sees them first.						=
+//===============================================================================
+
+//===============================================================================
+//= What:	Include file "ECEN3450Lab06.h" which has prototypes and includes.	=
+//===============================================================================
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// SNSR_* bits from the last transaction (the press bits are not kept here).
+static unsigned char tiny_sense_bits = 0;
+
+// SNSR_SWx_EDGE bits seen but not yet consumed by tiny_sense_SW_pressed().
+// The ATtiny reports a press only once, so it is held here until asked for.
+static unsigned char tiny_sense_presses = 0;
+
+//===============================================================================
+//= What:	tiny_sense_update()													=
+//= Why:	Refreshes the snapshot with one SPI transaction to the ATtiny.		=
+//= Return:	BOOL (TRUE if an IR or switch state changed, or a press arrived).	=
+//= Params:	void.																=
+//= Notes:	IR_sense() calls it every IR_SENSE_MS inside the loop.  Before		=
+//=			the loop, callers poll it themselves (see calibrate_pr()).			=
+//===============================================================================
+BOOL tiny_sense_update( void )
+{
+	unsigned char bits = ATTINY_get_sensors();
+	unsigned char edges = bits & TINY_SW_EDGE_MASK;
+	BOOL changed;
+
+	bits &= TINY_STATE_MASK;
+	changed = ( bits != tiny_sense_bits ) || ( edges != 0 );
+
+	tiny_sense_bits = bits;
+	tiny_sense_presses |= edges;
+
+	return changed;
+} // end tiny_sense_update()
+
+//===============================================================================
+//= What:	tiny_sense_IR()														=
+//= Why:	Decodes the IR bits of the snapshot, as ATTINY_get_IR_state().		=
+//= Return:	BOOL (TRUE if the requested IR is tripped).							=
+//= Params:	ATTINY_IR which (ATTINY_IR_LEFT, _RIGHT, _EITHER or _BOTH)			=
+//= Notes:	No SPI traffic.														=
+//===============================================================================
+BOOL tiny_sense_IR( ATTINY_IR which )
+{
+	unsigned char ir = tiny_sense_bits & ( SNSR_IR_LEFT | SNSR_IR_RIGHT );
+
+	switch( which )
+	{
+		case ATTINY_IR_LEFT:	return ( ir & SNSR_IR_LEFT ) ? TRUE : FALSE;
+		case ATTINY_IR_RIGHT:	return ( ir & SNSR_IR_RIGHT ) ? TRUE : FALSE;
+		case ATTINY_IR_EITHER:	return ( ir != 0 ) ? TRUE : FALSE;
+		case ATTINY_IR_BOTH:	return ( ir == ( SNSR_IR_LEFT | SNSR_IR_RIGHT ) ) ? TRUE : FALSE;
+	}
+
+	return FALSE;
+} // end tiny_sense_IR()
+
+//===============================================================================
+//= What:	tiny_sense_SW()														=
+//= Why:	Whether a switch is held down in the snapshot.						=
+//= Return:	BOOL (TRUE while the switch is pressed).							=
+//= Params:	ATTINY_SW which (ATTINY_SW3, _SW4 or _SW5)							=
+//= Notes:	No SPI traffic.  For "pressed once" use tiny_sense_SW_pressed().	=
+//===============================================================================
+BOOL tiny_sense_SW( ATTINY_SW which )
+{
+	return ( tiny_sense_bits & TINY_SW_STATE( which ) ) ? TRUE : FALSE;
+} // end tiny_sense_SW()
+
+//===============================================================================
+//= What:	tiny_sense_SW_pressed()												=
+//= Why:	Reports each press of a switch once, as ATTINY_get_SW_state().		=
+//= Return:	BOOL (TRUE if the switch was pressed since the last call).			=
+//= Params:	ATTINY_SW which (ATTINY_SW3, _SW4 or _SW5)							=
+//= Notes:	No SPI traffic.  Consumes the press.								=
+//===============================================================================
+BOOL tiny_sense_SW_pressed( ATTINY_SW which )
+{
+	unsigned char edge = TINY_SW_EDGE( which );
+
+	if( ( tiny_sense_presses & edge ) == 0 )
+		return FALSE;
+
+	tiny_sense_presses &= ~edge;
+	return TRUE;
+} // end tiny_sense_SW_pressed()
@@ -0,0 +1,375 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	adcbench.c														=
+//= Desc:		Filter test bench.  Replays a recorded ADC trace through the	=
+//=				firmware's adc_filter.c in several configurations and reports	=
+//=				noise reduction, step latency, and how often light_follow's		=
+//=				PR_DIFF_MIN decision flips.										=
+//= Functions:	main()															=
+//= Other:		Trace format is the one 'cbotsim -a' writes:					=
+//=				t_us,channel,raw[,clean].  Without a clean column, a centered	=
+//=				moving average of the raw samples stands in for the truth.		=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+//===============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+#define MAX_SPECS		32
+#define WARMUP			64		// Samples skipped before statistics start.
+#define REF_HALF		16		// Half-width of the stand-in truth average.
+#define STEP_LO			100		// Synthetic step for the latency test.
+#define STEP_HI			900
+
+//===============================================================================
+//= What:	Type Declarations.													=
+//===============================================================================
+
+// Desc: One channel's samples, in trace order.
+typedef struct BENCH_CHANNEL_TYPE {
+	unsigned long *t_us;
+	ADC_SAMPLE *raw;
+	double *clean;
+	size_t n, cap;
+} BENCH_CHANNEL;
+
+// Desc: One filter configuration under test.
+typedef struct BENCH_SPEC_TYPE {
+	ADC_FILTER_MODE mode;
+	unsigned char shift;
+	char name[ 16 ];
+} BENCH_SPEC;
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+static BENCH_CHANNEL channels[ ADC_SCAN_NCHANS ];
+static int have_clean = 1;
+
+//===============================================================================
+//= What:	usage()																=
+//===============================================================================
+static void usage( const char *argv0 )
+{
+	fprintf( stderr,
+		"usage: %s [options] TRACE.csv\n"
+		"  -f SPEC   filter to test: none, os:K, ma:K or iir:K (N = 2^K);\n"
+		"            repeat for several (default: a sweep of all three)\n"
+		"  -i MS     light_follow decision interval (default 125)\n", argv0 );
+	exit( 1 );
+}
+
+//===============================================================================
+//= What:	parse_spec()														=
+//= Why:	Turns "ma:4" into a filter configuration.							=
+//= Return:	int (0 on success).													=
+//===============================================================================
+static int parse_spec( const char *text, BENCH_SPEC *pSpec )
+{
+	char mode[ 8 ];
+	unsigned int shift = 0;
+
+	if( strcmp( text, "none" ) == 0 )
+	{
+		pSpec->mode = ADC_FILTER_NONE;
+		pSpec->shift = 0;
+	}
+	else if( sscanf( text, "%7[a-z]:%u", mode, &shift ) == 2 )
+	{
+		if( strcmp( mode, "os" ) == 0 )
+			pSpec->mode = ADC_FILTER_OVERSAMPLE;
+		else if( strcmp( mode, "ma" ) == 0 )
+			pSpec->mode = ADC_FILTER_MOVING_AVG;
+		else if( strcmp( mode, "iir" ) == 0 )
+			pSpec->mode = ADC_FILTER_IIR;
+		else
+			return -1;
+		pSpec->shift = shift;
+	}
+	else
+		return -1;
+
+	snprintf( pSpec->name, sizeof( pSpec->name ), "%s", text );
+	return 0;
+}
+
+//===============================================================================
+//= What:	load_trace()														=
+//= Why:	Reads a trace into per-channel arrays.								=
+//===============================================================================
+static void load_trace( const char *path )
+{
+	FILE *f = fopen( path, "r" );
+	char line[ 128 ];
+
+	if( !f )
+	{
+		perror( path );
+		exit( 1 );
+	}
+
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		unsigned long t;
+		unsigned int ch, raw;
+		double clean;
+		int fields = sscanf( line, "%lu,%u,%u,%lf", &t, &ch, &raw, &clean );
+		BENCH_CHANNEL *c;
+
+		if( fields < 3 || ch >= ADC_SCAN_NCHANS )
+			continue;
+		if( fields < 4 )
+			have_clean = 0;
+
+		c = &channels[ ch ];
+		if( c->n == c->cap )
+		{
+			c->cap = c->cap ? 2 * c->cap : 4096;
+			c->t_us = realloc( c->t_us, c->cap * sizeof( *c->t_us ) );
+			c->raw = realloc( c->raw, c->cap * sizeof( *c->raw ) );
+			c->clean = realloc( c->clean, c->cap * sizeof( *c->clean ) );
+		}
+		c->t_us[ c->n ] = t;
+		c->raw[ c->n ] = raw;
+		c->clean[ c->n ] = clean;
+		c->n++;
+	}
+
+	fclose( f );
+}
+
+//===============================================================================
+//= What:	make_reference()													=
+//= Why:	Truth for traces recorded on the robot: a centered (non-causal)		=
+//=			moving average of the raw samples.									=
+//===============================================================================
+static void make_reference( BENCH_CHANNEL *c )
+{
+	size_t i;
+
+	for( i = 0; i < c->n; i++ )
+	{
+		size_t lo = ( i > REF_HALF ) ? i - REF_HALF : 0;
+		size_t hi = ( i + REF_HALF < c->n ) ? i + REF_HALF : c->n - 1;
+		double sum = 0;
+		size_t j;
+
+		for( j = lo; j <= hi; j++ )
+			sum += c->raw[ j ];
+		c->clean[ i ] = sum / ( hi - lo + 1 );
+	}
+}
+
+//===============================================================================
+//= What:	run_filter()														=
+//= Why:	Filters a whole channel with a fresh filter.						=
+//= Params:	int use_clean (filter the rounded truth instead of the raw data)	=
+//===============================================================================
+static void run_filter( const BENCH_SPEC *pSpec, const BENCH_CHANNEL *c,
+	int use_clean, ADC_SAMPLE *pOut )
+{
+	ADC_FILTER filter;
+	size_t i;
+
+	adc_filter_init( &filter, pSpec->mode, pSpec->shift );
+	for( i = 0; i < c->n; i++ )
+	{
+		ADC_SAMPLE x = use_clean ? ( ADC_SAMPLE )( c->clean[ i ] + 0.5 ) : c->raw[ i ];
+		pOut[ i ] = adc_filter_update( &filter, x );
+	}
+}
+
+//===============================================================================
+//= What:	step_latency()														=
+//= Why:	Samples from a STEP_LO -> STEP_HI step until the output crosses		=
+//=			'fraction' of the way.												=
+//===============================================================================
+static int step_latency( const BENCH_SPEC *pSpec, double fraction )
+{
+	ADC_FILTER filter;
+	double level = STEP_LO + fraction * ( STEP_HI - STEP_LO );
+	int i;
+
+	adc_filter_init( &filter, pSpec->mode, pSpec->shift );
+	for( i = 0; i < 256; i++ )
+		adc_filter_update( &filter, STEP_LO );
+
+	for( i = 1; i < 1024; i++ )
+		if( adc_filter_update( &filter, STEP_HI ) >= level )
+			return i;
+
+	return -1;
+}
+
+//===============================================================================
+//= What:	count_flips()														=
+//= Why:	Counts how often light_follow's |L - R| > PR_DIFF_MIN test changes	=
+//=			answer, sampling L and R every 'interval_us' as PR_sense does.		=
+//===============================================================================
+static unsigned int count_flips( const unsigned long *t_us, const double *L,
+	const double *R, size_t n, unsigned long interval_us )
+{
+	unsigned long next = t_us[ 0 ] + interval_us;
+	unsigned int flips = 0;
+	int last = -1;
+	size_t i;
+
+	for( i = WARMUP; i < n; i++ )
+	{
+		int in_band;
+
+		if( t_us[ i ] < next )
+			continue;
+		next += interval_us;
+
+		in_band = fabs( L[ i ] - R[ i ] ) > PR_DIFF_MIN;
+		if( last >= 0 && in_band != last )
+			flips++;
+		last = in_band;
+	}
+
+	return flips;
+}
+
+//===============================================================================
+//= What:	main()																=
+//===============================================================================
+int main( int argc, char *argv[] )
+{
+	static const char *default_specs[] = {
+		"none", "os:2", "os:3", "os:4", "ma:2", "ma:3", "ma:4",
+		"iir:2", "iir:3", "iir:4"
+	};
+	BENCH_SPEC specs[ MAX_SPECS ];
+	int n_specs = 0, opt, s;
+	unsigned long interval_us = 125000;
+	BENCH_CHANNEL *cL = &channels[ left_pr_channel ];
+	BENCH_CHANNEL *cR = &channels[ right_pr_channel ];
+	double period_ms, noise_none[ 2 ] = { 0, 0 };
+	ADC_SAMPLE *out[ 2 ], *ref[ 2 ];
+	double *fL, *fR;
+	size_t n, i;
+
+	while( ( opt = getopt( argc, argv, "f:i:h" ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 'f':
+				if( n_specs == MAX_SPECS || parse_spec( optarg, &specs[ n_specs ] ) )
+					usage( argv[ 0 ] );
+				n_specs++;
+				break;
+			case 'i': interval_us = strtoul( optarg, NULL, 0 ) * 1000UL; break;
+			default: usage( argv[ 0 ] );
+		}
+	}
+	if( optind != argc - 1 )
+		usage( argv[ 0 ] );
+
+	if( n_specs == 0 )
+		for( s = 0; s < ( int )( sizeof( default_specs ) / sizeof( default_specs[ 0 ] ) ); s++ )
+			parse_spec( default_specs[ s ], &specs[ n_specs++ ] );
+
+	// Noise is measured against 'none', so make sure it is first.
+	if( specs[ 0 ].mode != ADC_FILTER_NONE )
+	{
+		memmove( &specs[ 1 ], &specs[ 0 ], n_specs * sizeof( specs[ 0 ] ) );
+		parse_spec( "none", &specs[ 0 ] );
+		n_specs++;
+	}
+
+	load_trace( argv[ optind ] );
+
+	n = ( cL->n < cR->n ) ? cL->n : cR->n;
+	if( n <= WARMUP + 1 )
+	{
+		fprintf( stderr, "%s: need more than %d samples on channels %d and %d\n",
+			argv[ optind ], WARMUP, left_pr_channel, right_pr_channel );
+		return 1;
+	}
+
+	if( !have_clean )
+	{
+		make_reference( cL );
+		make_reference( cR );
+	}
+
+	period_ms = ( cL->t_us[ n - 1 ] - cL->t_us[ 0 ] ) / 1000.0 / ( n - 1 );
+
+	for( i = 0; i < 2; i++ )
+	{
+		out[ i ] = malloc( n * sizeof( ADC_SAMPLE ) );
+		ref[ i ] = malloc( n * sizeof( ADC_SAMPLE ) );
+	}
+	fL = malloc( n * sizeof( double ) );
+	fR = malloc( n * sizeof( double ) );
+
+	printf( "trace:     %s (%zu scans, %.2f ms apart, truth: %s)\n",
+		argv[ optind ], n, period_ms,
+		have_clean ? "recorded" : "centered average" );
+	printf( "decisions: every %lu ms; noise-free flips: %u\n\n", interval_us / 1000,
+		count_flips( cL->t_us, cL->clean, cR->clean, n, interval_us ) );
+	printf( "%-8s %8s %8s %7s %9s %7s %7s %6s\n", "filter", "noise_L", "noise_R",
+		"reduce", "track_err", "t50_ms", "t90_ms", "flips" );
+
+	for( s = 0; s < n_specs; s++ )
+	{
+		double noise[ 2 ], track = 0;
+		int t50 = step_latency( &specs[ s ], 0.5 );
+		int t90 = step_latency( &specs[ s ], 0.9 );
+
+		for( i = 0; i < 2; i++ )
+		{
+			const BENCH_CHANNEL *c = i ? cR : cL;
+			double sum = 0;
+			size_t k;
+
+			run_filter( &specs[ s ], c, 0, out[ i ] );
+			run_filter( &specs[ s ], c, 1, ref[ i ] );
+
+			// Noise: the filtered raw data against the same filter run
+			// on the truth, so lag does not count as noise.
+			for( k = WARMUP; k < n; k++ )
+			{
+				double e = ( double ) out[ i ][ k ] - ref[ i ][ k ];
+				double t = ( double ) out[ i ][ k ] - c->clean[ k ];
+				sum += e * e;
+				track += t * t;
+			}
+			noise[ i ] = sqrt( sum / ( n - WARMUP ) );
+		}
+		track = sqrt( track / ( 2 * ( n - WARMUP ) ) );
+
+		if( s == 0 )
+		{
+			noise_none[ 0 ] = noise[ 0 ];
+			noise_none[ 1 ] = noise[ 1 ];
+		}
+
+		for( i = 0; i < n; i++ )
+		{
+			fL[ i ] = out[ 0 ][ i ];
+			fR[ i ] = out[ 1 ][ i ];
+		}
+
+		printf( "%-8s %8.2f %8.2f %6.1fx %9.2f %7.1f %7.1f %6u\n", specs[ s ].name,
+			noise[ 0 ], noise[ 1 ],
+			( noise[ 0 ] + noise[ 1 ] > 0 ) ?
+				( noise_none[ 0 ] + noise_none[ 1 ] ) / ( noise[ 0 ] + noise[ 1 ] ) : 0.0,
+			track, t50 * period_ms, t90 * period_ms,
+			count_flips( cL->t_us, fL, fR, n, interval_us ) );
+	}
+
+	return 0;
+}
@@ -0,0 +1,1241 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	capi_host.c														=
+//= Desc:		Host stand-ins for the CAPI calls the lab firmware makes, all	=
+//=				driven by one virtual clock.  Every stand-in charges the time	=
+//=				the real call would take; the 1ms timer service, stepper DDS	=
+//=				and world physics tick from that clock.							=
+//= Functions:	SIM_reset(), SIM_now_us(), SIM_advance_us(), SIM_end_episode(),	=
+//=				SIM_timer_poll(), SIM_delay_us(), and the CAPI stand-ins.		=
+//= Other:		none.															=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+#include <math.h>
+//===============================================================================
+#include <string.h>
+#include <unistd.h>
+#include <avr/eeprom.h>
+#include "capi324v221.h"
+#include "sim.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//= Why:	Virtual cost of the blocking CAPI calls (microseconds).				=
+//===============================================================================
+#define ADC_SAMPLE_US	110		// 13 ADC clocks at 125kHz + call overhead.
+#define ADC_CONV_US		104		// One free conversion: 13 ADC clocks at 125kHz.
+#define UART_BYTE_US	260		// One 8N1 byte at 38400 baud.
+#define UDR0_EMPTY		0x100	// Not a byte: UDR0 has not been written.
+#define SPI_BYTE_US		4		// One SPI byte through the CAPI calls.
+#define FLASH_SIZE		0x80000UL	// 4 Mbit SPI flash.
+#define FLASH_PAGE		256		// Program wraps within a page.
+#define FLASH_SECTOR	4096	// Sector erase size.
+#define FLASH_PROGRAM_US	1500	// Page program (typical).
+#define FLASH_ERASE_US	50000	// 4KB sector erase (typical).
+#define ATTINY_QUERY_US	250		// SPI round trip to the ATtiny.
+#define STEPPER_CMD_US	30		// DDS register update.
+#define STEPPER_MAX_SPEED	300	// The CAPI caps step rates here (step324v221.h).
+#define SERVO_COUNT		5		// ATtiny RC servo outputs.
+#define SERVO_POS_PER_MS	0.57	// Servo slew: 60 degrees in ~0.1s, 255 positions per 180.
+#define MAX_TIMERS		16		// Timer objects the stand-in service tracks.
+#define TRACE_TICKS		10		// Write a trace row every 10ms.
+#define SW3_PRESS_US	500000UL	// Operator 'presses' SW3 half a second in...
+#define SW3_RELEASE_US	700000UL	// ...and lets go 200ms later.
+#define PING_HOLDOFF_US	750		// Ultrasonic: trigger to echo rising edge.
+#define PING_MAX_US		18500	// Ultrasonic: longest echo (nothing in range).
+#define SOUND_CM_PER_US	0.0343	// Speed of sound.
+#define EEPROM_SIZE		( E2END + 1 )	// ATmega324P EEPROM.
+#define EEPROM_WRITE_US	3400	// Erase + write of one EEPROM byte.
+
+//===============================================================================
+//= What:	Type Declarations.													=
+//===============================================================================
+
+// Desc: One simulated stepper.  Speeds are signed steps/sec, 'remaining' is
+//       only used while a STEP-mode move is in progress.
+typedef struct SIM_WHEEL_TYPE {
+	double speed;
+	double target;
+	double accel;
+	double remaining;
+	int step_mode;
+	STEPPER_EVENT_PTR on_done;
+} SIM_WHEEL;
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+SIM_RESULT SIM_result;
+int SIM_result_fd = -1;
+
+// ADC registers, written by the firmware and by adc_tick().
+volatile unsigned char ADMUX;
+volatile unsigned char ADCSRA;
+volatile unsigned short int ADCW;
+
+// USART0 registers, written by the firmware and by uart_tick().
+volatile unsigned char UCSR0B;
+volatile unsigned short int UDR0;
+
+// Port A and pin-change registers, written by the firmware and by
+// ping_tick().
+volatile unsigned char PORTA;
+volatile unsigned char DDRA;
+volatile unsigned char PINA;
+volatile unsigned char DIDR0;
+volatile unsigned char PCICR;
+volatile unsigned char PCIFR;
+volatile unsigned char PCMSK0;
+
+static SIM_CONFIG config;
+static uint64_t now_us;
+static uint64_t next_tick_us;
+static unsigned long ticks;
+static int in_isr;
+static int sw3_reported;
+static uint64_t ping_rise_us, ping_fall_us;
+static double servo_pos[ SERVO_COUNT ];		// Where each servo horn is (0-255).
+static double servo_target[ SERVO_COUNT ];	// Where it was told to go.
+
+static SIM_WHEEL wheel[ 2 ];
+
+static TIMEROBJ *timers[ MAX_TIMERS ];
+static int n_timers;
+static unsigned long timers_fired;
+
+static unsigned long activity;
+static unsigned long last_activity;
+static unsigned long idle_polls;
+static unsigned long polls;
+
+static ADC_CHAN adc_channel;
+
+// Line time owed to the USART0 transmitter, in microseconds.
+static unsigned long uart_credit_us;
+
+// SPI flash model: memory, the selected slave, and the command in progress.
+static unsigned char flash_mem[ FLASH_SIZE ];
+static SPI_SSADDR spi_selected;
+
+// EEPROM contents (erased bytes read 0xFF).
+static unsigned char eeprom_mem[ EEPROM_SIZE ];
+static struct {
+	unsigned long n;				// Bytes clocked since select.
+	unsigned char cmd;				// First byte.
+	unsigned long addr;				// 24-bit address (bytes 2-4).
+	unsigned char data[ FLASH_PAGE ];	// Program data, page-wrapped.
+	unsigned int data_n;			// Program bytes received.
+	int wel;						// Write enable latch.
+	uint64_t busy_until_us;			// End of the program/erase under way.
+} flash;
+
+static CBOT_ISR_FUNC_PTR isr_vtable[ ISR_VECT_COUNT ];
+
+// Stand-in for the SRAM stack_paint() paints (see capi324v221.h).
+unsigned char SIM_sram[ SIM_SRAM_BYTES ];
+
+static char lcd[ LCD_nPAGES ][ LCD_nCOLS + 1 ];
+static unsigned char lcd_row, lcd_col;
+
+//===============================================================================
+//= What:	stepper_tick()														=
+//= Why:	Advances both simulated steppers by one timer tick.					=
+//= Desc:	Ramps each wheel toward its target at its acceleration (0 means		=
+//=			instant), integrates steps, and ends STEP-mode moves.				=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+static void stepper_tick( void )
+{
+	const double dt = SIM_TICK_US / 1e6;
+	double moved[ 2 ];
+	int i;
+
+	for( i = 0; i < 2; i++ )
+	{
+		SIM_WHEEL *w = &wheel[ i ];
+		double dv = w->target - w->speed;
+
+		if( w->accel <= 0 || ( dv < 0 ? -dv : dv ) <= w->accel * dt )
+			w->speed = w->target;
+		else
+			w->speed += ( dv > 0 ? w->accel : -w->accel ) * dt;
+
+		moved[ i ] = w->speed * dt;
+
+		if( w->step_mode )
+		{
+			double mag = moved[ i ] < 0 ? -moved[ i ] : moved[ i ];
+
+			if( mag >= w->remaining )
+			{
+				moved[ i ] = ( moved[ i ] < 0 ) ? -w->remaining : w->remaining;
+				w->remaining = 0;
+				w->speed = w->target = 0;
+				w->step_mode = 0;
+			}
+			else
+				w->remaining -= mag;
+		}
+	}
+
+	WORLD_move( moved[ 0 ], moved[ 1 ] );
+}
+
+//===============================================================================
+//= What:	timer_tick()														=
+//= Why:	The 1ms timer service: counts down every registered TIMEROBJ.		=
+//= Desc:	Sets 'tc' on terminal count, calls the notify function if asked,	=
+//=			and restarts or disables the timer according to its mode.			=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Notify functions run with 'in_isr' set, as they would in the ISR.	=
+//===============================================================================
+static void timer_tick( void )
+{
+	int i;
+
+	for( i = 0; i < n_timers; i++ )
+	{
+		TIMEROBJ *t = timers[ i ];
+
+		if( !( t->flags & TMRFLG_ENABLED ) )
+			continue;
+
+		if( --t->ticks > 0 )
+			continue;
+
+		t->tc = 1;
+		timers_fired++;
+
+		if( ( t->flags & TMRFLG_NOTIFY_FUNC ) && t->pNotifyFunc )
+		{
+			in_isr = 1;
+			t->pNotifyFunc();
+			in_isr = 0;
+	sw3_reported = 0;
+		}
+
+		if( t->flags & TMRFLG_RESTART )
+			t->ticks = t->timeReq;
+		else
+			t->flags &= ~TMRFLG_ENABLED;
+	}
+}
+
+//===============================================================================
+//= What:	adc_tick()															=
+//= Why:	Emulates the ADC hardware for code that drives it by register.		=
+//= Desc:	Completes every conversion started (ADSC set) during this tick,		=
+//=			up to as many as fit in a millisecond.  Each one loads ADCW from	=
+//=			the world and, if ADIE is set, runs the attached ADC ISR, which		=
+//=			may start the next one.												=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	Conversions finish on the tick rather than 104us apart; the ISR		=
+//=			sees the same sequence either way.									=
+//===============================================================================
+static void adc_tick( void )
+{
+	int n;
+
+	for( n = 0; n < 1000 / ADC_CONV_US; n++ )
+	{
+		if( !( ADCSRA & _BV( ADEN ) ) || !( ADCSRA & _BV( ADSC ) ) )
+			return;
+
+		ADCW = WORLD_adc( ( ADC_CHAN )( ADMUX & 0x1F ) );
+		if( config.adc_trace )
+			fprintf( config.adc_trace, "%llu,%u,%u,%.2f\n",
+				( unsigned long long ) now_us, ADMUX & 0x1F, ADCW,
+				WORLD_adc_clean( ADMUX & 0x1F ) );
+		ADCSRA = ( ADCSRA & ~_BV( ADSC ) ) | _BV( ADIF );
+
+		if( ( ADCSRA & _BV( ADIE ) ) && isr_vtable[ ISR_ADC_VECT ] )
+		{
+			ADCSRA &= ~_BV( ADIF );
+			in_isr = 1;
+			isr_vtable[ ISR_ADC_VECT ]();
+			in_isr = 0;
+		}
+	}
+}
+
+//===============================================================================
+//= What:	uart_tick()															=
+//= Why:	Emulates the USART0 transmitter for interrupt-driven output.		=
+//= Desc:	While UDRIE0 is set, runs the attached UDRE ISR once per byte time	=
+//=			at 38400 baud and sends whatever it writes to UDR0 to 'uart0_tx'.	=
+//= Return:	void.																=
+//= Params:	void.																=
+//= Notes:	The line time an idle transmitter saves up is capped at one byte.	=
+//===============================================================================
+static void uart_tick( void )
+{
+	uart_credit_us += SIM_TICK_US;
+
+	while( uart_credit_us >= UART_BYTE_US )
+	{
+		if( !( UCSR0B & _BV( UDRIE0 ) ) || !isr_vtable[ ISR_USART0_UDRE_VECT ] )
+		{
+			uart_credit_us = UART_BYTE_US;
+			return;
+		}
+
+		UDR0 = UDR0_EMPTY;
+		in_isr = 1;
+		isr_vtable[ ISR_USART0_UDRE_VECT ]();
+		in_isr = 0;
+
+		// Nothing written: the ring ran dry and the ISR switched off.
+		if( UDR0 == UDR0_EMPTY )
+		{
+			uart_credit_us = UART_BYTE_US;
+			return;
+		}
+
+		if( config.uart0_tx )
+			fputc( UDR0 & 0xFF, config.uart0_tx );
+		uart_credit_us -= UART_BYTE_US;
+	}
+}
+
+//===============================================================================
+//= What:	ping_edge()															=
+//= Why:	Drives the echo line to 'level' at virtual time 'at_us' and, if		=
+//=			PA3's pin-change interrupt is enabled, runs the PCINT0 ISR as if	=
+//=			at that instant (so the stopwatch reads the edge time).				=
+//===============================================================================
+static void ping_edge( uint64_t at_us, int level )
+{
+	uint64_t tick_us = now_us;
+
+	if( level )
+		PINA |= _BV( PA3 );
+	else
+		PINA &= ~_BV( PA3 );
+
+	if( ( DDRA & _BV( PA3 ) ) || !( PCICR & _BV( PCIE0 ) ) || !( PCMSK0 & _BV( PCINT3 ) ) ||
+		!isr_vtable[ ISR_PCINT0_VECT ] )
+		return;
+
+	now_us = at_us;
+	in_isr = 1;
+	isr_vtable[ ISR_PCINT0_VECT ]();
+	in_isr = 0;
+	now_us = tick_us;
+}
+
+//===============================================================================
+//= What:	ping_tick()															=
+//= Why:	Emulates the ultrasonic sensor's echo line.							=
+//= Desc:	Delivers the rising and falling edges of a scheduled echo (see		=
+//=			SIM_delay_us()) whose time has come, each at its own time stamp.	=
+//= Return:	void.																=
+//= Params:	void.																=
+//===============================================================================
+static void ping_tick( void )
+{
+	if( ping_rise_us && now_us >= ping_rise_us )
+	{
+		ping_edge( ping_rise_us, 1 );
+		ping_rise_us = 0;
+	}
+
+	if( ping_fall_us && !ping_rise_us && now_us >= ping_fall_us )
+	{
+		ping_edge( ping_fall_us, 0 );
+		ping_fall_us = 0;
+	}
+}
+
+//===============================================================================
+//= What:	servo_tick()														=
+//= Why:	Slews each RC servo toward its commanded position.					=
+//= Return:	void.																=
+//= Params:	void.																=
+//===============================================================================
+static void servo_tick( void )
+{
+	int i;
+
+	for( i = 0; i < SERVO_COUNT; i++ )
+	{
+		if( servo_pos[ i ] < servo_target[ i ] )
+			servo_pos[ i ] = fmin( servo_pos[ i ] + SERVO_POS_PER_MS, servo_target[ i ] );
+		else
+			servo_pos[ i ] = fmax( servo_pos[ i ] - SERVO_POS_PER_MS, servo_target[ i ] );
+	}
+}
+
+//===============================================================================
+//= What:	image_load()														=
+//= Why:	Fills a non-volatile memory model from a file, if there is one.		=
+//= Return:	void.																=
+//= Params:	const char *path (image file, or NULL)								=
+//=			unsigned char *mem, size_t size (memory, already erased)			=
+//= Notes:	A missing or short file leaves the memory erased (0xFF).			=
+//===============================================================================
+static void image_load( const char *path, unsigned char *mem, size_t size )
+{
+	FILE *f;
+
+	if( path == NULL || ( f = fopen( path, "rb" ) ) == NULL )
+		return;
+
+	if( fread( mem, 1, size, f ) != size )
+		memset( mem, 0xFF, size );
+	fclose( f );
+}
+
+//===============================================================================
+//= What:	image_save()														=
+//= Why:	Writes a non-volatile memory model back to its file.				=
+//= Return:	void.																=
+//= Params:	const char *path (image file, or NULL to skip)						=
+//=			const unsigned char *mem, size_t size (memory)						=
+//===============================================================================
+static void image_save( const char *path, const unsigned char *mem, size_t size )
+{
+	FILE *f;
+
+	if( path == NULL || ( f = fopen( path, "wb" ) ) == NULL )
+		return;
+
+	fwrite( mem, 1, size, f );
+	fclose( f );
+}
+
+//===============================================================================
+//= What:	SIM_reset()															=
+//= Why:	Puts the clock, stand-ins and world back to power-on state.			=
+//= Return:	void.																=
+//= Params:	const SIM_CONFIG *pConfig (episode parameters)						=
+//= Notes:	none.																=
+//===============================================================================
+void SIM_reset( const SIM_CONFIG *pConfig )
+{
+	int i;
+
+	config = *pConfig;
+	now_us = 0;
+	next_tick_us = SIM_TICK_US;
+	ticks = 0;
+	in_isr = 0;
+	memset( wheel, 0, sizeof( wheel ) );
+	memset( timers, 0, sizeof( timers ) );
+	n_timers = 0;
+	timers_fired = 0;
+	activity = last_activity = idle_polls = polls = 0;
+	adc_channel = ADC_CHAN0;
+	ADMUX = ADCSRA = 0;
+	ADCW = 0;
+	UCSR0B = 0;
+	UDR0 = UDR0_EMPTY;
+	PORTA = DDRA = PINA = DIDR0 = 0;
+	PCICR = PCIFR = PCMSK0 = 0;
+	ping_rise_us = ping_fall_us = 0;
+	for( i = 0; i < SERVO_COUNT; i++ )
+		servo_pos[ i ] = servo_target[ i ] = 128;
+	uart_credit_us = 0;
+	spi_selected = SPI_ADDR_NA;
+	memset( &flash, 0, sizeof( flash ) );
+	memset( flash_mem, 0xFF, sizeof( flash_mem ) );
+	image_load( config.flash_image, flash_mem, sizeof( flash_mem ) );
+	memset( eeprom_mem, 0xFF, sizeof( eeprom_mem ) );
+	image_load( config.eeprom_image, eeprom_mem, sizeof( eeprom_mem ) );
+	memset( isr_vtable, 0, sizeof( isr_vtable ) );
+	memset( lcd, ' ', sizeof( lcd ) );
+	lcd_row = lcd_col = 0;
+
+	// On the AVR the C runtime runs this from .init3.
+	stack_paint();
+
+	memset( &SIM_result, 0, sizeof( SIM_result ) );
+	SIM_result.seed = config.seed;
+
+	WORLD_reset( &config );
+}
+
+//===============================================================================
+//= What:	SIM_now_us()														=
+//= Return:	uint64_t (virtual microseconds since power-on).						=
+//===============================================================================
+uint64_t SIM_now_us( void )
+{
+	return now_us;
+}
+
+//===============================================================================
+//= What:	SIM_advance_us()													=
+//= Why:	The only way virtual time moves forward.							=
+//= Desc:	Runs one stepper/world/timer tick for every millisecond crossed,	=
+//=			and ends the episode on goal or on the time limit.					=
+//= Return:	void.																=
+//= Params:	uint64_t us (virtual microseconds to burn)							=
+//= Notes:	Time spent inside an emulated ISR is not charged.					=
+//===============================================================================
+void SIM_advance_us( uint64_t us )
+{
+	if( in_isr )
+		return;
+
+	now_us += us;
+
+	while( now_us >= next_tick_us )
+	{
+		next_tick_us += SIM_TICK_US;
+		ticks++;
+
+		stepper_tick();
+		timer_tick();
+		adc_tick();
+		uart_tick();
+		ping_tick();
+		servo_tick();
+
+		if( config.trace && ( ticks % TRACE_TICKS ) == 0 )
+		{
+			SIM_POSE p = WORLD_pose();
+			fprintf( config.trace, "%.3f,%.2f,%.2f,%.4f,%.0f,%.0f\n",
+				ticks / 1000.0, p.x_cm, p.y_cm, p.heading_rad,
+				wheel[ 0 ].speed, wheel[ 1 ].speed );
+		}
+
+		if( WORLD_at_goal() )
+		{
+			SIM_result.reached = 1;
+			SIM_end_episode();
+		}
+
+		if( ticks >= ( unsigned long )( config.duration_s * 1000.0 ) )
+			SIM_end_episode();
+	}
+}
+
+//===============================================================================
+//= What:	SIM_end_episode()													=
+//= Why:	CBOT_main() never returns, so the episode ends from inside it.		=
+//= Desc:	Fills in the result, hands it to the runner, and exits the worker.	=
+//= Return:	void (does not return).												=
+//= Params:	void.																=
+//= Notes:	none.																=
+//===============================================================================
+void SIM_end_episode( void )
+{
+	SIM_result.t_goal_s = now_us / 1e6;
+	SIM_result.path_cm = WORLD_path_cm();
+	SIM_result.aim_s = WORLD_aim_s();
+	SIM_result.acq_s = WORLD_acq_s();
+	SIM_result.collisions = WORLD_collisions();
+	SIM_result.loops = polls;
+
+	if( config.trace )
+		fflush( config.trace );
+	if( config.adc_trace )
+		fflush( config.adc_trace );
+	if( config.uart0_tx )
+		fflush( config.uart0_tx );
+	image_save( config.flash_image, flash_mem, sizeof( flash_mem ) );
+	image_save( config.eeprom_image, eeprom_mem, sizeof( eeprom_mem ) );
+
+	if( SIM_result_fd >= 0 )
+	{
+		if( write( SIM_result_fd, &SIM_result, sizeof( SIM_result ) ) < 0 )
+			_exit( 2 );
+	}
+
+	_exit( 0 );
+}
+
+//===============================================================================
+//= What:	SIM_timer_poll()													=
+//= Why:	Backs the TIMER_ALARM() macro.										=
+//= Desc:	Charges one poll worth of loop time.  If the loop has made no		=
+//=			input reads or motor commands for a few passes, the firmware is		=
+//=			idling on its timers, so jump straight to the next timer expiry.	=
+//= Return:	int (1 if the timer's terminal count flag is set).					=
+//= Params:	volatile TIMEROBJ *pTimer (the timer being polled)					=
+//= Notes:	Run with '-x' to disable the fast-forward and charge every pass.	=
+//===============================================================================
+int SIM_timer_poll( volatile TIMEROBJ *pTimer )
+{
+	polls++;
+	SIM_advance_us( config.poll_us );
+
+	if( !pTimer->tc && activity == last_activity )
+		idle_polls++;
+	else
+		idle_polls = 0;
+	last_activity = activity;
+
+	if( !config.exact && idle_polls > ( unsigned long )( 2 * n_timers + 2 ) )
+	{
+		unsigned long fired = timers_fired;
+
+		while( timers_fired == fired )
+			SIM_advance_us( SIM_TICK_US );
+
+		idle_polls = 0;
+	}
+
+	return pTimer->tc ? 1 : 0;
+}
+
+//===============================================================================
+//= What:	SIM_delay_us()														=
+//= Why:	Backs DELAY_ms() / DELAY_us().										=
+//===============================================================================
+void SIM_delay_us( unsigned long int us )
+{
+	// PA3 driven high through a delay is an ultrasonic trigger pulse:
+	// schedule the echo for the range the world reports.
+	if( ( DDRA & PORTA & _BV( PA3 ) ) && !ping_rise_us && !ping_fall_us )
+	{
+		double echo_us = 2.0 * WORLD_range_cm() / SOUND_CM_PER_US;
+
+		if( echo_us > PING_MAX_US )
+			echo_us = PING_MAX_US;
+		ping_rise_us = now_us + us + PING_HOLDOFF_US;
+		ping_fall_us = ping_rise_us + ( uint64_t ) echo_us;
+	}
+
+	SIM_advance_us( us );
+}
+
+//===============================================================================
+//= What:	Timer service stand-ins.											=
+//===============================================================================
+TMRNEW_RESULT TMRSRVC_new( TIMEROBJ *pTimerObject, TMR_FLGS validNotifyFlags,
+	TMR_TCMODE tcMode, TIMER16 nTicks )
+{
+	int i;
+
+	for( i = 0; i < n_timers; i++ )
+		if( timers[ i ] == pTimerObject )
+			break;
+
+	if( i == n_timers )
+	{
+		if( n_timers == MAX_TIMERS )
+			return TMRNEW_OUTOFMEMORY;
+		timers[ n_timers++ ] = pTimerObject;
+	}
+
+	pTimerObject->flags = validNotifyFlags | TMRFLG_ENABLED |
+		( tcMode == TMR_TCM_RESTART ? TMRFLG_RESTART : 0 );
+	pTimerObject->timeReq = nTicks;
+	pTimerObject->ticks = nTicks;
+	pTimerObject->tc = 0;
+
+	return TMRNEW_OK;
+}
+
+void TMRSRVC_stop_timer( TIMEROBJ *pWhich )
+{
+	pWhich->flags &= ~TMRFLG_ENABLED;
+}
+
+TMRNEW_RESULT TMRSRVC_delay( TIMER16 delay_ms )
+{
+	SIM_advance_us( ( uint64_t ) delay_ms * 1000 );
+	return TMRNEW_OK;
+}
+
+//===============================================================================
+//= What:	LED stand-ins (no visible effect).									=
+//===============================================================================
+SUBSYS_STATUS LED_open( void ) { return SUBSYS_OPEN; }
+void LED_set_pattern( unsigned char LED_pattern ) { ( void ) LED_pattern; }
+void LED_clr_pattern( unsigned char LED_pattern ) { ( void ) LED_pattern; }
+void LED_tog_pattern( unsigned char LED_pattern ) { ( void ) LED_pattern; }
+
+//===============================================================================
+//= What:	LCD stand-ins.														=
+//= Desc:	Render into a 4x21 character buffer and charge 'lcd_us' per			=
+//=			clear or printf, so display jitter shows up in the loop timing.		=
+//=			Single characters and cursor moves are charged one					=
+//=			character's share of a row, lcd_us / LCD_nCOLS.						=
+//===============================================================================
+SUBSYS_STATUS LCD_open( void ) { return SUBSYS_OPEN; }
+
+void LCD_clear( void )
+{
+	memset( lcd, ' ', sizeof( lcd ) );
+	lcd_row = lcd_col = 0;
+	SIM_advance_us( config.lcd_us );
+}
+
+void LCD_set_RC( unsigned char row, unsigned char col )
+{
+	lcd_row = row % LCD_nPAGES;
+	lcd_col = col % LCD_nCOLS;
+	SIM_advance_us( config.lcd_us / LCD_nCOLS );
+}
+
+static void lcd_store( char c )
+{
+	if( c == '\n' )
+	{
+		lcd_row = ( lcd_row + 1 ) % LCD_nPAGES;
+		lcd_col = 0;
+		return;
+	}
+
+	if( lcd_col < LCD_nCOLS )
+		lcd[ lcd_row ][ lcd_col++ ] = c;
+}
+
+void LCD_putchar( char c )
+{
+	lcd_store( c );
+	SIM_advance_us( config.lcd_us / LCD_nCOLS );
+}
+
+int SIM_LCD_printf( const char *fmt, ... )
+{
+	char buf[ 128 ];
+	va_list ap;
+	int n, i;
+
+	va_start( ap, fmt );
+	n = vsnprintf( buf, sizeof( buf ), fmt, ap );
+	va_end( ap );
+
+	for( i = 0; buf[ i ]; i++ )
+		lcd_store( buf[ i ] );
+
+	SIM_advance_us( config.lcd_us );
+	return n;
+}
+
+//===============================================================================
+//= What:	ATtiny stand-ins.													=
+//===============================================================================
+unsigned char ATTINY_get_sensors( void )
+{
+	unsigned char bits = 0;
+	int sw3_down = ( now_us >= SW3_PRESS_US && now_us < SW3_RELEASE_US );
+
+	activity++;
+	SIM_advance_us( ATTINY_QUERY_US );
+
+	if( WORLD_ir( 1 ) )
+		bits |= SNSR_IR_LEFT;
+	if( WORLD_ir( 0 ) )
+		bits |= SNSR_IR_RIGHT;
+	if( sw3_down )
+		bits |= SNSR_SW3;
+
+	// The edge bit is reported by the first read that sees the press.
+	if( sw3_down && !sw3_reported )
+		bits |= SNSR_SW3_EDGE;
+	sw3_reported = sw3_down;
+
+	return bits;
+}
+
+void ATTINY_set_RC_servos( unsigned int RCS0_pos, unsigned int RCS1_pos,
+	unsigned int RCS2_pos, unsigned int RCS3_pos, unsigned int RCS4_pos )
+{
+	activity++;
+	SIM_advance_us( ATTINY_QUERY_US );
+
+	servo_target[ 0 ] = RCS0_pos & 0xFF;
+	servo_target[ 1 ] = RCS1_pos & 0xFF;
+	servo_target[ 2 ] = RCS2_pos & 0xFF;
+	servo_target[ 3 ] = RCS3_pos & 0xFF;
+	servo_target[ 4 ] = RCS4_pos & 0xFF;
+}
+
+void ATTINY_set_RC_servo( RCSERVO_ID which, unsigned int RCS_pos )
+{
+	activity++;
+	SIM_advance_us( ATTINY_QUERY_US );
+
+	if( which < SERVO_COUNT )
+		servo_target[ which ] = RCS_pos & 0xFF;
+}
+
+//===============================================================================
+//= What:	SIM_servo_rad()														=
+//= Why:	Where a servo horn points, for sensors mounted on it.				=
+//= Return:	double (radians from centre, CCW positive; 0-255 spans +/-90deg).	=
+//= Params:	int which (RC_SERVOx)												=
+//===============================================================================
+double SIM_servo_rad( int which )
+{
+	return ( servo_pos[ which ] - 128.0 ) * ( M_PI / 2.0 ) / 127.0;
+}
+
+BOOL ATTINY_get_SW_state( ATTINY_SW which )
+{
+	unsigned char bits = ATTINY_get_sensors();
+
+	return ( which == ATTINY_SW3 && ( bits & SNSR_SW3_EDGE ) ) ? TRUE : FALSE;
+}
+
+BOOL ATTINY_get_IR_state( ATTINY_IR which )
+{
+	unsigned char bits = ATTINY_get_sensors();
+	BOOL left = ( bits & SNSR_IR_LEFT ) ? TRUE : FALSE;
+	BOOL right = ( bits & SNSR_IR_RIGHT ) ? TRUE : FALSE;
+
+	switch( which )
+	{
+		case ATTINY_IR_LEFT:	return left;
+		case ATTINY_IR_RIGHT:	return right;
+		case ATTINY_IR_EITHER:	return ( left || right ) ? TRUE : FALSE;
+		case ATTINY_IR_BOTH:	return ( left && right ) ? TRUE : FALSE;
+	}
+
+	return FALSE;
+}
+
+//===============================================================================
+//= What:	Stepper stand-ins.													=
+//===============================================================================
+SUBSYS_STATUS STEPPER_open( void ) { return SUBSYS_OPEN; }
+
+void STEPPER_set_accel2( unsigned short int accel_L, unsigned short int accel_R )
+{
+	activity++;
+	wheel[ 0 ].accel = accel_L;
+	wheel[ 1 ].accel = accel_R;
+	SIM_advance_us( STEPPER_CMD_US );
+}
+
+void STEPPER_runn( signed short int nStepsPerSec_L, signed short int nStepsPerSec_R )
+{
+	activity++;
+	wheel[ 0 ].step_mode = wheel[ 1 ].step_mode = 0;
+	wheel[ 0 ].target = fmax( fmin( nStepsPerSec_L, STEPPER_MAX_SPEED ), -STEPPER_MAX_SPEED );
+	wheel[ 1 ].target = fmax( fmin( nStepsPerSec_R, STEPPER_MAX_SPEED ), -STEPPER_MAX_SPEED );
+	SIM_advance_us( STEPPER_CMD_US );
+}
+
+void STEPPER_stop( STEPPER_ID which, STEPPER_BRKMODE brakeMode )
+{
+	int i;
+
+	( void ) brakeMode;
+	activity++;
+
+	for( i = 0; i < 2; i++ )
+	{
+		if( which == STEPPER_BOTH || ( int ) which == i )
+		{
+			wheel[ i ].speed = wheel[ i ].target = 0;
+			wheel[ i ].remaining = 0;
+			wheel[ i ].step_mode = 0;
+		}
+	}
+	SIM_advance_us( STEPPER_CMD_US );
+}
+
+STEPPER_SPEED STEPPER_get_curr_speed( void )
+{
+	STEPPER_SPEED s;
+
+	activity++;
+	s.left = ( signed short int ) wheel[ 0 ].speed;
+	s.right = ( signed short int ) wheel[ 1 ].speed;
+	return s;
+}
+
+STEPPER_STEPS STEPPER_get_nSteps( void )
+{
+	STEPPER_STEPS s;
+
+	activity++;
+	// Round up: a wheel still on its last fractional step has not
+	// stopped yet, and the firmware polls this for move completion.
+	s.left = ( unsigned short int ) ceil( wheel[ 0 ].remaining );
+	s.right = ( unsigned short int ) ceil( wheel[ 1 ].remaining );
+	return s;
+}
+
+void STEPPER_move( STEPPER_RUNMODE run_mode, STEPPER_ID which,
+	STEPPER_DIR dir_L, unsigned short int steps_L, unsigned short int speed_L,
+	unsigned short int accel_L, STEPPER_BRKMODE brkmode_L, STEPPER_EVENT_PTR step_event_L,
+	STEPPER_DIR dir_R, unsigned short int steps_R, unsigned short int speed_R,
+	unsigned short int accel_R, STEPPER_BRKMODE brkmode_R, STEPPER_EVENT_PTR step_event_R )
+{
+	struct { STEPPER_DIR dir; unsigned short steps, speed, accel; STEPPER_EVENT_PTR ev; } arg[ 2 ] = {
+		{ dir_L, steps_L, speed_L, accel_L, step_event_L },
+		{ dir_R, steps_R, speed_R, accel_R, step_event_R }
+	};
+	int i;
+
+	( void ) brkmode_L;
+	( void ) brkmode_R;
+	activity++;
+
+	for( i = 0; i < 2; i++ )
+	{
+		SIM_WHEEL *w = &wheel[ i ];
+
+		if( !( which == STEPPER_BOTH || ( int ) which == i ) )
+			continue;
+
+		w->target = fmin( arg[ i ].speed, STEPPER_MAX_SPEED );
+		if( arg[ i ].dir != STEPPER_FWD )
+			w->target = -w->target;
+		w->accel = arg[ i ].accel;
+		w->step_mode = ( run_mode != STEPPER_FREERUNNING ) && arg[ i ].steps;
+		w->remaining = w->step_mode ? arg[ i ].steps : 0;
+		w->on_done = arg[ i ].ev;
+		if( run_mode != STEPPER_FREERUNNING && !arg[ i ].steps )
+			w->target = 0;
+	}
+	SIM_advance_us( STEPPER_CMD_US );
+
+	if( run_mode == STEPPER_STEP_BLOCK )
+	{
+		while( wheel[ 0 ].step_mode || wheel[ 1 ].step_mode )
+			SIM_advance_us( SIM_TICK_US );
+
+		for( i = 0; i < 2; i++ )
+			if( ( which == STEPPER_BOTH || ( int ) which == i ) && wheel[ i ].on_done )
+				wheel[ i ].on_done();
+	}
+}
+
+//===============================================================================
+//= What:	ADC stand-ins.														=
+//===============================================================================
+SUBSYS_STATUS ADC_open( void )
+{
+	ADCSRA = _BV( ADEN ) | 0x07;
+	return SUBSYS_OPEN;
+}
+
+void ADC_set_VREF( ADC_VREF which )
+{
+	ADMUX = ( ADMUX & 0x3F ) | ( ( which == ADC_VREF_AVCC ) ? _BV( REFS0 ) : 0 );
+}
+
+void ADC_set_channel( ADC_CHAN which )
+{
+	adc_channel = which;
+	ADMUX = ( ADMUX & 0xE0 ) | ( which & 0x1F );
+}
+
+ADC_SAMPLE ADC_sample( void )
+{
+	activity++;
+	SIM_advance_us( ADC_SAMPLE_US );
+	return WORLD_adc( adc_channel );
+}
+
+//===============================================================================
+//= What:	ISR stand-ins.  adc_tick() dispatches through the table.			=
+//===============================================================================
+SUBSYS_STATUS ISR_open( void ) { return SUBSYS_OPEN; }
+
+CBOT_ISR_FUNC_PTR ISR_attach( ISR_VECT vect, CBOT_ISR_FUNC_PTR isr_function )
+{
+	CBOT_ISR_FUNC_PTR previous = isr_vtable[ vect ];
+
+	isr_vtable[ vect ] = isr_function;
+	return previous;
+}
+
+//===============================================================================
+//= What:	SPI stand-ins and the SPI flash model.								=
+//= Desc:	Only the flash (SPI_ADDR_SPIFLASH) is modelled: a JEDEC part with	=
+//=			read, page program, 4KB erase, status, write enable and ID.			=
+//=			Programs and erases take effect when the flash is deselected and	=
+//=			keep it busy for their typical time; commands other than a			=
+//=			status read are ignored while busy, as on the real part.			=
+//===============================================================================
+static void flash_deselect( void )
+{
+	int busy = now_us < flash.busy_until_us;
+	unsigned int i;
+
+	if( flash.n == 0 || busy )
+		return;
+
+	switch( flash.cmd )
+	{
+		case 0x06:	// Write enable.
+			flash.wel = 1;
+			break;
+
+		case 0x01:	// Write status (protection bits are not modelled).
+			flash.wel = 0;
+			break;
+
+		case 0x02:	// Page program: can only clear bits, wraps in the page.
+			if( flash.wel && flash.n >= 4 )
+			{
+				for( i = 0; i < flash.data_n && i < FLASH_PAGE; i++ )
+					flash_mem[ ( flash.addr & ~( FLASH_PAGE - 1UL ) ) |
+						( ( flash.addr + i ) & ( FLASH_PAGE - 1 ) ) ] &= flash.data[ i ];
+				flash.busy_until_us = now_us + FLASH_PROGRAM_US;
+			}
+			flash.wel = 0;
+			break;
+
+		case 0x20:	// 4KB sector erase.
+			if( flash.wel && flash.n >= 4 )
+			{
+				memset( &flash_mem[ flash.addr & ~( FLASH_SECTOR - 1UL ) ], 0xFF, FLASH_SECTOR );
+				flash.busy_until_us = now_us + FLASH_ERASE_US;
+			}
+			flash.wel = 0;
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void spi_select( SPI_SSADDR which )
+{
+	if( which == spi_selected )
+		return;
+
+	if( spi_selected == SPI_ADDR_SPIFLASH )
+		flash_deselect();
+
+	spi_selected = which;
+	flash.n = 0;
+	flash.data_n = 0;
+}
+
+static unsigned char flash_byte( unsigned char in )
+{
+	static const unsigned char jedec_id[ 3 ] = { 0x1F, 0x44, 0x01 };
+	unsigned long n = flash.n++;
+
+	if( n == 0 )
+	{
+		flash.cmd = in;
+		flash.addr = 0;
+		return 0xFF;
+	}
+
+	if( flash.cmd == 0x05 )		// Status: busy, write enable latch.
+		return ( now_us < flash.busy_until_us ? 0x01 : 0 ) | ( flash.wel ? 0x02 : 0 );
+
+	if( flash.cmd == 0x9F )
+		return n <= 3 ? jedec_id[ n - 1 ] : 0;
+
+	if( n <= 3 )
+	{
+		flash.addr = ( ( flash.addr << 8 ) | in ) & ( FLASH_SIZE - 1 );
+		return 0xFF;
+	}
+
+	if( flash.cmd == 0x03 && now_us >= flash.busy_until_us )
+		return flash_mem[ ( flash.addr + n - 4 ) & ( FLASH_SIZE - 1 ) ];
+
+	if( flash.cmd == 0x02 )
+		flash.data[ flash.data_n++ % FLASH_PAGE ] = in;
+
+	return 0xFF;
+}
+
+SUBSYS_STATUS SPIFLASH_open( void ) { return SUBSYS_OPEN; }
+
+void SPI_set_slave_addr( SPI_SSADDR slaveSelectAddr )
+{
+	spi_select( slaveSelectAddr );
+}
+
+void SPI_transmit( SPI_SSADDR slaveSelectAddr, unsigned char data )
+{
+	spi_select( slaveSelectAddr );
+	if( slaveSelectAddr == SPI_ADDR_SPIFLASH )
+		flash_byte( data );
+	SIM_advance_us( SPI_BYTE_US );
+}
+
+unsigned char SPI_receive( SPI_SSADDR slaveSelectAddr, unsigned char data )
+{
+	unsigned char in = 0xFF;
+
+	activity++;
+	spi_select( slaveSelectAddr );
+	if( slaveSelectAddr == SPI_ADDR_SPIFLASH )
+		in = flash_byte( data );
+	SIM_advance_us( SPI_BYTE_US );
+	return in;
+}
+
+//===============================================================================
+//= What:	avr-libc EEPROM stand-ins.											=
+//= Desc:	Reads are free; an update rewrites only the bytes that differ,		=
+//=			each costing one EEPROM write cycle, as eeprom_update_block()		=
+//=			does on the part.													=
+//===============================================================================
+void eeprom_read_block( void *dst, const void *src, size_t n )
+{
+	size_t addr = ( size_t ) src;
+
+	if( addr + n > EEPROM_SIZE )
+		n = addr < EEPROM_SIZE ? EEPROM_SIZE - addr : 0;
+	memcpy( dst, &eeprom_mem[ addr ], n );
+}
+
+void eeprom_update_block( const void *src, void *dst, size_t n )
+{
+	const unsigned char *p = src;
+	size_t addr = ( size_t ) dst, i;
+
+	for( i = 0; i < n && addr + i < EEPROM_SIZE; i++ )
+	{
+		if( eeprom_mem[ addr + i ] != p[ i ] )
+		{
+			eeprom_mem[ addr + i ] = p[ i ];
+			SIM_advance_us( EEPROM_WRITE_US );
+		}
+	}
+}
+
+//===============================================================================
+//= What:	Stopwatch stand-ins.												=
+//= Desc:	10us per tick, 16-bit, counting virtual time while started.			=
+//===============================================================================
+static uint64_t swatch_base_us;
+static SWTIME swatch_held;
+static int swatch_running;
+
+SUBSYS_STATUS STOPWATCH_open( void ) { return SUBSYS_OPEN; }
+
+SWTIME STOPWATCH_get_ticks( void )
+{
+	if( !swatch_running )
+		return swatch_held;
+
+	return ( SWTIME )( swatch_held + ( now_us - swatch_base_us ) / 10 );
+}
+
+void STOPWATCH_start( void )
+{
+	if( swatch_running )
+		return;
+	swatch_base_us = now_us;
+	swatch_running = 1;
+}
+
+SWTIME STOPWATCH_stop( void )
+{
+	swatch_held = STOPWATCH_get_ticks();
+	swatch_running = 0;
+	return swatch_held;
+}
+
+SWTIME STOPWATCH_reset( void )
+{
+	SWTIME t = STOPWATCH_get_ticks();
+
+	swatch_held = 0;
+	swatch_base_us = now_us;
+	return t;
+}
+
+void STOPWATCH_set( SWTIME value )
+{
+	swatch_held = value;
+	swatch_base_us = now_us;
+}
+
+//===============================================================================
+//= What:	UART stand-ins.														=
+//= Desc:	UART0 output goes to 'uart0_tx'; input is the '-k' script, which	=
+//=			becomes readable at its scheduled virtual time.  UART1 is mute.		=
+//===============================================================================
+
+static const char *uart0_rx_next;
+
+SUBSYS_STATUS UART_open( UART_ID which ) { ( void ) which; return SUBSYS_OPEN; }
+void UART_set_TX_state( UART_ID which, UART_STATE uart_state ) { ( void ) which; ( void ) uart_state; }
+void UART_set_RX_state( UART_ID which, UART_STATE uart_state ) { ( void ) which; ( void ) uart_state; }
+
+void UART_configure( UART_ID which, UART_DBITS data_bits,
+	UART_SBITS stop_bits, UART_PARITY parity, UART_BAUD baud_rate )
+{
+	( void ) which; ( void ) data_bits; ( void ) stop_bits; ( void ) parity; ( void ) baud_rate;
+	uart0_rx_next = config.uart0_rx;
+}
+
+UART_COMM_RESULT UART_transmit( UART_ID which, unsigned char data )
+{
+	if( which == UART_UART0 && config.uart0_tx )
+		fputc( data, config.uart0_tx );
+	SIM_advance_us( UART_BYTE_US );
+	return UART_COMM_OK;
+}
+
+BOOL UART_has_data( UART_ID which )
+{
+	return ( which == UART_UART0 && uart0_rx_next && *uart0_rx_next &&
+		now_us >= ( uint64_t )( config.uart0_rx_at_s * 1e6 ) ) ? TRUE : FALSE;
+}
+
+UART_COMM_RESULT UART_receive( UART_ID which, unsigned char *pDest )
+{
+	if( UART_has_data( which ) == FALSE )
+		return UART_COMM_TIMEOUT;
+
+	activity++;
+	*pDest = ( unsigned char ) *uart0_rx_next++;
+	return UART_COMM_OK;
+}
+
+static void uart_vprintf( UART_ID which, const char *fmt, va_list ap )
+{
+	char buf[ 256 ];
+	int i, n;
+
+	n = vsnprintf( buf, sizeof( buf ), fmt, ap );
+	if( n > ( int ) sizeof( buf ) - 1 )
+		n = sizeof( buf ) - 1;
+
+	for( i = 0; i < n; i++ )
+		UART_transmit( which, buf[ i ] );
+}
+
+void UART_printf( UART_ID which, const char *str_fmt, ... )
+{
+	va_list ap;
+
+	va_start( ap, str_fmt );
+	uart_vprintf( which, str_fmt, ap );
+	va_end( ap );
+}
+
+// avr-libc's '%S' prints a string from flash; flash is ordinary memory on
+// the host, so it is rewritten to '%s' before formatting.
+void UART_printf_PGM( UART_ID which, const char *str_fmt, ... )
+{
+	char fmt[ 256 ];
+	va_list ap;
+	int i, in_spec = 0;
+
+	for( i = 0; str_fmt[ i ] && i < ( int ) sizeof( fmt ) - 1; i++ )
+	{
+		char c = str_fmt[ i ];
+
+		if( c == '%' )
+			in_spec = !in_spec;
+		else if( in_spec && c == 'S' )
+			c = 's';
+		if( in_spec && c != '%' && ( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ) && c != 'l' && c != 'h' )
+			in_spec = 0;
+		fmt[ i ] = c;
+	}
+	fmt[ i ] = '\0';
+
+	va_start( ap, str_fmt );
+	uart_vprintf( which, fmt, ap );
+	va_end( ap );
+}
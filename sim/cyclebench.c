@@ -0,0 +1,449 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	cyclebench.c													=
+//= Desc:		Cycle-accurate firmware bench.  Runs the avr-gcc build of the	=
+//=				firmware in simavr's ATmega324P, feeds it a scripted scenario	=
+//=				(ADC voltages and ATtiny sensor bytes), and counts the CPU		=
+//=				cycles of each call to the functions it is told to watch.		=
+//= Functions:	main()															=
+//= Other:		Function entry addresses come from the command line ('make		=
+//=				cyclebench' takes them from avr-nm).  A call is timed from		=
+//=				its first instruction until the stack pointer rises above		=
+//=				where it was on entry (the return), so the count is inclusive	=
+//=				of callees and of any interrupt that landed in between.			=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+//===============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_adc.h>
+#include <simavr/avr_eeprom.h>
+#include <simavr/avr_spi.h>
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+#define MAX_FUNCS		16
+#define MAX_EVENTS		256
+#define CPU_HZ			20000000UL	// F_CPU of the .cproj builds.
+#define VCC_MV			5000		// AVCC and AREF (ADC_VREF_AVCC).
+#define EEPROM_SIZE		1024
+#define PORTB_IO		0x05		// SPI_set_slave_addr() drives PORTB bits 0-2.
+#define SPI_ADDR_MASK	0x07
+#define SPI_ADDR_TINY	2			// The ATtiny's slave address.
+#define TINY_CMD		0x0A		// ATtiny command prefix (libcapi324v22x).
+#define TINY_GET_SNSR	0xB2		// ATTINY_get_sensors() command.
+#define TINY_EDGE_MASK	0xE0		// SNSR_SWx_EDGE bits.
+
+//===============================================================================
+//= What:	Type Declarations.													=
+//===============================================================================
+
+// Desc: One watched function and its statistics.
+typedef struct BENCH_FUNC_TYPE {
+	char name[ 32 ];
+	avr_flashaddr_t addr;			// Entry, byte address.
+	int active;						// A call is in progress.
+	uint16_t entry_sp;				// SP just after the call pushed its return.
+	avr_cycle_count_t entry_cycle;
+	unsigned long calls;
+	avr_cycle_count_t min, max, total;
+} BENCH_FUNC;
+
+// Desc: What a scenario event sets.
+typedef enum BENCH_EVENT_KIND_TYPE {
+	EVENT_ADC,						// One ADC input, millivolts.
+	EVENT_TINY						// The ATtiny's sensor byte.
+} BENCH_EVENT_KIND;
+
+// Desc: One line of the scenario.
+typedef struct BENCH_EVENT_TYPE {
+	unsigned long t_ms;
+	BENCH_EVENT_KIND kind;
+	unsigned int chan;
+	unsigned int value;
+} BENCH_EVENT;
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+static BENCH_FUNC funcs[ MAX_FUNCS ];
+static int n_funcs = 0;
+
+// The loop is timed between successive entries to this function.
+static BENCH_FUNC loop;
+static int have_loop = 0;
+
+static BENCH_EVENT events[ MAX_EVENTS ];
+static int n_events = 0;
+
+// The scripted ATtiny: switch and IR levels, and the switch press bits
+// still waiting to be read (the ATtiny reports each press once).
+static uint8_t tiny_state = 0;
+static uint8_t tiny_edges = 0;
+
+// Set once ATTINY_get_sensors()'s command is out, so the next byte is
+// the reading.
+static int tiny_reading = 0;
+static uint8_t spi_last = 0;
+static avr_irq_t *spi_in;
+
+//===============================================================================
+//= What:	usage()																=
+//===============================================================================
+static void usage( const char *argv0 )
+{
+	fprintf( stderr,
+		"usage: %s [options] FIRMWARE.elf\n"
+		"  -f NAME=ADDR   time calls to the function at ADDR (repeatable)\n"
+		"  -l NAME=ADDR   time the loop as the gap between entries to ADDR\n"
+		"  -s FILE        scenario: 't_ms adc CH MV' and 't_ms tiny BYTE' lines\n"
+		"  -t SEC         simulated time to run (default 10)\n"
+		"  -e FILE        EEPROM image, loaded before and saved after the run\n"
+		"  -c COMMIT      first column of the CSV (default '-')\n"
+		"  -o FILE        CSV output (default stdout)\n"
+		"  -m MCU         simavr core (default atmega324p)\n", argv0 );
+	exit( 1 );
+}
+
+//===============================================================================
+//= What:	parse_func()														=
+//= Why:	Turns "act=0x1a2c" into a watched function.							=
+//= Return:	int (0 on success).													=
+//===============================================================================
+static int parse_func( const char *text, BENCH_FUNC *pFunc )
+{
+	const char *eq = strchr( text, '=' );
+	size_t len;
+
+	if( !eq || eq == text )
+		return -1;
+
+	len = eq - text;
+	if( len >= sizeof( pFunc->name ) )
+		len = sizeof( pFunc->name ) - 1;
+
+	memset( pFunc, 0, sizeof( *pFunc ) );
+	memcpy( pFunc->name, text, len );
+	pFunc->addr = strtoul( eq + 1, NULL, 0 );
+	pFunc->min = ~( avr_cycle_count_t ) 0;
+
+	return pFunc->addr ? 0 : -1;
+}
+
+//===============================================================================
+//= What:	load_scenario()														=
+//= Why:	Reads the scenario into 'events', which must be in time order.		=
+//===============================================================================
+static void load_scenario( const char *path )
+{
+	FILE *f = fopen( path, "r" );
+	char line[ 128 ], kind[ 8 ];
+	unsigned long t_ms;
+	unsigned int a, b;
+	int fields, n = 0;
+
+	if( !f )
+	{
+		perror( path );
+		exit( 1 );
+	}
+
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		n++;
+		if( line[ 0 ] == '#' || line[ strspn( line, " \t\r\n" ) ] == '\0' )
+			continue;
+
+		fields = sscanf( line, "%lu %7s %i %i", &t_ms, kind, &a, &b );
+		if( n_events == MAX_EVENTS ||
+			( n_events > 0 && t_ms < events[ n_events - 1 ].t_ms ) )
+			goto bad;
+
+		events[ n_events ].t_ms = t_ms;
+		if( fields == 4 && strcmp( kind, "adc" ) == 0 && a < 8 )
+		{
+			events[ n_events ].kind = EVENT_ADC;
+			events[ n_events ].chan = a;
+			events[ n_events ].value = b;
+		}
+		else if( fields == 3 && strcmp( kind, "tiny" ) == 0 && a < 256 )
+		{
+			events[ n_events ].kind = EVENT_TINY;
+			events[ n_events ].value = a;
+		}
+		else
+			goto bad;
+		n_events++;
+	}
+
+	fclose( f );
+	return;
+
+bad:
+	fprintf( stderr, "%s:%d: bad or out-of-order event\n", path, n );
+	exit( 1 );
+}
+
+//===============================================================================
+//= What:	spi_out()															=
+//= Why:	Answers each byte the firmware clocks out as the selected slave		=
+//=			would.																=
+//= Desc:	The ATtiny answers with the scripted sensor byte.  The byte that	=
+//=			follows ATTINY_get_sensors()'s command carries the latched press	=
+//=			bits too, and clears them.  Every other slave answers 0x00: the		=
+//=			LCD is write-only, and a flash whose JEDEC ID reads 0x00 leaves		=
+//=			the flight recorder off.											=
+//= Notes:	The slave address is read back from PORTB, where the CAPI's			=
+//=			SPI_set_slave_addr() puts it.										=
+//===============================================================================
+static void spi_out( struct avr_irq_t *irq, uint32_t value, void *param )
+{
+	avr_t *avr = ( avr_t * ) param;
+	uint8_t reply = 0x00;
+
+	( void ) irq;
+
+	if( ( avr->data[ AVR_IO_TO_DATA( PORTB_IO ) ] & SPI_ADDR_MASK ) == SPI_ADDR_TINY )
+	{
+		reply = tiny_state;
+		if( tiny_reading )
+		{
+			reply |= tiny_edges;
+			tiny_edges = 0;
+		}
+		tiny_reading = ( spi_last == TINY_CMD ) && ( value == TINY_GET_SNSR );
+	}
+	else
+		tiny_reading = 0;
+
+	spi_last = ( uint8_t ) value;
+	avr_raise_irq( spi_in, reply );
+}
+
+//===============================================================================
+//= What:	apply_event()														=
+//===============================================================================
+static void apply_event( avr_t *avr, const BENCH_EVENT *pEvent )
+{
+	if( pEvent->kind == EVENT_ADC )
+		avr_raise_irq( avr_io_getirq( avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0 + pEvent->chan ),
+			pEvent->value );
+	else
+	{
+		tiny_state = ( uint8_t ) pEvent->value & ~TINY_EDGE_MASK;
+		tiny_edges |= ( uint8_t ) pEvent->value & TINY_EDGE_MASK;
+	}
+}
+
+//===============================================================================
+//= What:	eeprom_io()															=
+//= Why:	Loads ('save' 0) or saves the EEPROM image at 'path'.				=
+//= Notes:	A missing image on load leaves the EEPROM erased (0xFF).			=
+//===============================================================================
+static void eeprom_io( avr_t *avr, const char *path, int save )
+{
+	static uint8_t image[ EEPROM_SIZE ];
+	avr_eeprom_desc_t desc;
+	FILE *f;
+
+	memset( &desc, 0, sizeof( desc ) );
+	desc.offset = 0;
+	desc.size = EEPROM_SIZE;
+
+	if( save )
+	{
+		if( avr_ioctl( avr, AVR_IOCTL_EEPROM_GET, &desc ) < 0 || !desc.ee )
+			return;
+		if( ( f = fopen( path, "wb" ) ) )
+		{
+			fwrite( desc.ee, 1, EEPROM_SIZE, f );
+			fclose( f );
+		}
+		return;
+	}
+
+	if( !( f = fopen( path, "rb" ) ) )
+		return;
+	memset( image, 0xFF, sizeof( image ) );
+	if( fread( image, 1, sizeof( image ), f ) > 0 )
+	{
+		desc.ee = image;
+		avr_ioctl( avr, AVR_IOCTL_EEPROM_SET, &desc );
+	}
+	fclose( f );
+}
+
+//===============================================================================
+//= What:	record()															=
+//===============================================================================
+static void record( BENCH_FUNC *pFunc, avr_cycle_count_t cycles )
+{
+	pFunc->calls++;
+	pFunc->total += cycles;
+	if( cycles < pFunc->min )
+		pFunc->min = cycles;
+	if( cycles > pFunc->max )
+		pFunc->max = cycles;
+}
+
+//===============================================================================
+//= What:	print_row()															=
+//===============================================================================
+static void print_row( FILE *out, const char *commit, const BENCH_FUNC *pFunc )
+{
+	if( pFunc->calls == 0 )
+		fprintf( out, "%s,%s,0,,,\n", commit, pFunc->name );
+	else
+		fprintf( out, "%s,%s,%lu,%llu,%llu,%.1f\n", commit, pFunc->name, pFunc->calls,
+			( unsigned long long ) pFunc->min, ( unsigned long long ) pFunc->max,
+			( double ) pFunc->total / pFunc->calls );
+}
+
+//===============================================================================
+//= What:	main()																=
+//= Why:	Parses options, runs the firmware, then writes the CSV.				=
+//===============================================================================
+int main( int argc, char *argv[] )
+{
+	const char *mcu = "atmega324p", *scenario = NULL, *eeprom = NULL;
+	const char *commit = "-", *out_path = NULL;
+	double seconds = 10.0;
+	avr_cycle_count_t end, due;
+	elf_firmware_t firmware;
+	avr_t *avr;
+	FILE *out = stdout;
+	uint16_t sp;
+	int opt, i, next = 0, state;
+
+	while( ( opt = getopt( argc, argv, "f:l:s:t:e:c:o:m:h" ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 'f':
+				if( n_funcs == MAX_FUNCS || parse_func( optarg, &funcs[ n_funcs ] ) )
+					usage( argv[ 0 ] );
+				n_funcs++;
+				break;
+			case 'l':
+				if( parse_func( optarg, &loop ) )
+					usage( argv[ 0 ] );
+				snprintf( loop.name, sizeof( loop.name ), "loop" );
+				have_loop = 1;
+				break;
+			case 's': scenario = optarg; break;
+			case 't': seconds = atof( optarg ); break;
+			case 'e': eeprom = optarg; break;
+			case 'c': commit = optarg; break;
+			case 'o': out_path = optarg; break;
+			case 'm': mcu = optarg; break;
+			default: usage( argv[ 0 ] );
+		}
+	}
+	if( optind != argc - 1 || seconds <= 0 )
+		usage( argv[ 0 ] );
+
+	if( scenario )
+		load_scenario( scenario );
+
+	memset( &firmware, 0, sizeof( firmware ) );
+	if( elf_read_firmware( argv[ optind ], &firmware ) )
+	{
+		fprintf( stderr, "%s: cannot load\n", argv[ optind ] );
+		return 1;
+	}
+
+	if( !( avr = avr_make_mcu_by_name( mcu ) ) )
+	{
+		fprintf( stderr, "simavr has no '%s' core\n", mcu );
+		return 1;
+	}
+	avr_init( avr );
+	avr_load_firmware( avr, &firmware );
+	avr->frequency = CPU_HZ;
+	avr->avcc = VCC_MV;
+	avr->aref = VCC_MV;
+
+	spi_in = avr_io_getirq( avr, AVR_IOCTL_SPI_GETIRQ( 0 ), SPI_IRQ_INPUT );
+	avr_irq_register_notify( avr_io_getirq( avr, AVR_IOCTL_SPI_GETIRQ( 0 ), SPI_IRQ_OUTPUT ),
+		spi_out, avr );
+
+	if( eeprom )
+		eeprom_io( avr, eeprom, 0 );
+
+	end = ( avr_cycle_count_t )( seconds * CPU_HZ );
+
+	do
+	{
+		// Scenario events fall due on the simulated clock.
+		while( next < n_events )
+		{
+			due = ( avr_cycle_count_t ) events[ next ].t_ms * ( CPU_HZ / 1000 );
+			if( avr->cycle < due )
+				break;
+			apply_event( avr, &events[ next++ ] );
+		}
+
+		state = avr_run( avr );
+
+		sp = avr->data[ R_SPL ] | ( avr->data[ R_SPH ] << 8 );
+
+		// Returns first: a call ends once SP is back above its entry value.
+		for( i = 0; i < n_funcs; i++ )
+			if( funcs[ i ].active && sp > funcs[ i ].entry_sp )
+			{
+				record( &funcs[ i ], avr->cycle - funcs[ i ].entry_cycle );
+				funcs[ i ].active = 0;
+			}
+
+		for( i = 0; i < n_funcs; i++ )
+			if( !funcs[ i ].active && avr->pc == funcs[ i ].addr )
+			{
+				funcs[ i ].active = 1;
+				funcs[ i ].entry_sp = sp;
+				funcs[ i ].entry_cycle = avr->cycle;
+			}
+
+		if( have_loop && avr->pc == loop.addr )
+		{
+			if( loop.active )
+				record( &loop, avr->cycle - loop.entry_cycle );
+			loop.active = 1;
+			loop.entry_cycle = avr->cycle;
+		}
+	} while( avr->cycle < end && state != cpu_Done && state != cpu_Crashed );
+
+	if( state == cpu_Crashed )
+		fprintf( stderr, "firmware crashed at pc 0x%04x, cycle %llu\n",
+			( unsigned ) avr->pc, ( unsigned long long ) avr->cycle );
+
+	if( eeprom )
+		eeprom_io( avr, eeprom, 1 );
+
+	if( out_path && !( out = fopen( out_path, "w" ) ) )
+	{
+		perror( out_path );
+		return 1;
+	}
+
+	fprintf( out, "commit,function,calls,min_cycles,max_cycles,mean_cycles\n" );
+	for( i = 0; i < n_funcs; i++ )
+		print_row( out, commit, &funcs[ i ] );
+	if( have_loop )
+		print_row( out, commit, &loop );
+
+	if( out != stdout )
+		fclose( out );
+
+	return state == cpu_Crashed;
+}
@@ -0,0 +1,278 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	fixedcheck.c													=
+//= Desc:		Fixed-point equivalence check.  Runs the firmware's integer		=
+//=				light_follow() against a floating-point reference of the same	=
+//=				speed law over every pair of 10-bit photoresistor readings,		=
+//=				and reports any difference in state, speeds or accelerations.	=
+//= Functions:	main()															=
+//= Other:		Exits 1 on the first mismatch, so 'make fixedcheck' fails.		=
+//=				The reference works in double and calls nothing from the		=
+//=				firmware: every value in it is exact, so it is the real-number	=
+//=				result, rounded only where the float code converted to an		=
+//=				integer (toward zero) and where normalization shifts (down).	=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+//===============================================================================
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+#define PR_COUNTS_MAX	1024	// Every 10-bit reading.
+#define DELTA_GRID		37		// Reading step for the all-deltas sweep.
+
+//===============================================================================
+//= What:	Typedefs.															=
+//===============================================================================
+// One calibration as the spin scan and the EEPROM record could leave it.
+typedef struct CHECK_CALIB_TYPE {
+	signed short int offset_L, offset_R;		// calib.PR_offset_L/R (counts).
+	unsigned short int gain_L, gain_R;			// calib.PR_gain_L/R (Q8).
+	unsigned short int gain_slow, gain_fast;	// calib.PR_gain_slow/fast.
+	signed short int delta;						// PR_delta_LR (counts).
+} CHECK_CALIB;
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+// Calibration deltas tried with every pair of readings: zero, small and
+// large of both signs, and the 16-bit extremes.
+static const signed short int deltas[] = {
+	0, 1, -1, 7, -7, 100, -100, 600, -600, 32767, -32768
+};
+
+// Calibrations other than the defaults, each tried with every pair of
+// readings: spin scan gains from the widest span (128) to the narrowest
+// (4096), dark offsets up to 900, and retuned speed gains.
+static const CHECK_CALIB calibrations[] = {
+	{ 120,  95,  384,  420,  50, 200,     25 },
+	{ 300, 340, 1024,  910,  50, 200,    -60 },
+	{  40,   0,  128,  140,  50, 200,    600 },
+	{ 900, 870, 4096, 4096,  50, 200,     -7 },
+	{   0, 512,  256, 2048,  80, 160,    100 },
+	{ 200, 180,  700,  650,  30, 300, -32768 },
+	{  65,  70,  300,  290, 120, 250,  32767 }
+};
+
+// Wheel speeds act() last sent, which kin_drive() slews from: stopped,
+// full ahead, spinning, on an arc, and reversing.
+static const signed short int sent[][ 2 ] = {
+	{ 0, 0 },
+	{ KIN_MAX_SPEED, KIN_MAX_SPEED },
+	{ -KIN_MAX_SPEED, KIN_MAX_SPEED },
+	{ 180, 40 },
+	{ -100, -100 }
+};
+
+static unsigned long int cases = 0;
+
+//===============================================================================
+//= What:	reference_normalize()												=
+//= Why:	PR_normalize()'s formula, ( raw - offset ) * gain / 256 clamped		=
+//=			to 0..1023, rounded down as the arithmetic shift does.				=
+//= Return:	double (normalized reading).										=
+//= Params:	unsigned int raw (raw counts)										=
+//=			double offset, double gain (Q8)										=
+//===============================================================================
+static double reference_normalize( unsigned int raw, double offset, double gain )
+{
+	double value = floor( ( raw - offset ) * gain / 256.0 );
+
+	if( value < 0 )
+		return 0;
+	if( value > 1023 )
+		return 1023;
+	return value;
+} // end reference_normalize()
+
+//===============================================================================
+//= What:	reference_drive()													=
+//= Why:	kin_drive()'s formulas, every integer division truncated.			=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (proposal)							=
+//=			double v (steps/sec), double w (deg/sec), double accel				=
+//=			double sent_L, double sent_R (speeds act() last sent)				=
+//===============================================================================
+static void reference_drive( volatile MOTOR_ACTION *pAction, double v, double w, double accel,
+	double sent_L, double sent_R )
+{
+	double turn = trunc( w * DEG_90 / 90 );
+	double left = v - turn;
+	double right = v + turn;
+	double peak = fmax( fabs( left ), fabs( right ) );
+	double change_L, change_R, step, slow;
+
+	if( peak > KIN_MAX_SPEED )
+	{
+		left = trunc( left * KIN_MAX_SPEED / peak );
+		right = trunc( right * KIN_MAX_SPEED / peak );
+	}
+
+	change_L = left - sent_L;
+	change_R = right - sent_R;
+	step = fmax( fabs( change_L ), fabs( change_R ) );
+
+	if( step > KIN_MAX_SLEW )
+	{
+		change_L = trunc( change_L * KIN_MAX_SLEW / step );
+		change_R = trunc( change_R * KIN_MAX_SLEW / step );
+		step = KIN_MAX_SLEW;
+	}
+
+	accel = fmin( fmax( accel, KIN_MIN_ACCEL ), KIN_MAX_ACCEL );
+
+	pAction->speed_L = ( signed short int )( sent_L + change_L );
+	pAction->speed_R = ( signed short int )( sent_R + change_R );
+	pAction->accel_L = ( unsigned short int ) accel;
+	pAction->accel_R = ( unsigned short int ) accel;
+
+	if( step == 0 )
+		return;
+
+	slow = fmax( trunc( accel * fmin( fabs( change_L ), fabs( change_R ) ) / step ), KIN_MIN_ACCEL );
+
+	if( fabs( change_L ) < fabs( change_R ) )
+		pAction->accel_L = ( unsigned short int ) slow;
+	else
+		pAction->accel_R = ( unsigned short int ) slow;
+} // end reference_drive()
+
+//===============================================================================
+//= What:	reference_follow()													=
+//= Why:	light_follow() as the float version wrote it, in double.			=
+//= Return:	void.																=
+//= Params:	volatile MOTOR_ACTION *pAction (proposal, state STARTUP on entry)	=
+//=			unsigned int L, unsigned int R (raw counts)							=
+//=			signed short int delta (calibration left - right)					=
+//=			const signed short int *pSent (speeds act() last sent, L and R)		=
+//= Notes:	The thresholds are the float version's, on the normalized scale		=
+//=			(1/8, 7/4 and 1/4 of PR_NORM_SPAN); the speeds still come from		=
+//=			the raw volts.														=
+//===============================================================================
+static void reference_follow( volatile MOTOR_ACTION *pAction, unsigned int L, unsigned int R,
+	signed short int delta, const signed short int *pSent )
+{
+	double nL = reference_normalize( L, calib.PR_offset_L, calib.PR_gain_L );
+	double nR = reference_normalize( R, calib.PR_offset_R, calib.PR_gain_R );
+	double Lv = L * 5.0 / 1024;
+	double Rv = R * 5.0 / 1024;
+	double average = ( nL + nR ) / 2.0;
+	double diff_LR = nL - nR;
+	double speed_L, speed_R;
+
+	if( !( ( average > PR_NORM_SPAN / 8.0 ) && ( average < PR_NORM_SPAN * 7.0 / 4.0 ) &&
+		( ( diff_LR > PR_NORM_SPAN / 4.0 ) || ( diff_LR < -PR_NORM_SPAN / 4.0 ) ) ) )
+		return;
+
+	pAction->state = LIGHT_FOLLOW;
+
+	if( diff_LR > 0 )
+	{
+		speed_L = trunc( Lv * calib.PR_gain_slow );
+		speed_R = trunc( Rv * calib.PR_gain_fast + delta );
+	}
+	else
+	{
+		speed_L = trunc( Lv * calib.PR_gain_fast - delta );
+		speed_R = trunc( Rv * calib.PR_gain_slow );
+	}
+
+	reference_drive( pAction, trunc( ( speed_L + speed_R ) / 2 ),
+		trunc( ( speed_R - speed_L ) * 90 / ( 2 * DEG_90 ) ), PR_FOLLOW_ACCEL, pSent[ 0 ], pSent[ 1 ] );
+} // end reference_follow()
+
+//===============================================================================
+//= What:	check()																=
+//= Why:	Runs both versions on one input and compares the proposals.			=
+//= Return:	void (exits 1 on a mismatch).										=
+//= Params:	unsigned int L, unsigned int R (raw counts)							=
+//=			signed short int delta (calibration left - right)					=
+//=			const signed short int *pSent (speeds act() last sent, L and R)		=
+//= Notes:	Uses whatever is in 'calib'.										=
+//===============================================================================
+static void check( unsigned int L, unsigned int R, signed short int delta,
+	const signed short int *pSent )
+{
+	volatile SENSOR_DATA sensors = { 0 };
+	volatile MOTOR_ACTION fixed = { 0 }, ref = { 0 };
+
+	sensors.left_PR = L;
+	sensors.right_PR = R;
+	sensors.PR_delta_LR = delta;
+	fixed.state = ref.state = STARTUP;
+
+	kin_command( pSent[ 0 ], pSent[ 1 ] );
+	light_follow( &fixed, &sensors );
+	reference_follow( &ref, L, R, delta, pSent );
+	cases++;
+
+	if( ( fixed.state != ref.state ) ||
+		( ( ref.state != STARTUP ) &&
+		  ( ( fixed.speed_L != ref.speed_L ) || ( fixed.speed_R != ref.speed_R ) ||
+			( fixed.accel_L != ref.accel_L ) || ( fixed.accel_R != ref.accel_R ) ) ) )
+	{
+		printf( "MISMATCH L=%u R=%u delta=%d sent=%d/%d offsets %d/%d gains %u/%u slow/fast %u/%u: "
+			"fixed state %d speeds %d/%d accels %u/%u, "
+			"float state %d speeds %d/%d accels %u/%u\n", L, R, delta, pSent[ 0 ], pSent[ 1 ],
+			calib.PR_offset_L, calib.PR_offset_R, calib.PR_gain_L, calib.PR_gain_R,
+			calib.PR_gain_slow, calib.PR_gain_fast,
+			fixed.state, fixed.speed_L, fixed.speed_R, fixed.accel_L, fixed.accel_R,
+			ref.state, ref.speed_L, ref.speed_R, ref.accel_L, ref.accel_R );
+		exit( 1 );
+	}
+} // end check()
+
+//===============================================================================
+//= What:	main()																=
+//= Why:	Sweeps the input space.												=
+//= Desc:	With the default calibration and nothing sent yet: all 1024 x		=
+//=			1024 reading pairs with each of 'deltas', then all 65536 deltas		=
+//=			on a DELTA_GRID grid of readings.  Then all reading pairs for		=
+//=			each of 'calibrations' with each of the 'sent' speeds.				=
+//= Return:	int (0 if every case matched, 1 otherwise).							=
+//= Params:	none used.															=
+//= Notes:	none.																=
+//===============================================================================
+int main( void )
+{
+	unsigned int L, R, d, c, s;
+	long int delta;
+
+	calib_defaults();
+
+	for( d = 0; d < sizeof( deltas ) / sizeof( deltas[ 0 ] ); d++ )
+		for( L = 0; L < PR_COUNTS_MAX; L++ )
+			for( R = 0; R < PR_COUNTS_MAX; R++ )
+				check( L, R, deltas[ d ], sent[ 0 ] );
+
+	for( L = 0; L < PR_COUNTS_MAX; L += DELTA_GRID )
+		for( R = 0; R < PR_COUNTS_MAX; R += DELTA_GRID )
+			for( delta = -32768; delta <= 32767; delta++ )
+				check( L, R, ( signed short int ) delta, sent[ 0 ] );
+
+	for( c = 0; c < sizeof( calibrations ) / sizeof( calibrations[ 0 ] ); c++ )
+	{
+		calib.PR_offset_L = calibrations[ c ].offset_L;
+		calib.PR_offset_R = calibrations[ c ].offset_R;
+		calib.PR_gain_L = calibrations[ c ].gain_L;
+		calib.PR_gain_R = calibrations[ c ].gain_R;
+		calib.PR_gain_slow = calibrations[ c ].gain_slow;
+		calib.PR_gain_fast = calibrations[ c ].gain_fast;
+
+		for( s = 0; s < sizeof( sent ) / sizeof( sent[ 0 ] ); s++ )
+			for( L = 0; L < PR_COUNTS_MAX; L++ )
+				for( R = 0; R < PR_COUNTS_MAX; R++ )
+					check( L, R, calibrations[ c ].delta, sent[ s ] );
+	}
+
+	printf( "fixedcheck: %lu cases, no mismatch\n", cases );
+	return 0;
+} // end main()
@@ -0,0 +1,540 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	footprint.c														=
+//= Desc:		Flash and RAM footprint report.  Reads the linker map of an		=
+//=				avr-gcc build and charges every input section to the module		=
+//=				it came from (an application source file, the CAPI library,		=
+//=				libc, printf_flt, ...).  With the ELF, also lists the largest	=
+//=				symbols; with a budget file, checks each module against it.		=
+//= Functions:	main()															=
+//= Other:		Flash is .text plus the .data initializers; RAM is .data, .bss	=
+//=				and .noinit.  What RAM is left over is all the stack gets.		=
+//=				Exits 1 when anything is over budget.							=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+//===============================================================================
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+#define MAX_MODULES		64
+#define MAX_SECTIONS	4096
+#define MAX_SYMBOLS		4096
+#define NAME_LEN		48
+#define FLASH_BYTES		32768UL		// ATmega324P.
+#define SRAM_BYTES		2048UL
+#define DATA_BASE		0x800000UL	// Where avr-ld puts SRAM addresses.
+#define WARN_PCT		90			// Flag budgets this full.
+
+//===============================================================================
+//= What:	Type Declarations.													=
+//===============================================================================
+
+// Desc: Output sections that count.
+typedef enum FP_REGION_TYPE {
+	FP_TEXT,
+	FP_DATA,
+	FP_BSS,
+	FP_NOINIT,
+	FP_NONE
+} FP_REGION;
+
+// Desc: One input section from the map.
+typedef struct FP_SECTION_TYPE {
+	unsigned long addr, size;
+	int module;
+} FP_SECTION;
+
+// Desc: What one module (source file or library) takes up.
+typedef struct FP_MODULE_TYPE {
+	char name[ NAME_LEN ];
+	unsigned long bytes[ FP_NONE ];
+	long budget_flash, budget_ram;	// -1: no budget.
+} FP_MODULE;
+
+// Desc: One sized symbol from the ELF.
+typedef struct FP_SYMBOL_TYPE {
+	char name[ NAME_LEN ];
+	unsigned long size;
+	int ram;
+	int module;
+} FP_SYMBOL;
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+static FP_MODULE modules[ MAX_MODULES ];
+static int n_modules = 0;
+
+static FP_SECTION sections[ MAX_SECTIONS ];
+static int n_sections = 0;
+
+static FP_SYMBOL symbols[ MAX_SYMBOLS ];
+static int n_symbols = 0;
+
+//===============================================================================
+//= What:	usage()																=
+//===============================================================================
+static void usage( const char *argv0 )
+{
+	fprintf( stderr,
+		"usage: %s [options] FIRMWARE.map\n"
+		"  -e FILE   the ELF, for the largest symbols\n"
+		"  -n N      how many symbols to list (default 20)\n"
+		"  -b FILE   budgets: 'MODULE FLASH RAM' lines ('-' for none);\n"
+		"            module 'total' is the whole image\n"
+		"  -c        CSV (module,flash,ram,flash_budget,ram_budget)\n", argv0 );
+	exit( 1 );
+}
+
+//===============================================================================
+//= What:	module_of()															=
+//= Why:	Names the module an input file belongs to and returns its index.	=
+//= Desc:	"obj/avr/main.o" is main.c; anything in an archive is the archive	=
+//=			("libcapi324v22x.a"); the C runtime startup and linker-made			=
+//=			sections get names of their own.									=
+//===============================================================================
+static int module_of( const char *file )
+{
+	char name[ NAME_LEN ];
+	const char *base = file, *p, *paren;
+	size_t len;
+	int i;
+
+	// Base name, before any "(member.o)"; Windows maps use '\' as well,
+	// and may have parentheses in the path.
+	len = strlen( file );
+	paren = ( len > 0 && file[ len - 1 ] == ')' ) ? strrchr( file, '(' ) : NULL;
+	for( p = file; *p && p != paren; p++ )
+		if( *p == '/' || *p == '\\' )
+			base = p + 1;
+	len = ( paren ? ( size_t )( paren - base ) : strlen( base ) );
+	if( len >= NAME_LEN )
+		len = NAME_LEN - 1;
+	memcpy( name, base, len );
+	name[ len ] = '\0';
+
+	if( strcmp( file, "*fill*" ) == 0 )
+		snprintf( name, sizeof( name ), "(alignment)" );
+	else if( strcmp( file, "linker stubs" ) == 0 )
+		snprintf( name, sizeof( name ), "(linker stubs)" );
+	else if( strncmp( name, "crt", 3 ) == 0 )
+		snprintf( name, sizeof( name ), "(C startup)" );
+	else if( len > 2 && strcmp( name + len - 2, ".o" ) == 0 )
+		name[ len - 1 ] = 'c';
+
+	for( i = 0; i < n_modules; i++ )
+		if( strcmp( modules[ i ].name, name ) == 0 )
+			return i;
+
+	if( n_modules == MAX_MODULES )
+	{
+		fprintf( stderr, "more than %d modules\n", MAX_MODULES );
+		exit( 1 );
+	}
+
+	snprintf( modules[ n_modules ].name, NAME_LEN, "%s", name );
+	modules[ n_modules ].budget_flash = -1;
+	modules[ n_modules ].budget_ram = -1;
+	return n_modules++;
+}
+
+//===============================================================================
+//= What:	region_of()															=
+//= Return:	FP_REGION (which total an output section counts toward).			=
+//===============================================================================
+static FP_REGION region_of( const char *section )
+{
+	if( strcmp( section, ".text" ) == 0 )
+		return FP_TEXT;
+	if( strcmp( section, ".data" ) == 0 )
+		return FP_DATA;
+	if( strcmp( section, ".bss" ) == 0 )
+		return FP_BSS;
+	if( strcmp( section, ".noinit" ) == 0 )
+		return FP_NOINIT;
+	return FP_NONE;
+}
+
+//===============================================================================
+//= What:	load_map()															=
+//= Why:	Charges every input section of the counted output sections.			=
+//= Notes:	An input section line is " NAME ADDR SIZE FILE"; a long NAME is		=
+//=			alone on its line and the rest follows on the next.  Output			=
+//=			section lines start in column 0; symbol lines have no size.			=
+//===============================================================================
+static void load_map( const char *path )
+{
+	FILE *f = fopen( path, "r" );
+	char line[ 512 ], name[ 256 ] = "", file[ 256 ];
+	unsigned long addr, size;
+	FP_REGION region = FP_NONE;
+	int in_layout = 0, pos, m;
+
+	if( !f )
+	{
+		perror( path );
+		exit( 1 );
+	}
+
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		line[ strcspn( line, "\r\n" ) ] = '\0';
+
+		if( !in_layout )
+		{
+			in_layout = ( strcmp( line, "Linker script and memory map" ) == 0 );
+			continue;
+		}
+
+		// Output section: ".bss  0x008001f8  0x12a".
+		if( line[ 0 ] == '.' )
+		{
+			sscanf( line, "%255s", name );
+			region = region_of( name );
+			name[ 0 ] = '\0';
+			continue;
+		}
+		if( region == FP_NONE || line[ 0 ] != ' ' )
+			continue;
+
+		// " .text.act" alone: the numbers are on the next line.
+		if( line[ 1 ] != ' ' && sscanf( line, " %255s%n", name, &pos ) == 1 && line[ pos ] == '\0' )
+			continue;
+
+		if( line[ 1 ] != ' ' )
+		{
+			if( sscanf( line, " %255s 0x%lx 0x%lx %n", name, &addr, &size, &pos ) != 3 )
+				continue;
+		}
+		else if( name[ 0 ] == '\0' || sscanf( line, " 0x%lx 0x%lx %n", &addr, &size, &pos ) != 2 )
+		{
+			// A symbol line, or an assignment.
+			name[ 0 ] = '\0';
+			continue;
+		}
+
+		snprintf( file, sizeof( file ), "%s", line + pos );
+		if( strcmp( name, "*fill*" ) == 0 )
+			snprintf( file, sizeof( file ), "*fill*" );
+		name[ 0 ] = '\0';
+
+		if( size == 0 || file[ 0 ] == '\0' )
+			continue;
+
+		m = module_of( file );
+		modules[ m ].bytes[ region ] += size;
+
+		if( n_sections < MAX_SECTIONS )
+		{
+			sections[ n_sections ].addr = addr;
+			sections[ n_sections ].size = size;
+			sections[ n_sections ].module = m;
+			n_sections++;
+		}
+	}
+
+	fclose( f );
+
+	if( !in_layout )
+	{
+		fprintf( stderr, "%s: not a GNU ld map\n", path );
+		exit( 1 );
+	}
+}
+
+//===============================================================================
+//= What:	module_at()															=
+//= Return:	int (module of the input section holding 'addr', or -1).			=
+//===============================================================================
+static int module_at( unsigned long addr )
+{
+	int i;
+
+	for( i = 0; i < n_sections; i++ )
+		if( addr >= sections[ i ].addr && addr < sections[ i ].addr + sections[ i ].size )
+			return sections[ i ].module;
+	return -1;
+}
+
+//===============================================================================
+//= What:	load_elf()															=
+//= Why:	Reads the sized function and object symbols of a 32-bit ELF.		=
+//===============================================================================
+static void load_elf( const char *path )
+{
+	FILE *f = fopen( path, "rb" );
+	Elf32_Ehdr eh;
+	Elf32_Shdr *sh = NULL;
+	Elf32_Sym sym;
+	char *strtab = NULL;
+	unsigned long i, count;
+	int s, type;
+
+	if( !f )
+	{
+		perror( path );
+		exit( 1 );
+	}
+
+	if( fread( &eh, sizeof( eh ), 1, f ) != 1 || memcmp( eh.e_ident, ELFMAG, SELFMAG ) != 0 ||
+		eh.e_ident[ EI_CLASS ] != ELFCLASS32 || eh.e_shentsize != sizeof( Elf32_Shdr ) )
+		goto bad;
+
+	sh = calloc( eh.e_shnum, sizeof( *sh ) );
+	if( !sh || fseek( f, eh.e_shoff, SEEK_SET ) ||
+		fread( sh, sizeof( *sh ), eh.e_shnum, f ) != eh.e_shnum )
+		goto bad;
+
+	for( s = 0; s < eh.e_shnum; s++ )
+	{
+		if( sh[ s ].sh_type != SHT_SYMTAB || sh[ s ].sh_link >= eh.e_shnum )
+			continue;
+
+		free( strtab );
+		strtab = malloc( sh[ sh[ s ].sh_link ].sh_size + 1 );
+		if( !strtab || fseek( f, sh[ sh[ s ].sh_link ].sh_offset, SEEK_SET ) ||
+			fread( strtab, 1, sh[ sh[ s ].sh_link ].sh_size, f ) != sh[ sh[ s ].sh_link ].sh_size )
+			goto bad;
+		strtab[ sh[ sh[ s ].sh_link ].sh_size ] = '\0';
+
+		count = sh[ s ].sh_size / sizeof( sym );
+		for( i = 0; i < count && n_symbols < MAX_SYMBOLS; i++ )
+		{
+			if( fseek( f, sh[ s ].sh_offset + i * sizeof( sym ), SEEK_SET ) ||
+				fread( &sym, sizeof( sym ), 1, f ) != 1 )
+				goto bad;
+
+			type = ELF32_ST_TYPE( sym.st_info );
+			if( ( type != STT_FUNC && type != STT_OBJECT ) || sym.st_size == 0 ||
+				sym.st_name >= sh[ sh[ s ].sh_link ].sh_size )
+				continue;
+
+			snprintf( symbols[ n_symbols ].name, NAME_LEN, "%s", strtab + sym.st_name );
+			symbols[ n_symbols ].size = sym.st_size;
+			symbols[ n_symbols ].ram = ( sym.st_value >= DATA_BASE );
+			symbols[ n_symbols ].module = module_at( sym.st_value );
+			n_symbols++;
+		}
+	}
+
+	free( strtab );
+	free( sh );
+	fclose( f );
+	return;
+
+bad:
+	fprintf( stderr, "%s: not a readable 32-bit ELF\n", path );
+	exit( 1 );
+}
+
+//===============================================================================
+//= What:	load_budgets()														=
+//= Why:	Sets each listed module's budgets, and the budget of module			=
+//=			'total' in *pFlash and *pRam (-1 for none).							=
+//===============================================================================
+static void load_budgets( const char *path, long *pFlash, long *pRam )
+{
+	FILE *f = fopen( path, "r" );
+	char line[ 256 ], name[ NAME_LEN ], flash[ 16 ], ram[ 16 ];
+	int i, n = 0;
+
+	if( !f )
+	{
+		perror( path );
+		exit( 1 );
+	}
+
+	while( fgets( line, sizeof( line ), f ) )
+	{
+		n++;
+		if( line[ 0 ] == '#' || line[ strspn( line, " \t\r\n" ) ] == '\0' )
+			continue;
+		if( sscanf( line, "%47s %15s %15s", name, flash, ram ) != 3 )
+		{
+			fprintf( stderr, "%s:%d: expected 'MODULE FLASH RAM'\n", path, n );
+			exit( 1 );
+		}
+
+		if( strcmp( name, "total" ) == 0 )
+		{
+			*pFlash = ( flash[ 0 ] == '-' ) ? -1 : strtol( flash, NULL, 0 );
+			*pRam = ( ram[ 0 ] == '-' ) ? -1 : strtol( ram, NULL, 0 );
+			continue;
+		}
+
+		// Budgeted modules are listed even when they take nothing.
+		for( i = 0; i < n_modules; i++ )
+			if( strcmp( modules[ i ].name, name ) == 0 )
+				break;
+		if( i == n_modules )
+		{
+			if( n_modules == MAX_MODULES )
+				continue;
+			snprintf( modules[ n_modules++ ].name, NAME_LEN, "%s", name );
+		}
+		modules[ i ].budget_flash = ( flash[ 0 ] == '-' ) ? -1 : strtol( flash, NULL, 0 );
+		modules[ i ].budget_ram = ( ram[ 0 ] == '-' ) ? -1 : strtol( ram, NULL, 0 );
+	}
+
+	fclose( f );
+}
+
+//===============================================================================
+//= What:	flash_of(), ram_of()												=
+//===============================================================================
+static unsigned long flash_of( const FP_MODULE *pModule )
+{
+	return pModule->bytes[ FP_TEXT ] + pModule->bytes[ FP_DATA ];
+}
+
+static unsigned long ram_of( const FP_MODULE *pModule )
+{
+	return pModule->bytes[ FP_DATA ] + pModule->bytes[ FP_BSS ] + pModule->bytes[ FP_NOINIT ];
+}
+
+//===============================================================================
+//= What:	check()																=
+//= Why:	Formats 'used' against 'budget' and counts overruns.				=
+//= Return:	const char * (a static buffer: "1234/2048 60%", with a '!' when		=
+//=			over budget and a '~' when over WARN_PCT of it).					=
+//===============================================================================
+static const char *check( unsigned long used, long budget, int *pOver, int slot )
+{
+	static char text[ 2 ][ 32 ];
+	unsigned long pct;
+
+	if( budget < 0 )
+		return "";
+
+	pct = budget ? ( used * 100 ) / budget : ( used ? 999 : 0 );
+	if( used > ( unsigned long ) budget )
+		( *pOver )++;
+
+	snprintf( text[ slot ], sizeof( text[ slot ] ), "%5ld %3lu%%%s", budget, pct,
+		( used > ( unsigned long ) budget ) ? " !" : ( pct >= WARN_PCT ) ? " ~" : "" );
+	return text[ slot ];
+}
+
+//===============================================================================
+//= What:	by_footprint(), by_size()											=
+//= Why:	qsort() orders: biggest first.										=
+//===============================================================================
+static int by_footprint( const void *a, const void *b )
+{
+	unsigned long fa = flash_of( a ) + ram_of( a ), fb = flash_of( b ) + ram_of( b );
+
+	return ( fa < fb ) - ( fa > fb );
+}
+
+static int by_size( const void *a, const void *b )
+{
+	unsigned long sa = ( ( const FP_SYMBOL * ) a )->size, sb = ( ( const FP_SYMBOL * ) b )->size;
+
+	return ( sa < sb ) - ( sa > sb );
+}
+
+//===============================================================================
+//= What:	main()																=
+//= Why:	Parses options, reads the map (and ELF and budgets), and reports.	=
+//===============================================================================
+int main( int argc, char *argv[] )
+{
+	const char *elf = NULL, *budgets = NULL;
+	unsigned long flash = 0, ram = 0;
+	long total_flash = -1, total_ram = -1;
+	int csv = 0, top = 20, over = 0, opt, i;
+
+	while( ( opt = getopt( argc, argv, "e:n:b:ch" ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 'e': elf = optarg; break;
+			case 'n': top = atoi( optarg ); break;
+			case 'b': budgets = optarg; break;
+			case 'c': csv = 1; break;
+			default: usage( argv[ 0 ] );
+		}
+	}
+	if( optind != argc - 1 )
+		usage( argv[ 0 ] );
+
+	load_map( argv[ optind ] );
+	if( budgets )
+		load_budgets( budgets, &total_flash, &total_ram );
+	if( elf )
+		load_elf( elf );
+
+	for( i = 0; i < n_modules; i++ )
+	{
+		flash += flash_of( &modules[ i ] );
+		ram += ram_of( &modules[ i ] );
+	}
+
+	qsort( symbols, n_symbols, sizeof( symbols[ 0 ] ), by_size );
+
+	if( csv )
+	{
+		printf( "module,flash,ram,flash_budget,ram_budget\n" );
+		for( i = 0; i < n_modules; i++ )
+			printf( "%s,%lu,%lu,%ld,%ld\n", modules[ i ].name, flash_of( &modules[ i ] ),
+				ram_of( &modules[ i ] ), modules[ i ].budget_flash, modules[ i ].budget_ram );
+		printf( "total,%lu,%lu,%ld,%ld\n", flash, ram, total_flash, total_ram );
+		for( i = 0; i < n_modules; i++ )
+		{
+			check( flash_of( &modules[ i ] ), modules[ i ].budget_flash, &over, 0 );
+			check( ram_of( &modules[ i ] ), modules[ i ].budget_ram, &over, 1 );
+		}
+		check( flash, total_flash, &over, 0 );
+		check( ram, total_ram, &over, 1 );
+		return over ? 1 : 0;
+	}
+
+	// Symbols keep their module index, so the table is sorted as a copy.
+	{
+		FP_MODULE sorted[ MAX_MODULES ];
+
+		memcpy( sorted, modules, sizeof( sorted ) );
+		qsort( sorted, n_modules, sizeof( sorted[ 0 ] ), by_footprint );
+
+		printf( "%-20s %6s %6s %6s %6s %6s  %-13s %s\n", "module", "text", "data", "bss",
+			"flash", "ram", "flash budget", "ram budget" );
+		for( i = 0; i < n_modules; i++ )
+		{
+			printf( "%-20s %6lu %6lu %6lu %6lu %6lu  %-13s ", sorted[ i ].name, sorted[ i ].bytes[ FP_TEXT ],
+				sorted[ i ].bytes[ FP_DATA ], sorted[ i ].bytes[ FP_BSS ] + sorted[ i ].bytes[ FP_NOINIT ],
+				flash_of( &sorted[ i ] ), ram_of( &sorted[ i ] ),
+				check( flash_of( &sorted[ i ] ), sorted[ i ].budget_flash, &over, 0 ) );
+			printf( "%s\n", check( ram_of( &sorted[ i ] ), sorted[ i ].budget_ram, &over, 1 ) );
+		}
+	}
+
+	printf( "\nflash: %6lu of %lu (%lu%%)  %s\n", flash, FLASH_BYTES, ( flash * 100 ) / FLASH_BYTES,
+		check( flash, total_flash, &over, 0 ) );
+	printf( "ram:   %6lu of %lu (%lu%%)  %s\n", ram, SRAM_BYTES, ( ram * 100 ) / SRAM_BYTES,
+		check( ram, total_ram, &over, 1 ) );
+	printf( "left for the stack: %ld bytes\n", ( long ) SRAM_BYTES - ( long ) ram );
+
+	if( n_symbols > 0 && top > 0 )
+	{
+		printf( "\n%-32s %6s %-5s %s\n", "symbol", "bytes", "where", "module" );
+		for( i = 0; i < n_symbols && i < top; i++ )
+			printf( "%-32s %6lu %-5s %s\n", symbols[ i ].name, symbols[ i ].size,
+				symbols[ i ].ram ? "ram" : "flash",
+				symbols[ i ].module >= 0 ? modules[ symbols[ i ].module ].name : "?" );
+	}
+
+	if( over )
+		printf( "\n%d budget%s exceeded\n", over, over == 1 ? "" : "s" );
+
+	return over ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	avr/eeprom.h (host stand-in)									=
+//= Desc:		Host replacement for the avr-libc EEPROM block functions.		=
+//=				The EEPROM itself is modelled in capi_host.c.					=
+//= Functions:	none (see capi_host.c).											=
+//= Other:		Addresses are EEPROM offsets passed as pointers, as on the AVR.	=
+//===============================================================================
+#ifndef __AVR_EEPROM_H__
+#define __AVR_EEPROM_H__
+
+#include <stddef.h>
+
+#define E2END	0x3FF		// Last EEPROM address (1KB on the ATmega324P).
+
+extern void eeprom_read_block( void *dst, const void *src, size_t n );
+extern void eeprom_update_block( const void *src, void *dst, size_t n );
+
+#endif // __AVR_EEPROM_H__
@@ -0,0 +1,429 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	capi324v221.h (host stand-in)									=
+//= Desc:		Host replacement for the CEENBoT-API header.  Declares only		=
+//=				the subset of the CAPI the lab sources use, with the same		=
+//=				names, types and macro shapes, so the firmware .c files			=
+//=				compile unchanged against the simulator in sim/.				=
+//= Functions:	none (see capi_host.c).											=
+//= Other:		int is 32 bits here but 16 bits on the ATmega324.				=
+//===============================================================================
+#ifndef __CAPI324V221_H__
+#define __CAPI324V221_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+//===============================================================================
+//= What:	utils324v221.h / sys324v221.h										=
+//===============================================================================
+typedef enum BOOL_TYPE { FALSE = 0, TRUE = 1 } BOOL;
+
+typedef enum SUBSYS_STATUS_TYPE
+{
+	SUBSYS_CLOSED = 0,
+	SUBSYS_OPEN,
+	SUBSYS_ALREADY_OPEN,
+	SUBSYS_IN_USE,
+	SUBSYS_NOT_AVAILABLE,
+	SUBSYS_ERROR,
+	SUBSYS_INIT_FAILED,
+	SUBSYS_DEPENDENCY_ERROR,
+	SUBSYS_DEPENDENCY_CONFLICT
+} SUBSYS_STATUS;
+
+// Busy-wait delays burn virtual time instead of real time.
+extern void SIM_delay_us( unsigned long int us );
+#define DELAY_ms( t )	SIM_delay_us( ( unsigned long int )( t ) * 1000UL )
+#define DELAY_us( t )	SIM_delay_us( ( unsigned long int )( t ) )
+
+//===============================================================================
+//= What:	avr/pgmspace.h (flash lives in the same address space here)		=
+//===============================================================================
+#define PROGMEM
+#define PGM_P					const char *
+#define PSTR( s )				( s )
+#define pgm_read_byte( addr )	( *( const unsigned char * )( addr ) )
+#define pgm_read_word( addr )	( *( addr ) )
+#define memcpy_P				memcpy
+
+//===============================================================================
+//= What:	Painted-stack area (stack.c).  The host stack is not the AVR's, so	=
+//=			stack_paint() paints a stand-in block the size of the 324P's SRAM	=
+//=			and stack_sense() always finds all of it unused.					=
+//===============================================================================
+#define SIM_SRAM_BYTES		2048
+extern unsigned char SIM_sram[ SIM_SRAM_BYTES ];
+
+#define STACK_SRAM_FREE		( SIM_sram )
+#define STACK_SRAM_END		( SIM_sram + SIM_SRAM_BYTES - 1 )
+#define STACK_HEAP_END		( ( unsigned char * ) NULL )
+#define STACK_PAINT_ATTR
+
+extern void stack_paint( void );	// stack.c; SIM_reset() calls it.
+
+//===============================================================================
+//= What:	avr/io.h (only the ADC, USART0, port A and pin-change registers;	=
+//=			capi_host.c emulates them)											=
+//===============================================================================
+#define _BV( bit )		( 1 << ( bit ) )
+
+extern volatile unsigned char ADMUX;
+extern volatile unsigned char ADCSRA;
+extern volatile unsigned short int ADCW;
+
+// ADMUX bits.
+#define REFS1	7
+#define REFS0	6
+#define ADLAR	5
+
+// ADCSRA bits.
+#define ADEN	7
+#define ADSC	6
+#define ADATE	5
+#define ADIF	4
+#define ADIE	3
+
+// USART0.  UDR0 is wider than the real register so the emulation can tell
+// whether the ISR wrote it (see uart_tick()).
+extern volatile unsigned char UCSR0B;
+extern volatile unsigned short int UDR0;
+
+// UCSR0B bits.
+#define RXCIE0	7
+#define TXCIE0	6
+#define UDRIE0	5
+#define RXEN0	4
+#define TXEN0	3
+
+// Port A (the ultrasonic sensor is on PA3), its digital input disable
+// register, and pin-change interrupt group 0 (PCINT0..7 = PA0..7).
+extern volatile unsigned char PORTA;
+extern volatile unsigned char DDRA;
+extern volatile unsigned char PINA;
+extern volatile unsigned char DIDR0;
+extern volatile unsigned char PCICR;
+extern volatile unsigned char PCIFR;
+extern volatile unsigned char PCMSK0;
+
+#define PA3		3
+#define PCINT3	3
+#define PCIE0	0
+#define PCIF0	0
+
+//===============================================================================
+//= What:	tmrsrvc324v221.h													=
+//===============================================================================
+#define TMRFLG_FLAGNOTIFY   0x01
+#define TMRFLG_FUNCNOTIFY   0x02
+#define TMRFLG_NOTIFY_FUNC  TMRFLG_FUNCNOTIFY
+#define TMRFLG_NOTIFY_FLAG  TMRFLG_FLAGNOTIFY
+#define TMRFLG_RESTART      0x04
+#define TMRFLG_ENABLED      0x08
+
+typedef signed char TIMER8;
+typedef signed int  TIMER16;
+typedef signed long TIMER32;
+typedef signed char TMR_FLGS;
+typedef volatile signed char TIMERFLG;
+
+#define TMRTCM_RUNONCE  TMR_TCM_RUNONCE
+#define TMRTCM_RESTART  TMR_TCM_RESTART
+typedef enum TMR_TCMODE_TYPE
+	{ TMR_TCM_RUNONCE = 0, TMR_TCM_RESTART } TMR_TCMODE;
+typedef enum TMRNEW_RESULT_TYPE
+	{ TMRNEW_OK, TMRNEW_ERROR, TMRNEW_OUTOFMEMORY } TMRNEW_RESULT;
+
+typedef void ( *TMR_NOTIFY_FUNC_PTR )( void );
+
+typedef struct TMROBJ16_TYPE
+{
+	unsigned char reserved;
+	TMR_FLGS         flags;
+	TIMER16          timeReq;
+	TIMER16          ticks;
+	TIMERFLG         tc;
+	TMR_NOTIFY_FUNC_PTR pNotifyFunc;
+} TIMEROBJ;
+
+// Polling an alarm is where the firmware spends its idle loop, so it is
+// also where the simulator charges loop time and fast-forwards.
+extern int SIM_timer_poll( volatile TIMEROBJ *pTimer );
+#define TIMER_ALARM( tobj )		SIM_timer_poll( &( tobj ) )
+#define TIMER_SNOOZE( tobj )	( ( tobj ).tc = 0 )
+#define TMR_SECS( t )			( ( TIMER16 ) ( ( t ) * 1000 ) )
+#define TIMER_SECS				TMR_SECS
+#define TMRSRVC_delay_ms( delay_ms )	TMRSRVC_delay( delay_ms )
+#define TMRSRVC_delay_sec( delay_sec )	TMRSRVC_delay( TMR_SECS( delay_sec ) )
+#define TMRSRVC_REGISTER_EVENT( timer_obj, timer_event ) \
+	{ ( timer_obj ).pNotifyFunc = timer_event; }
+
+extern TMRNEW_RESULT TMRSRVC_new( TIMEROBJ *pTimerObject, TMR_FLGS validNotifyFlags,
+	TMR_TCMODE tcMode, TIMER16 nTicks );
+extern void TMRSRVC_stop_timer( TIMEROBJ *pWhich );
+extern TMRNEW_RESULT TMRSRVC_delay( TIMER16 delay_ms );
+
+//===============================================================================
+//= What:	led324v221.h														=
+//===============================================================================
+#define LED0         5
+#define LED1         6
+#define LED_Red      LED0
+#define LED_Green    LED1
+#define LED_RED      LED0
+#define LED_GREEN    LED1
+#define LED_set( which )        LED_set_pattern( ( 1 << ( which ) ) )
+#define LED_clr( which )        LED_clr_pattern( ( 1 << ( which ) ) )
+#define LED_toggle( which )     LED_tog_pattern( ( 1 << ( which ) ) )
+
+extern SUBSYS_STATUS LED_open( void );
+extern void LED_set_pattern( unsigned char LED_pattern );
+extern void LED_clr_pattern( unsigned char LED_pattern );
+extern void LED_tog_pattern( unsigned char LED_pattern );
+
+//===============================================================================
+//= What:	lcd324v221.h														=
+//===============================================================================
+#define LCD_nCOLS           21
+#define LCD_nPAGES          4
+
+extern int SIM_LCD_printf( const char *fmt, ... );
+#define LCD_printf	SIM_LCD_printf
+#define LCD_printf_RC( r, c, ... ) \
+	do{ LCD_set_RC( r, c ); LCD_printf( __VA_ARGS__ ); }while(0)
+
+extern SUBSYS_STATUS LCD_open( void );
+extern void LCD_clear( void );
+extern void LCD_putchar( char c );
+extern void LCD_set_RC( unsigned char row, unsigned char col );
+
+//===============================================================================
+//= What:	tiny324v221.h														=
+//===============================================================================
+#define SNSR_IR_RIGHT   0x01
+#define SNSR_IR_LEFT    0x02
+#define SNSR_SW5        0x04
+#define SNSR_SW4        0x08
+#define SNSR_SW3        0x10
+#define SNSR_SW5_EDGE   0x20
+#define SNSR_SW4_EDGE   0x40
+#define SNSR_SW3_EDGE   0x80
+
+typedef enum ATTINY_SW_TYPE {
+	ATTINY_SW3 = 0,
+	ATTINY_SW4,
+	ATTINY_SW5
+} ATTINY_SW;
+
+typedef enum ATTINY_IR_TYPE {
+	ATTINY_IR_LEFT = 0,
+	ATTINY_IR_RIGHT,
+	ATTINY_IR_EITHER,
+	ATTINY_IR_BOTH
+} ATTINY_IR;
+
+typedef enum RCSERVO_ID_TYPE {
+	RC_SERVO0 = 0,
+	RC_SERVO1,
+	RC_SERVO2,
+	RC_SERVO3,
+	RC_SERVO4
+} RCSERVO_ID;
+
+extern unsigned char ATTINY_get_sensors( void );
+extern BOOL ATTINY_get_SW_state( ATTINY_SW which );
+extern BOOL ATTINY_get_IR_state( ATTINY_IR which );
+extern void ATTINY_set_RC_servos( unsigned int RCS0_pos, unsigned int RCS1_pos,
+	unsigned int RCS2_pos, unsigned int RCS3_pos, unsigned int RCS4_pos );
+extern void ATTINY_set_RC_servo( RCSERVO_ID which, unsigned int RCS_pos );
+
+//===============================================================================
+//= What:	step324v221.h														=
+//===============================================================================
+#define STEPS_PER_RVLTN     200
+
+typedef void ( *STEPPER_EVENT_PTR )( void );
+
+typedef enum STEPPER_DIR_TYPE { STEPPER_FWD, STEPPER_REV } STEPPER_DIR;
+typedef enum STEPPER_BRKMODE_TYPE { STEPPER_BRK_OFF, STEPPER_BRK_ON } STEPPER_BRKMODE;
+typedef enum STEPPER_ID_TYPE { STEPPER_LEFT = 0, STEPPER_RIGHT, STEPPER_BOTH } STEPPER_ID;
+typedef enum STEPPER_RUNMODE {
+	STEPPER_STEP_BLOCK = 0,
+	STEPPER_STEP_NO_BLOCK,
+	STEPPER_FREERUNNING
+} STEPPER_RUNMODE;
+
+typedef struct STEPPER_SPEED_TYPE {
+	signed short int left;
+	signed short int right;
+} STEPPER_SPEED;
+
+typedef struct STEPPER_STEPS_TYPE {
+	unsigned short int left;
+	unsigned short int right;
+} STEPPER_STEPS;
+
+#define STEPPER_move_rn( which, dir_L, speed_L, accel_L,    \
+                                dir_R, speed_R, accel_R   ) \
+	STEPPER_move( STEPPER_FREERUNNING, which,               \
+		dir_L, 0, speed_L, accel_L, STEPPER_BRK_OFF, NULL,  \
+		dir_R, 0, speed_R, accel_R, STEPPER_BRK_OFF, NULL )
+#define STEPPER_move_stnb( which, dir_L, steps_L, speed_L, accel_L, brkmode_L, \
+                                  dir_R, steps_R, speed_R, accel_R, brkmode_R )\
+	STEPPER_move( STEPPER_STEP_NO_BLOCK, which,                 \
+		dir_L, steps_L, speed_L, accel_L, brkmode_L, NULL,      \
+		dir_R, steps_R, speed_R, accel_R, brkmode_R, NULL )
+#define STEPPER_move_stwt( which, dir_L, steps_L, speed_L, accel_L, brkmode_L, \
+                                  dir_R, steps_R, speed_R, accel_R, brkmode_R )\
+	STEPPER_move( STEPPER_STEP_BLOCK, which,                    \
+		dir_L, steps_L, speed_L, accel_L, brkmode_L, NULL,      \
+		dir_R, steps_R, speed_R, accel_R, brkmode_R, NULL )
+#define STEPPER_get_curr_steps  STEPPER_get_nSteps
+
+extern SUBSYS_STATUS STEPPER_open( void );
+extern void STEPPER_set_accel2( unsigned short int accel_L,
+	unsigned short int accel_R );
+extern STEPPER_SPEED STEPPER_get_curr_speed( void );
+extern STEPPER_STEPS STEPPER_get_nSteps( void );
+extern void STEPPER_stop( STEPPER_ID which, STEPPER_BRKMODE brakeMode );
+extern void STEPPER_runn( signed short int nStepsPerSec_L,
+	signed short int nStepsPerSec_R );
+extern void STEPPER_move( STEPPER_RUNMODE run_mode, STEPPER_ID which,
+	STEPPER_DIR dir_L, unsigned short int steps_L, unsigned short int speed_L,
+	unsigned short int accel_L, STEPPER_BRKMODE brkmode_L, STEPPER_EVENT_PTR step_event_L,
+	STEPPER_DIR dir_R, unsigned short int steps_R, unsigned short int speed_R,
+	unsigned short int accel_R, STEPPER_BRKMODE brkmode_R, STEPPER_EVENT_PTR step_event_R );
+
+//===============================================================================
+//= What:	adc324v221.h														=
+//===============================================================================
+typedef enum ADC_CHAN_TYPE {
+	ADC_CHAN0 = 0,
+	ADC_CHAN1,
+	ADC_CHAN2,
+	ADC_CHAN3,
+	ADC_CHAN4,
+	ADC_CHAN5,
+	ADC_CHAN6,
+	ADC_CHAN7,
+	ADC_CHAN_VBG = 30,
+	ADC_CHAN_GND = 31
+} ADC_CHAN;
+
+typedef enum ADC_VREF_TYPE {
+	ADC_VREF_AREF = 0,
+	ADC_VREF_AVCC,
+	ADC_VREF_1P1V,
+	ADC_VREF_2P56V
+} ADC_VREF;
+
+typedef unsigned short int ADC_SAMPLE;
+
+extern SUBSYS_STATUS ADC_open( void );
+extern void ADC_set_channel( ADC_CHAN which );
+extern void ADC_set_VREF( ADC_VREF which );
+extern ADC_SAMPLE ADC_sample( void );
+
+//===============================================================================
+//= What:	swatch324v221.h														=
+//===============================================================================
+typedef unsigned short int SWTIME;
+
+extern SUBSYS_STATUS STOPWATCH_open( void );
+extern void STOPWATCH_start( void );
+extern SWTIME STOPWATCH_stop( void );
+extern SWTIME STOPWATCH_reset( void );
+extern void STOPWATCH_set( SWTIME value );
+extern SWTIME STOPWATCH_get_ticks( void );
+
+//===============================================================================
+//= What:	uart324v221.h														=
+//===============================================================================
+#define UART0_printf( ... )     UART_printf( UART_UART0,   __VA_ARGS__  )
+#define UART0_transmit( ... )   UART_transmit( UART_UART0, __VA_ARGS__ )
+#define UART0_receive( ... )    UART_receive( UART_UART0,  __VA_ARGS__  )
+#define UART0_has_data()        UART_has_data( UART_UART0 )
+#define UART0_printf_PGM( ... ) UART_printf_PGM( UART_UART0, __VA_ARGS__ )
+
+typedef enum UART_ID_TYPE { UART_UART0, UART_UART1 } UART_ID;
+typedef enum UART_STATE_TYPE { UART_DISABLE, UART_ENABLE } UART_STATE;
+typedef unsigned long int UART_BAUD;
+typedef enum UART_DBITS_TYPE {
+	UART_5DBITS = 0,
+	UART_6DBITS,
+	UART_7DBITS,
+	UART_8DBITS
+} UART_DBITS;
+typedef enum UART_SBITS_TYPE { UART_1SBIT = 0, UART_2SBITS } UART_SBITS;
+typedef enum UART_PARITY_TYPE {
+	UART_NO_PARITY = 0,
+	UART_EVEN_PARITY = 2,
+	UART_ODD_PARITY  = 3
+} UART_PARITY;
+typedef enum UART_COMM_RESULT_TYPE {
+	UART_COMM_OK,
+	UART_COMM_ERROR,
+	UART_COMM_TX_FULL,
+	UART_COMM_TIMEOUT
+} UART_COMM_RESULT;
+
+extern SUBSYS_STATUS UART_open( UART_ID which );
+extern void UART_set_TX_state( UART_ID which, UART_STATE uart_state );
+extern void UART_set_RX_state( UART_ID which, UART_STATE uart_state );
+extern void UART_configure( UART_ID which, UART_DBITS data_bits,
+	UART_SBITS stop_bits, UART_PARITY parity, UART_BAUD baud_rate );
+extern UART_COMM_RESULT UART_transmit( UART_ID which, unsigned char data );
+extern UART_COMM_RESULT UART_receive( UART_ID which, unsigned char *pDest );
+extern BOOL UART_has_data( UART_ID which );
+extern void UART_printf( UART_ID which, const char *str_fmt, ... );
+extern void UART_printf_PGM( UART_ID which, const char *str_fmt, ... );
+
+//===============================================================================
+//= What:	spi324v221.h / spiflash324v221.h (capi_host.c models the flash)		=
+//===============================================================================
+#define SPI_NULL_DATA	0x00
+
+typedef enum SPI_SSADDR_TYPE {
+	SPI_DEV_ADDR0 = 0, SPI_DEV_ADDR1, SPI_DEV_ADDR2, SPI_DEV_ADDR3,
+	SPI_DEV_ADDR4, SPI_DEV_ADDR5, SPI_DEV_ADDR6, SPI_DEV_ADDR7
+} SPI_SSADDR;
+
+#define SPI_ADDR_SPIFLASH	SPI_DEV_ADDR6
+#define SPI_ADDR_NA			SPI_DEV_ADDR7
+
+extern void SPI_set_slave_addr( SPI_SSADDR slaveSelectAddr );
+extern void SPI_transmit( SPI_SSADDR slaveSelectAddr, unsigned char data );
+extern unsigned char SPI_receive( SPI_SSADDR slaveSelectAddr, unsigned char data );
+extern SUBSYS_STATUS SPIFLASH_open( void );
+
+//===============================================================================
+//= What:	isr324v221.h														=
+//===============================================================================
+#define CBOT_ISR( isr_name )	void isr_name( void )
+
+typedef enum ISR_VECT_TYPE {
+	ISR_VECT4 = 4,
+	ISR_VECT21 = 21,
+	ISR_VECT24 = 24,
+	ISR_VECT_COUNT = 31
+} ISR_VECT;
+
+#define ISR_PCINT0_VECT			ISR_VECT4
+#define ISR_USART0_UDRE_VECT	ISR_VECT21
+#define ISR_ADC_VECT			ISR_VECT24
+
+typedef void ( *CBOT_ISR_FUNC_PTR )( void );
+
+extern SUBSYS_STATUS ISR_open( void );
+extern CBOT_ISR_FUNC_PTR ISR_attach( ISR_VECT vect, CBOT_ISR_FUNC_PTR isr_function );
+
+//===============================================================================
+//= What:	cbot324v221.h														=
+//===============================================================================
+extern void CBOT_main( void );
+
+#endif // __CAPI324V221_H__
@@ -0,0 +1,28 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	util/crc16.h (host stand-in)									=
+//= Desc:		Host replacement for avr-libc's _crc16_update() (CRC-16/IBM,	=
+//=				reflected polynomial 0xA001), so records written by the			=
+//=				simulator check out on the robot and back.						=
+//= Functions:	_crc16_update()													=
+//= Other:		none.															=
+//===============================================================================
+#ifndef __UTIL_CRC16_H__
+#define __UTIL_CRC16_H__
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update( uint16_t crc, uint8_t a )
+{
+	int i;
+
+	crc ^= a;
+	for( i = 0; i < 8; i++ )
+		crc = ( crc & 1 ) ? ( crc >> 1 ) ^ 0xA001 : ( crc >> 1 );
+
+	return crc;
+}
+
+#endif // __UTIL_CRC16_H__
@@ -0,0 +1,100 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	sim.h															=
+//= Desc:		Shared declarations for the host simulator: the virtual clock	=
+//=				(capi_host.c), the arena model (world.c) and the episode		=
+//=				runner (sim_main.c).											=
+//= Functions:	none.															=
+//= Other:		none.															=
+//===============================================================================
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+#define SIM_TICK_US		1000UL		// Timer service / physics resolution (1ms).
+#define AIM_TOL_DEG		10.0		// Heading error that counts as aimed at the lamp.
+#define ACQ_HOLD_S		0.25		// Aimed and driving this long counts as acquiring the lamp.
+
+//===============================================================================
+//= What:	Type Declarations.													=
+//===============================================================================
+
+// Desc: Everything that parameterizes one episode.  Filled in by sim_main.c
+//       from the command line, read by the stand-ins and the world model.
+typedef struct SIM_CONFIG_TYPE {
+	double duration_s;		// Episode time limit (virtual seconds).
+	unsigned int seed;		// Episode seed (start pose, light, noise).
+	int exact;				// Non-zero disables idle fast-forward.
+	unsigned int poll_us;	// Virtual CPU time charged per TIMER_ALARM poll.
+	unsigned int lcd_us;	// Virtual CPU time charged per LCD_printf.
+	double arena_w_cm;		// Arena width  (x) in cm.
+	double arena_h_cm;		// Arena height (y) in cm.
+	double goal_cm;			// Distance to the lamp that counts as 'home'.
+	double noise_counts;	// Std. dev. of photoresistor noise in ADC counts.
+	int step_start;			// Non-zero: fixed step-response start, not a random one.
+	double step_deg;		// Step-response start: lamp this far right of the heading.
+	double step_cm;			// Step-response start: distance to the lamp.
+	FILE *trace;			// Per-tick pose trace (CSV) or NULL.
+	FILE *adc_trace;		// Every register-driven ADC conversion (CSV) or NULL.
+	FILE *uart0_tx;			// Where UART0 output goes, or NULL to drop it.
+	double uart0_rx_at_s;	// Virtual time at which 'uart0_rx' arrives.
+	const char *uart0_rx;	// Bytes 'typed' into UART0, or NULL.
+	const char *flash_image;	// SPI flash contents file (loaded, then saved), or NULL.
+	const char *eeprom_image;	// EEPROM contents file (loaded, then saved), or NULL.
+} SIM_CONFIG;
+
+// Desc: Outcome of one episode, passed from the worker back to the runner.
+typedef struct SIM_RESULT_TYPE {
+	unsigned int seed;		// Seed the episode ran with.
+	int reached;			// Non-zero if the robot got within 'goal_cm'.
+	double t_goal_s;		// Virtual time at goal (or at time limit).
+	double path_cm;			// Distance driven by the robot centre.
+	double aim_s;			// Last time the lamp was over AIM_TOL_DEG off the heading.
+	double acq_s;			// Start of the first ACQ_HOLD_S aimed at and driving to the lamp.
+	unsigned int collisions;	// Wall contacts.
+	unsigned long loops;	// Arbitration loop passes (TIMER_ALARM polls / 2).
+} SIM_RESULT;
+
+// Desc: Simulated robot pose and odometry.
+typedef struct SIM_POSE_TYPE {
+	double x_cm;
+	double y_cm;
+	double heading_rad;
+} SIM_POSE;
+
+//===============================================================================
+//= What:	Prototypes.															=
+//===============================================================================
+
+// Contained in capi_host.c
+void SIM_reset( const SIM_CONFIG *pConfig );
+uint64_t SIM_now_us( void );
+void SIM_advance_us( uint64_t us );
+void SIM_end_episode( void );
+double SIM_servo_rad( int which );
+extern SIM_RESULT SIM_result;
+extern int SIM_result_fd;
+
+// Contained in world.c
+void WORLD_reset( const SIM_CONFIG *pConfig );
+void WORLD_move( double steps_L, double steps_R );
+unsigned short int WORLD_adc( int channel );
+double WORLD_adc_clean( int channel );
+int WORLD_ir( int left );
+double WORLD_range_cm( void );
+int WORLD_at_goal( void );
+SIM_POSE WORLD_pose( void );
+double WORLD_path_cm( void );
+unsigned int WORLD_collisions( void );
+double WORLD_aim_s( void );
+double WORLD_acq_s( void );
+double WORLD_rand_gauss( void );
+
+#endif // __SIM_H__
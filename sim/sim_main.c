@@ -0,0 +1,310 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	sim_main.c														=
+//= Desc:		Episode runner for the host simulator.  Each episode forks a	=
+//=				worker that runs the unmodified CBOT_main() against the			=
+//=				stand-ins until the robot reaches the lamp or time runs out,	=
+//=				so every episode starts from a clean power-on state.			=
+//= Functions:	main()															=
+//= Other:		none.															=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+//===============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "capi324v221.h"
+#include "sim.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//===============================================================================
+#define MAX_JOBS	64
+
+//===============================================================================
+//= What:	Type Declarations.													=
+//===============================================================================
+
+// Desc: One running worker and the pipe its result comes back on.
+typedef struct SIM_WORKER_TYPE {
+	pid_t pid;
+	int fd;
+	unsigned int seed;
+} SIM_WORKER;
+
+//===============================================================================
+//= What:	usage()																=
+//===============================================================================
+static void usage( const char *argv0 )
+{
+	fprintf( stderr,
+		"usage: %s [options]\n"
+		"  -n N      episodes to run (default 1)\n"
+		"  -s SEED   seed of the first episode (default 1)\n"
+		"  -j JOBS   episodes run in parallel (default 1)\n"
+		"  -t SECS   virtual time limit per episode (default 60)\n"
+		"  -x        exact timing: charge every loop pass, no fast-forward\n"
+		"  -p US     virtual cost of one TIMER_ALARM poll (default 40)\n"
+		"  -l US     virtual cost of one LCD_printf (default 3000)\n"
+		"  -w WxH    arena size in cm (default 300x200)\n"
+		"  -g CM     goal radius around the lamp (default 25)\n"
+		"  -e COUNTS photoresistor noise, std. dev. in ADC counts (default 4)\n"
+		"  -b DEG    step-response start: lamp DEG to the right of the heading\n"
+		"  -d CM     step-response start: distance to the lamp (default 150)\n"
+		"  -o FILE   write a 10ms pose trace (CSV) of the first episode\n"
+		"  -a FILE   write every ADC scan conversion (CSV) of the first episode\n"
+		"  -u FILE   write UART0 output of the first episode to FILE\n"
+		"  -k T:TEXT type TEXT into UART0 at virtual time T seconds\n"
+		"  -F FILE   SPI flash image of the first episode (loaded, then saved)\n"
+		"  -E FILE   EEPROM image of the first episode (loaded, then saved)\n"
+		"  -c        print one CSV row per episode\n", argv0 );
+	exit( 1 );
+}
+
+//===============================================================================
+//= What:	start_worker()														=
+//= Why:	Forks one episode.													=
+//= Return:	SIM_WORKER (pid and result pipe of the child).						=
+//= Params:	SIM_CONFIG *pConfig (episode parameters)							=
+//= Notes:	The child never returns from here.									=
+//===============================================================================
+static SIM_WORKER start_worker( const SIM_CONFIG *pConfig )
+{
+	SIM_WORKER w;
+	int fds[ 2 ];
+
+	if( pipe( fds ) < 0 )
+	{
+		perror( "pipe" );
+		exit( 1 );
+	}
+
+	w.seed = pConfig->seed;
+	w.fd = fds[ 0 ];
+
+	// Unflushed stdio output (e.g. a CSV header) would otherwise be
+	// written twice, once by each process.
+	fflush( NULL );
+	w.pid = fork();
+
+	if( w.pid < 0 )
+	{
+		perror( "fork" );
+		exit( 1 );
+	}
+
+	if( w.pid == 0 )
+	{
+		close( fds[ 0 ] );
+		SIM_result_fd = fds[ 1 ];
+		SIM_reset( pConfig );
+		CBOT_main();
+		SIM_end_episode();
+	}
+
+	close( fds[ 1 ] );
+	return w;
+}
+
+//===============================================================================
+//= What:	main()																=
+//= Why:	Parses options, runs the episodes, prints the summary.				=
+//===============================================================================
+int main( int argc, char *argv[] )
+{
+	SIM_CONFIG config;
+	SIM_WORKER workers[ MAX_JOBS ];
+	unsigned int episodes = 1, started = 0, done = 0, reached = 0;
+	unsigned int first_seed = 1, collisions = 0, acquired = 0;
+	int jobs = 1, running = 0, csv = 0, opt, i;
+	double t_sum = 0, path_sum = 0, aim_sum = 0, acq_sum = 0;
+	unsigned long loops = 0;
+	const char *trace_path = NULL;
+	const char *uart_path = NULL;
+	const char *adc_path = NULL;
+	const char *flash_path = NULL;
+	const char *eeprom_path = NULL;
+	struct timeval t0, t1;
+	char *end;
+	double wall;
+
+	memset( &config, 0, sizeof( config ) );
+	config.duration_s = 60.0;
+	config.poll_us = 40;
+	config.lcd_us = 3000;
+	config.arena_w_cm = 300.0;
+	config.arena_h_cm = 200.0;
+	config.goal_cm = 25.0;
+	config.noise_counts = 4.0;
+	config.step_cm = 150.0;
+
+	while( ( opt = getopt( argc, argv, "n:s:j:t:xp:l:w:g:e:b:d:o:a:u:k:F:E:ch" ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 'n': episodes = strtoul( optarg, NULL, 0 ); break;
+			case 's': first_seed = strtoul( optarg, NULL, 0 ); break;
+			case 'j': jobs = atoi( optarg ); break;
+			case 't': config.duration_s = atof( optarg ); break;
+			case 'x': config.exact = 1; break;
+			case 'p': config.poll_us = strtoul( optarg, NULL, 0 ); break;
+			case 'l': config.lcd_us = strtoul( optarg, NULL, 0 ); break;
+			case 'w':
+				if( sscanf( optarg, "%lfx%lf", &config.arena_w_cm, &config.arena_h_cm ) != 2 )
+					usage( argv[ 0 ] );
+				break;
+			case 'g': config.goal_cm = atof( optarg ); break;
+			case 'e': config.noise_counts = atof( optarg ); break;
+			case 'b': config.step_start = 1; config.step_deg = atof( optarg ); break;
+			case 'd': config.step_cm = atof( optarg ); break;
+			case 'o': trace_path = optarg; break;
+			case 'a': adc_path = optarg; break;
+			case 'u': uart_path = optarg; break;
+			case 'k':
+				config.uart0_rx_at_s = strtod( optarg, &end );
+				if( *end != ':' )
+					usage( argv[ 0 ] );
+				config.uart0_rx = end + 1;
+				break;
+			case 'F': flash_path = optarg; break;
+			case 'E': eeprom_path = optarg; break;
+			case 'c': csv = 1; break;
+			default: usage( argv[ 0 ] );
+		}
+	}
+
+	if( jobs < 1 || jobs > MAX_JOBS || episodes == 0 )
+		usage( argv[ 0 ] );
+
+	if( csv )
+		printf( "seed,reached,t_s,path_cm,collisions,loops,aim_s,acq_s\n" );
+
+	gettimeofday( &t0, NULL );
+
+	while( done < episodes )
+	{
+		SIM_RESULT r;
+		pid_t pid;
+		int status;
+
+		while( running < jobs && started < episodes )
+		{
+			SIM_CONFIG c = config;
+
+			c.seed = first_seed + started;
+			c.trace = NULL;
+			c.adc_trace = NULL;
+			c.uart0_tx = NULL;
+			c.flash_image = ( started == 0 ) ? flash_path : NULL;
+			c.eeprom_image = ( started == 0 ) ? eeprom_path : NULL;
+			if( started == 0 && uart_path )
+			{
+				c.uart0_tx = fopen( uart_path, "w" );
+				if( !c.uart0_tx )
+				{
+					perror( uart_path );
+					return 1;
+				}
+			}
+			if( started == 0 && trace_path )
+			{
+				c.trace = fopen( trace_path, "w" );
+				if( !c.trace )
+				{
+					perror( trace_path );
+					return 1;
+				}
+				fprintf( c.trace, "t_s,x_cm,y_cm,heading_rad,speed_L,speed_R\n" );
+			}
+
+			if( started == 0 && adc_path )
+			{
+				c.adc_trace = fopen( adc_path, "w" );
+				if( !c.adc_trace )
+				{
+					perror( adc_path );
+					return 1;
+				}
+				fprintf( c.adc_trace, "t_us,channel,raw,clean\n" );
+			}
+
+			workers[ running++ ] = start_worker( &c );
+			if( c.trace )
+				fclose( c.trace );
+			if( c.uart0_tx )
+				fclose( c.uart0_tx );
+			if( c.adc_trace )
+				fclose( c.adc_trace );
+			started++;
+		}
+
+		pid = wait( &status );
+		for( i = 0; i < running; i++ )
+			if( workers[ i ].pid == pid )
+				break;
+		if( i == running )
+			continue;
+
+		if( read( workers[ i ].fd, &r, sizeof( r ) ) != sizeof( r ) )
+		{
+			fprintf( stderr, "episode %u: worker died (status %d)\n",
+				workers[ i ].seed, status );
+			return 1;
+		}
+		close( workers[ i ].fd );
+		workers[ i ] = workers[ --running ];
+		done++;
+
+		if( csv )
+			printf( "%u,%d,%.3f,%.1f,%u,%lu,%.3f,%.3f\n", r.seed, r.reached,
+				r.t_goal_s, r.path_cm, r.collisions, r.loops, r.aim_s, r.acq_s );
+
+		if( r.reached )
+		{
+			reached++;
+			t_sum += r.t_goal_s;
+			path_sum += r.path_cm;
+			aim_sum += r.aim_s;
+		}
+		if( r.acq_s >= 0 )
+		{
+			acquired++;
+			acq_sum += r.acq_s;
+		}
+		collisions += r.collisions;
+		loops += r.loops;
+	}
+
+	gettimeofday( &t1, NULL );
+	wall = ( t1.tv_sec - t0.tv_sec ) + ( t1.tv_usec - t0.tv_usec ) / 1e6;
+
+	fprintf( csv ? stderr : stdout,
+		"episodes:        %u\n"
+		"reached lamp:    %u (%.1f%%)\n"
+		"mean t-to-goal:  %.2f s\n"
+		"mean path:       %.1f cm\n"
+		"mean t-to-aim:   %.2f s\n"
+		"acquired lamp:   %u (%.1f%%)\n"
+		"mean t-to-acq:   %.2f s\n"
+		"collisions/ep:   %.2f\n"
+		"loop passes/ep:  %.0f\n"
+		"episodes/sec:    %.0f\n",
+		episodes, reached, 100.0 * reached / episodes,
+		reached ? t_sum / reached : 0.0,
+		reached ? path_sum / reached : 0.0,
+		reached ? aim_sum / reached : 0.0,
+		acquired, 100.0 * acquired / episodes,
+		acquired ? acq_sum / acquired : 0.0,
+		( double ) collisions / episodes,
+		( double ) loops / episodes,
+		episodes / ( wall > 0 ? wall : 1e-9 ) );
+
+	return 0;
+}
@@ -0,0 +1,277 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	teledecode.c													=
+//= Desc:		Telemetry decoder.  Reads the binary frames telemetry.c sends	=
+//=				on UART0, or a flight recorder dump (flightrec.c), from a		=
+//=				serial port, a capture file, or stdin, and writes one CSV row	=
+//=				per good frame.													=
+//= Functions:	main()															=
+//= Other:		Frames are found by their two header bytes and accepted only	=
+//=				if the checksum holds, so text on the same port (profiler		=
+//=				report, calibration prompts) is skipped.  Flight recorder		=
+//=				sector headers set the run number ('-r' adds it as a column).	=
+//=				Statistics go to stderr.										=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+//===============================================================================
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "ECEN3450Lab06.h"
+
+//===============================================================================
+//= What:	Type Declarations.													=
+//===============================================================================
+
+// Desc: What the decoder has seen so far.
+typedef struct DECODE_STATS_TYPE {
+	unsigned long frames;		// Good frames written.
+	unsigned long bad;			// Headers whose checksum failed.
+	unsigned long skipped;		// Bytes outside any good frame.
+	unsigned long lost;			// Frames missing from the sequence.
+	unsigned long runs;			// Flight recorder runs seen.
+} DECODE_STATS;
+
+//===============================================================================
+//= What:	usage()																=
+//===============================================================================
+static void usage( const char *argv0 )
+{
+	fprintf( stderr,
+		"usage: %s [options] [FILE|DEVICE]\n"
+		"  -b BAUD   line rate when reading a serial port (default %lu)\n"
+		"  -r        first column is the flight recorder run number\n"
+		"  -q        no statistics on stderr\n"
+		"Reads stdin without FILE.  A serial port is switched to raw 8N1.\n",
+		argv0, UART0_BAUD );
+	exit( 1 );
+}
+
+//===============================================================================
+//= What:	open_serial()														=
+//= Why:	Puts a tty into raw 8N1 at 'baud' so the bytes arrive untouched.	=
+//= Return:	int (0 on success, -1 if the rate is not supported).				=
+//= Params:	int fd (open tty)													=
+//=			unsigned long baud (line rate)										=
+//===============================================================================
+static int open_serial( int fd, unsigned long baud )
+{
+	static const struct { unsigned long baud; speed_t speed; } rates[] = {
+		{ 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 },
+		{ 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 }
+	};
+	struct termios tio;
+	size_t i;
+
+	for( i = 0; i < sizeof( rates ) / sizeof( rates[ 0 ] ); i++ )
+		if( rates[ i ].baud == baud )
+			break;
+	if( i == sizeof( rates ) / sizeof( rates[ 0 ] ) )
+		return -1;
+
+	if( tcgetattr( fd, &tio ) < 0 )
+		return -1;
+
+	cfmakeraw( &tio );
+	tio.c_cflag &= ~( CSTOPB | PARENB );
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[ VMIN ] = 1;
+	tio.c_cc[ VTIME ] = 0;
+	cfsetispeed( &tio, rates[ i ].speed );
+	cfsetospeed( &tio, rates[ i ].speed );
+
+	return tcsetattr( fd, TCSANOW, &tio );
+}
+
+//===============================================================================
+//= What:	get16()																=
+//= Return:	unsigned int (little-endian 16-bit field at 'p').					=
+//===============================================================================
+static unsigned int get16( const unsigned char *p )
+{
+	return p[ 0 ] | ( p[ 1 ] << 8 );
+}
+
+//===============================================================================
+//= What:	frame_ok()															=
+//= Why:	Checks the header and the checksum of one candidate frame.			=
+//= Return:	int (1 if it is a good frame).										=
+//= Params:	const unsigned char *p (TLM_FRAME_SIZE bytes)						=
+//===============================================================================
+static int frame_ok( const unsigned char *p )
+{
+	unsigned char sum = 0;
+	int i;
+
+	if( p[ TLM_OFS_SYNC ] != TLM_SYNC0 || p[ TLM_OFS_SYNC + 1 ] != TLM_SYNC1 )
+		return 0;
+
+	for( i = TLM_OFS_SEQ; i <= TLM_OFS_CHECK; i++ )
+		sum += p[ i ];
+
+	return sum == 0;
+}
+
+//===============================================================================
+//= What:	header_run()														=
+//= Why:	Checks for a flight recorder sector header.							=
+//= Return:	long (its run number, or -1 if 'p' is not a good header).			=
+//= Params:	const unsigned char *p (FR_HEADER_SIZE bytes)						=
+//===============================================================================
+static long header_run( const unsigned char *p )
+{
+	unsigned char sum = 0;
+	int i;
+
+	if( p[ FR_OFS_SYNC ] != FR_SYNC0 || p[ FR_OFS_SYNC + 1 ] != FR_SYNC1 )
+		return -1;
+
+	for( i = FR_OFS_RUN; i <= FR_OFS_CHECK; i++ )
+		sum += p[ i ];
+
+	return sum == 0 ? ( long ) get16( &p[ FR_OFS_RUN ] ) : -1;
+}
+
+//===============================================================================
+//= What:	print_frame()														=
+//= Why:	Writes one good frame as a CSV row.									=
+//===============================================================================
+static void print_frame( const unsigned char *p, long run )
+{
+	unsigned long t_ms = get16( &p[ TLM_OFS_T_MS ] ) |
+		( ( unsigned long ) get16( &p[ TLM_OFS_T_MS + 2 ] ) << 16 );
+
+	if( run >= 0 )
+		printf( "%ld,", run );
+
+	printf( "%u,%lu,%u,%u,%u,%u,%u,%u,%d,%d,%d,%d,%.1f,%u\n",
+		p[ TLM_OFS_SEQ ], t_ms, p[ TLM_OFS_STATE ],
+		get16( &p[ TLM_OFS_LEFT_PR ] ), get16( &p[ TLM_OFS_RIGHT_PR ] ),
+		get16( &p[ TLM_OFS_USONIC ] ),
+		( p[ TLM_OFS_IR ] & TLM_IR_LEFT ) ? 1 : 0,
+		( p[ TLM_OFS_IR ] & TLM_IR_RIGHT ) ? 1 : 0,
+		( signed short ) get16( &p[ TLM_OFS_SPEED_L ] ),
+		( signed short ) get16( &p[ TLM_OFS_SPEED_R ] ),
+		( signed short ) get16( &p[ TLM_OFS_X_CM ] ),
+		( signed short ) get16( &p[ TLM_OFS_Y_CM ] ),
+		get16( &p[ TLM_OFS_HEADING ] ) * 360.0 / 65536.0,
+		get16( &p[ TLM_OFS_STACK ] ) );
+}
+
+//===============================================================================
+//= What:	main()																=
+//= Why:	Parses options, then decodes until end of input.					=
+//===============================================================================
+int main( int argc, char *argv[] )
+{
+	unsigned char buf[ 4096 ];
+	size_t have = 0, pos;
+	unsigned long baud = UART0_BAUD;
+	DECODE_STATS stats;
+	int quiet = 0, with_run = 0, fd = 0, opt;
+	int last_seq = -1;
+	long run = 0, r;
+	ssize_t n;
+
+	memset( &stats, 0, sizeof( stats ) );
+
+	while( ( opt = getopt( argc, argv, "b:rqh" ) ) != -1 )
+	{
+		switch( opt )
+		{
+			case 'b': baud = strtoul( optarg, NULL, 0 ); break;
+			case 'r': with_run = 1; break;
+			case 'q': quiet = 1; break;
+			default: usage( argv[ 0 ] );
+		}
+	}
+
+	if( optind < argc - 1 )
+		usage( argv[ 0 ] );
+
+	if( optind == argc - 1 )
+	{
+		fd = open( argv[ optind ], O_RDONLY | O_NOCTTY );
+		if( fd < 0 )
+		{
+			perror( argv[ optind ] );
+			return 1;
+		}
+		if( isatty( fd ) && open_serial( fd, baud ) < 0 )
+		{
+			fprintf( stderr, "%s: cannot set %lu baud\n", argv[ optind ], baud );
+			return 1;
+		}
+	}
+
+	// Serial ports never end, so flush each row as it is decoded.
+	if( isatty( fd ) )
+		setvbuf( stdout, NULL, _IOLBF, 0 );
+
+	printf( "%sseq,t_ms,state,left_PR,right_PR,range_cm,left_IR,right_IR,speed_L,speed_R,x_cm,y_cm,heading_deg,stack_free\n",
+		with_run ? "run," : "" );
+
+	while( ( n = read( fd, buf + have, sizeof( buf ) - have ) ) > 0 )
+	{
+		have += n;
+		pos = 0;
+
+		while( have - pos >= TLM_FRAME_SIZE )
+		{
+			const unsigned char *p = buf + pos;
+
+			// A new run (or the next sector of one) in a recorder dump.
+			if( ( r = header_run( p ) ) >= 0 )
+			{
+				if( r != run )
+				{
+					run = r;
+					last_seq = -1;
+					stats.runs++;
+				}
+				pos += FR_HEADER_SIZE;
+				continue;
+			}
+
+			if( !frame_ok( p ) )
+			{
+				if( p[ 0 ] == TLM_SYNC0 && p[ 1 ] == TLM_SYNC1 )
+					stats.bad++;
+				stats.skipped++;
+				pos++;
+				continue;
+			}
+
+			if( last_seq >= 0 )
+				stats.lost += ( p[ TLM_OFS_SEQ ] - last_seq - 1 ) & 0xFF;
+			last_seq = p[ TLM_OFS_SEQ ];
+
+			print_frame( p, with_run ? run : -1 );
+			stats.frames++;
+			pos += TLM_FRAME_SIZE;
+		}
+
+		memmove( buf, buf + pos, have - pos );
+		have -= pos;
+	}
+
+	stats.skipped += have;
+
+	if( !quiet )
+		fprintf( stderr,
+			"frames:          %lu\n"
+			"lost (seq gaps): %lu\n"
+			"bad checksums:   %lu\n"
+			"bytes skipped:   %lu\n"
+			"recorder runs:   %lu\n",
+			stats.frames, stats.lost, stats.bad, stats.skipped, stats.runs );
+
+	return 0;
+}
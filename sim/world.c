@@ -0,0 +1,356 @@
+//===============================================================================
+//= Authors:	Michael Quinn, Collin Peterson.									=
+//= Course:		ECEN 3450 - Mobile Robotics.									=
+//= Assignment:	Laboratory 06 - Light Homing.									=
+//= File Name:	world.c															=
+//= Desc:		Arena model for the simulator: a walled rectangle with one		=
+//=				lamp, differential-drive kinematics from wheel steps, and		=
+//=				photoresistor / IR sensor models.								=
+//= Functions:	WORLD_reset(), WORLD_move(), WORLD_adc(), WORLD_adc_clean(),	=
+//=				WORLD_ir(), WORLD_range_cm(), WORLD_at_goal(), WORLD_pose(),	=
+//=				WORLD_path_cm(), WORLD_collisions(), WORLD_aim_s(),				=
+//=				WORLD_acq_s(), WORLD_rand_gauss()								=
+//= Other:		Geometry is in cm, angles in radians, CCW positive.				=
+//===============================================================================
+
+//===============================================================================
+//= What:	Includes.															=
+//===============================================================================
+#include <math.h>
+#include "ECEN3450Lab06.h"
+#include "sim.h"
+
+//===============================================================================
+//= What:	Defines.															=
+//= Why:	Robot and sensor geometry.											=
+//===============================================================================
+#define STEP_CM			( M_PI * 10.16 / STEPS_PER_RVLTN )	// 4" wheel, 200 steps/rev.
+#define TRACK_CM		( 4.0 * DEG_90 * STEP_CM / M_PI )	// From DEG_90 in-place turn.
+#define ROBOT_R_CM		15.0	// Body radius used for wall contact.
+#define PR_MOUNT_RAD	( 30.0 * M_PI / 180.0 )		// PRs splay +/-30 deg.
+#define PR_AMBIENT		0.30	// Room light (relative units).
+#define PR_LAMP			6.0		// Lamp intensity (relative units).
+#define PR_D0_CM		60.0	// Lamp falloff distance.
+#define PR_GAIN_SPREAD	0.10	// Per-sensor gain mismatch (+/-).
+#define PANO_LOBE_POW	4.0		// Panorama sensor is hooded: cos^4 lobe.
+#define IR_MOUNT_RAD	( 20.0 * M_PI / 180.0 )		// IRs splay +/-20 deg.
+#define IR_RANGE_CM		20.0	// Detection range beyond the body.
+#define WALL_MARGIN_CM	40.0	// Keep start pose and lamp off the walls.
+#define RANGE_NOISE_CM	0.5		// Ultrasonic range noise, std. dev.
+
+//===============================================================================
+//= What:	Globals.															=
+//===============================================================================
+static SIM_CONFIG config;
+static SIM_POSE pose;
+static double lamp_x, lamp_y;
+static double pr_gain[ 2 ];		// [0] = left, [1] = right.
+static double path_cm;
+static unsigned int collisions;
+static double aim_s;
+static double lock_s;		// Start of the current aimed, driving stretch.
+static double acq_s;
+static int in_contact;
+static uint32_t rng;
+
+//===============================================================================
+//= What:	rand_u32() / rand_unit()											=
+//= Why:	Deterministic per-episode PRNG (xorshift32).						=
+//===============================================================================
+static uint32_t rand_u32( void )
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static double rand_unit( void )
+{
+	return ( rand_u32() >> 8 ) / ( double )( 1UL << 24 );
+}
+
+double WORLD_rand_gauss( void )
+{
+	double u1 = rand_unit() + 1e-12;
+	double u2 = rand_unit();
+
+	return sqrt( -2.0 * log( u1 ) ) * cos( 2.0 * M_PI * u2 );
+}
+
+//===============================================================================
+//= What:	WORLD_reset()														=
+//= Why:	Places the robot and the lamp for a new episode.					=
+//= Desc:	Random start pose and lamp position (at least 100cm apart), and		=
+//=			random per-sensor photoresistor gain mismatch.  A step-response		=
+//=			start instead puts the lamp 'step_cm' away, centered in the			=
+//=			arena, with the robot facing 'step_deg' to the left of it.			=
+//= Return:	void.																=
+//= Params:	const SIM_CONFIG *pConfig (arena size, seed)						=
+//= Notes:	none.																=
+//===============================================================================
+void WORLD_reset( const SIM_CONFIG *pConfig )
+{
+	double w, h;
+
+	config = *pConfig;
+	rng = config.seed * 2654435761u + 1u;
+	if( rng == 0 )
+		rng = 1;
+
+	w = config.arena_w_cm - 2 * WALL_MARGIN_CM;
+	h = config.arena_h_cm - 2 * WALL_MARGIN_CM;
+
+	if( config.step_start )
+	{
+		pose.x_cm = 0.5 * ( config.arena_w_cm - config.step_cm );
+		pose.y_cm = 0.5 * config.arena_h_cm;
+		lamp_x = pose.x_cm + config.step_cm;
+		lamp_y = pose.y_cm;
+		pose.heading_rad = fmod( config.step_deg * M_PI / 180.0 + 2.0 * M_PI, 2.0 * M_PI );
+	}
+	else
+	{
+		do {
+			pose.x_cm = WALL_MARGIN_CM + rand_unit() * w;
+			pose.y_cm = WALL_MARGIN_CM + rand_unit() * h;
+			lamp_x = WALL_MARGIN_CM + rand_unit() * w;
+			lamp_y = WALL_MARGIN_CM + rand_unit() * h;
+		} while( hypot( lamp_x - pose.x_cm, lamp_y - pose.y_cm ) < 100.0 );
+
+		pose.heading_rad = rand_unit() * 2.0 * M_PI;
+	}
+
+	pr_gain[ 0 ] = 1.0 + PR_GAIN_SPREAD * ( 2.0 * rand_unit() - 1.0 );
+	pr_gain[ 1 ] = 1.0 + PR_GAIN_SPREAD * ( 2.0 * rand_unit() - 1.0 );
+
+	path_cm = 0;
+	collisions = 0;
+	aim_s = 0;
+	lock_s = 0;
+	acq_s = -1;
+	in_contact = 0;
+}
+
+//===============================================================================
+//= What:	WORLD_move()														=
+//= Why:	Differential-drive kinematics for one tick of wheel motion.			=
+//= Desc:	Integrates the pose from signed left/right step counts and keeps	=
+//=			the body inside the walls, counting each new wall contact.  Notes	=
+//=			the time whenever the lamp is more than AIM_TOL_DEG off the			=
+//=			heading, and the first time it has been within it, with the robot	=
+//=			driving forward, for ACQ_HOLD_S.									=
+//= Return:	void.																=
+//= Params:	double steps_L, double steps_R (signed steps this tick)				=
+//= Notes:	none.																=
+//===============================================================================
+void WORLD_move( double steps_L, double steps_R )
+{
+	double dl = steps_L * STEP_CM;
+	double dr = steps_R * STEP_CM;
+	double ds = 0.5 * ( dl + dr );
+	double dth = ( dr - dl ) / TRACK_CM;
+	double mid = pose.heading_rad + 0.5 * dth;
+	double err;
+	int contact = 0;
+
+	pose.x_cm += ds * cos( mid );
+	pose.y_cm += ds * sin( mid );
+	pose.heading_rad += dth;
+	if( pose.heading_rad < 0 )
+		pose.heading_rad += 2.0 * M_PI;
+	else if( pose.heading_rad >= 2.0 * M_PI )
+		pose.heading_rad -= 2.0 * M_PI;
+	path_cm += fabs( ds );
+
+	if( pose.x_cm < ROBOT_R_CM ) { pose.x_cm = ROBOT_R_CM; contact = 1; }
+	if( pose.y_cm < ROBOT_R_CM ) { pose.y_cm = ROBOT_R_CM; contact = 1; }
+	if( pose.x_cm > config.arena_w_cm - ROBOT_R_CM ) { pose.x_cm = config.arena_w_cm - ROBOT_R_CM; contact = 1; }
+	if( pose.y_cm > config.arena_h_cm - ROBOT_R_CM ) { pose.y_cm = config.arena_h_cm - ROBOT_R_CM; contact = 1; }
+
+	if( contact && !in_contact )
+		collisions++;
+	in_contact = contact;
+
+	err = remainder( atan2( lamp_y - pose.y_cm, lamp_x - pose.x_cm ) - pose.heading_rad, 2.0 * M_PI );
+	if( fabs( err ) > AIM_TOL_DEG * M_PI / 180.0 )
+		aim_s = SIM_now_us() / 1e6;
+
+	if( fabs( err ) > AIM_TOL_DEG * M_PI / 180.0 || ds <= 0 )
+		lock_s = SIM_now_us() / 1e6;
+	else if( acq_s < 0 && SIM_now_us() / 1e6 - lock_s >= ACQ_HOLD_S )
+		acq_s = lock_s;
+}
+
+//===============================================================================
+//= What:	pr_level()															=
+//= Why:	Photoresistor divider model, before noise and quantization.			=
+//= Desc:	Cosine-lobe response to the lamp with inverse-square-like falloff,	=
+//=			plus ambient; the divider maps light L to V = 5 * L / (L + 1).		=
+//= Return:	double (ADC counts, unrounded).										=
+//= Params:	int left (non-zero for the left sensor)								=
+//= Notes:	Brighter reads higher, as on the robot.								=
+//===============================================================================
+static double pr_level( int left )
+{
+	double dir = pose.heading_rad + ( left ? PR_MOUNT_RAD : -PR_MOUNT_RAD );
+	double sx = pose.x_cm + ROBOT_R_CM * cos( dir );
+	double sy = pose.y_cm + ROBOT_R_CM * sin( dir );
+	double d = hypot( lamp_x - sx, lamp_y - sy );
+	double c = cos( atan2( lamp_y - sy, lamp_x - sx ) - dir );
+	double lobe = ( c > 0 ) ? 0.25 + 0.75 * c : 0.25;
+	double light = PR_AMBIENT + PR_LAMP * lobe / ( 1.0 + ( d / PR_D0_CM ) * ( d / PR_D0_CM ) );
+
+	light *= pr_gain[ left ? 0 : 1 ];
+	return 1024.0 * light / ( light + 1.0 );
+}
+
+//===============================================================================
+//= What:	pano_level()														=
+//= Why:	Panorama photoresistor model: a hooded sensor on PANO_SERVO at		=
+//=			the centre of the robot.											=
+//= Desc:	As pr_level(), with a narrower lobe and no gain mismatch.			=
+//= Return:	double (ADC counts, unrounded).										=
+//= Params:	void.																=
+//===============================================================================
+static double pano_level( void )
+{
+	double dir = pose.heading_rad + SIM_servo_rad( PANO_SERVO );
+	double d = hypot( lamp_x - pose.x_cm, lamp_y - pose.y_cm );
+	double c = cos( atan2( lamp_y - pose.y_cm, lamp_x - pose.x_cm ) - dir );
+	double lobe = ( c > 0 ) ? 0.1 + 0.9 * pow( c, PANO_LOBE_POW ) : 0.1;
+	double light = PR_AMBIENT + PR_LAMP * lobe / ( 1.0 + ( d / PR_D0_CM ) * ( d / PR_D0_CM ) );
+
+	return 1024.0 * light / ( light + 1.0 );
+}
+
+//===============================================================================
+//= What:	counts()															=
+//= Why:	What the ADC converts: a model level plus noise, clipped to			=
+//=			10 bits.															=
+//= Return:	unsigned short int (10-bit ADC counts).								=
+//= Params:	double level (model output, ADC counts)								=
+//===============================================================================
+static unsigned short int counts( double level )
+{
+	double c = level + config.noise_counts * WORLD_rand_gauss();
+
+	if( c < 0 )
+		c = 0;
+	if( c > 1023 )
+		c = 1023;
+
+	return ( unsigned short int )( c + 0.5 );
+}
+
+//===============================================================================
+//= What:	WORLD_adc()															=
+//= Why:	Value the ADC would convert on 'channel' right now.					=
+//= Return:	unsigned short int (10-bit ADC counts).								=
+//= Params:	int channel (ADC_CHANx)												=
+//= Notes:	Unconnected channels read mid-rail.									=
+//===============================================================================
+unsigned short int WORLD_adc( int channel )
+{
+	switch( channel )
+	{
+		case left_pr_channel:	return counts( pr_level( 1 ) );
+		case right_pr_channel:	return counts( pr_level( 0 ) );
+		case pano_pr_channel:	return counts( pano_level() );
+		default:				return 512;
+	}
+}
+
+//===============================================================================
+//= What:	WORLD_adc_clean()													=
+//= Why:	Ground truth for ADC traces: the level 'channel' would read with	=
+//=			no noise.															=
+//= Return:	double (ADC counts, unrounded).										=
+//= Params:	int channel (ADC_CHANx)												=
+//===============================================================================
+double WORLD_adc_clean( int channel )
+{
+	switch( channel )
+	{
+		case left_pr_channel:	return pr_level( 1 );
+		case right_pr_channel:	return pr_level( 0 );
+		case pano_pr_channel:	return pano_level();
+		default:				return 512;
+	}
+}
+
+//===============================================================================
+//= What:	WORLD_ir()															=
+//= Why:	IR proximity model: trips if a wall is within range on its ray.		=
+//= Return:	int (non-zero if tripped).											=
+//= Params:	int left (non-zero for the left sensor)								=
+//= Notes:	none.																=
+//===============================================================================
+int WORLD_ir( int left )
+{
+	double dir = pose.heading_rad + ( left ? IR_MOUNT_RAD : -IR_MOUNT_RAD );
+	double r = ROBOT_R_CM + IR_RANGE_CM;
+	double x = pose.x_cm + r * cos( dir );
+	double y = pose.y_cm + r * sin( dir );
+
+	return ( x < 0 || y < 0 || x > config.arena_w_cm || y > config.arena_h_cm );
+}
+
+//===============================================================================
+//= What:	WORLD_range_cm()													=
+//= Why:	Ultrasonic model: distance from the front of the body to the wall	=
+//=			straight ahead.														=
+//= Return:	double (cm, with a little noise; never negative).					=
+//= Params:	void.																=
+//= Notes:	Narrow beam along the heading; the lamp is not an obstacle.			=
+//===============================================================================
+double WORLD_range_cm( void )
+{
+	double c = cos( pose.heading_rad ), s = sin( pose.heading_rad );
+	double t = 1e9;
+
+	if( c > 1e-9 )
+		t = fmin( t, ( config.arena_w_cm - pose.x_cm ) / c );
+	else if( c < -1e-9 )
+		t = fmin( t, -pose.x_cm / c );
+	if( s > 1e-9 )
+		t = fmin( t, ( config.arena_h_cm - pose.y_cm ) / s );
+	else if( s < -1e-9 )
+		t = fmin( t, -pose.y_cm / s );
+
+	t += RANGE_NOISE_CM * WORLD_rand_gauss() - ROBOT_R_CM;
+	return ( t > 0 ) ? t : 0;
+}
+
+//===============================================================================
+//= What:	Accessors.															=
+//===============================================================================
+int WORLD_at_goal( void )
+{
+	return hypot( lamp_x - pose.x_cm, lamp_y - pose.y_cm ) < config.goal_cm;
+}
+
+SIM_POSE WORLD_pose( void )
+{
+	return pose;
+}
+
+double WORLD_path_cm( void )
+{
+	return path_cm;
+}
+
+unsigned int WORLD_collisions( void )
+{
+	return collisions;
+}
+
+double WORLD_aim_s( void )
+{
+	return aim_s;
+}
+
+double WORLD_acq_s( void )
+{
+	return acq_s;
+}